@@ -0,0 +1,225 @@
+#include "curlmultidownloader.h"
+
+#include <iostream>
+#include <algorithm>
+#include <strings.h> // strncasecmp
+
+CurlMultiDownloader::CurlMultiDownloader(long maxConnectionsPerHost)
+    : m_multi(curl_multi_init()), m_connectionsOpened(0)
+{
+    curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, maxConnectionsPerHost);
+    curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+}
+
+CurlMultiDownloader::~CurlMultiDownloader()
+{
+    for (auto easy : m_idleHandles) {
+        curl_easy_cleanup(easy);
+    }
+    curl_multi_cleanup(m_multi);
+}
+
+DownloadResponse CurlMultiDownloader::download(const DownloadRequest &request)
+{
+    std::vector<DownloadResponse> responses;
+    downloadAll(std::vector<DownloadRequest>{request}, &responses);
+    return std::move(responses.at(0));
+}
+
+void CurlMultiDownloader::downloadAll(const std::vector<DownloadRequest> &requests,
+                                      std::vector<DownloadResponse> *responses)
+{
+    responses->clear();
+    responses->resize(requests.size());
+
+    // not resized : the attempts are pointed to by their easy handle
+    std::vector<Transfer> transfers(requests.size());
+    for (size_t i = 0; i < requests.size(); i++) {
+        std::cerr << "Downloading " << requests[i].url << std::endl;
+        transfers[i].request = &requests[i];
+        transfers[i].response = &(*responses)[i];
+        transfers[i].start = std::chrono::steady_clock::now();
+        transfers[i].attemptCount = 0;
+        transfers[i].done = false;
+        start(&transfers[i]);
+    }
+
+    int running = 0;
+    do {
+        if (curl_multi_perform(m_multi, &running) != CURLM_OK) {
+            break;
+        }
+
+        CURLMsg *msg;
+        int left;
+        while ((msg = curl_multi_info_read(m_multi, &left))) {
+            if (msg->msg == CURLMSG_DONE) {
+                Attempt *attempt = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &attempt);
+                finish(attempt, msg->data.result);
+            }
+        }
+
+        int nextHedgeMs = hedge(&transfers);
+        if (nextHedgeMs >= 0) {
+            running = 1; // a hedge is pending
+        }
+        if (running) {
+            int timeoutMs = nextHedgeMs >= 0 && nextHedgeMs < 1000 ? nextHedgeMs : 1000;
+            curl_multi_poll(m_multi, nullptr, 0, timeoutMs, nullptr);
+        }
+    } while (running);
+
+    // the transfers not reported done keep their status of -1
+    for (auto &transfer : transfers) {
+        for (int i = 0; i < transfer.attemptCount; i++) {
+            Attempt &attempt = transfer.attempts[i];
+            stop(&attempt);
+
+            long connects = 0;
+            curl_easy_getinfo(attempt.easy, CURLINFO_NUM_CONNECTS, &connects);
+            m_connectionsOpened += connects;
+
+            curl_slist_free_all(attempt.headers);
+            m_idleHandles.push_back(attempt.easy);
+        }
+    }
+}
+
+CURL *CurlMultiDownloader::takeHandle()
+{
+    if (m_idleHandles.empty()) {
+        return curl_easy_init();
+    }
+    CURL *easy = m_idleHandles.back();
+    m_idleHandles.pop_back();
+    curl_easy_reset(easy);
+    return easy;
+}
+
+// sends the request once more
+void CurlMultiDownloader::start(Transfer *transfer)
+{
+    const DownloadRequest &request = *transfer->request;
+    Attempt *attempt = &transfer->attempts[transfer->attemptCount++];
+    attempt->transfer = transfer;
+    attempt->easy = takeHandle();
+    attempt->running = true;
+
+    attempt->headers = nullptr;
+    attempt->headers = curl_slist_append(attempt->headers, "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+    attempt->headers = curl_slist_append(attempt->headers, "Accept-Language: en-US,en;q=0.5");
+    if (!request.ifNoneMatch.empty()) {
+        attempt->headers = curl_slist_append(attempt->headers, ("If-None-Match: " + request.ifNoneMatch).c_str());
+    }
+    if (!request.ifModifiedSince.empty()) {
+        attempt->headers = curl_slist_append(attempt->headers, ("If-Modified-Since: " + request.ifModifiedSince).c_str());
+    }
+    for (auto &header : request.headers) {
+        attempt->headers = curl_slist_append(attempt->headers, header.c_str());
+    }
+
+    CURL *easy = attempt->easy;
+    curl_easy_setopt(easy, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, attempt->headers);
+    curl_easy_setopt(easy, CURLOPT_AUTOREFERER, 1L);
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, ""); // every encoding curl supports
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, request.timeoutMs ? static_cast<long>(request.timeoutMs) : 30000L);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, writeCb);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &attempt->response);
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, headerCb);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, &attempt->response);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, attempt);
+
+    curl_multi_add_handle(m_multi, easy);
+}
+
+// the first success answers the request, a failure only when no other attempt is running
+void CurlMultiDownloader::finish(Attempt *attempt, CURLcode result)
+{
+    Transfer *transfer = attempt->transfer;
+    stop(attempt);
+    if (transfer->done) {
+        return;
+    }
+
+    if (result == CURLE_OK) {
+        curl_easy_getinfo(attempt->easy, CURLINFO_RESPONSE_CODE, &attempt->response.status);
+    } else {
+        std::cerr << "Download of " << transfer->request->url << " failed : "
+                  << curl_easy_strerror(result) << std::endl;
+    }
+
+    Attempt *other = transfer->attemptCount > 1 ? &transfer->attempts[attempt == &transfer->attempts[0]] : nullptr;
+    if (result != CURLE_OK && other && other->running) {
+        return;
+    }
+
+    transfer->done = true;
+    if (other) {
+        stop(other);
+    }
+    *transfer->response = std::move(attempt->response);
+    transfer->response->hedged = transfer->attemptCount > 1;
+    transfer->response->durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - transfer->start).count();
+}
+
+int CurlMultiDownloader::hedge(std::vector<Transfer> *transfers)
+{
+    auto now = std::chrono::steady_clock::now();
+    int next = -1;
+    for (auto &transfer : *transfers) {
+        if (transfer.done || transfer.attemptCount > 1 || transfer.request->hedgeAfterMs == 0) {
+            continue;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - transfer.start).count();
+        if (elapsed >= transfer.request->hedgeAfterMs) {
+            std::cerr << "Hedging " << transfer.request->url << std::endl;
+            start(&transfer);
+        } else {
+            int delay = transfer.request->hedgeAfterMs - elapsed;
+            next = next < 0 ? delay : std::min(next, delay);
+        }
+    }
+    return next;
+}
+
+void CurlMultiDownloader::stop(Attempt *attempt)
+{
+    if (attempt->running) {
+        curl_multi_remove_handle(m_multi, attempt->easy);
+        attempt->running = false;
+    }
+}
+
+size_t CurlMultiDownloader::writeCb(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    DownloadResponse *response = static_cast<DownloadResponse *>(userdata);
+    response->data.insert(end(response->data), ptr, ptr + size * nmemb);
+    return size * nmemb;
+}
+
+// keeps the validators of the last response, after the redirections
+size_t CurlMultiDownloader::headerCb(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    DownloadResponse *response = static_cast<DownloadResponse *>(userdata);
+    size_t length = size * nmemb;
+    auto value = [&](size_t nameLength) {
+        std::string v(ptr + nameLength, length - nameLength);
+        v.erase(0, v.find_first_not_of(" \t"));
+        v.erase(v.find_last_not_of(" \t\r\n") + 1);
+        return v;
+    };
+
+    if (length > 5 && strncasecmp(ptr, "HTTP/", 5) == 0) {
+        response->etag.clear();
+        response->lastModified.clear();
+    } else if (length > 5 && strncasecmp(ptr, "ETag:", 5) == 0) {
+        response->etag = value(5);
+    } else if (length > 14 && strncasecmp(ptr, "Last-Modified:", 14) == 0) {
+        response->lastModified = value(14);
+    }
+    return length;
+}
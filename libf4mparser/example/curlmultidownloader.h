@@ -0,0 +1,71 @@
+/*
+ example of Downloader using the curl multi interface, see main.cpp
+
+ The multi handle owns the connection cache : connections are kept alive between the
+ requests of a parse and between parses (the set-level and the stream-level manifests
+ of a multi-level manifest are usually on the same host). downloadAll runs the
+ requests concurrently.
+
+ A request with hedgeAfterMs gets a duplicate when it is still running after that
+ delay. The first successful answer is kept, the other transfer is abandoned.
+*/
+
+#ifndef CURLMULTIDOWNLOADER_H
+#define CURLMULTIDOWNLOADER_H
+
+#include <curl/curl.h>
+#include <chrono>
+#include "downloader.h"
+
+class CurlMultiDownloader : public Downloader
+{
+public:
+    // curl_global_init must have been called
+    explicit CurlMultiDownloader(long maxConnectionsPerHost = 6);
+    ~CurlMultiDownloader();
+
+    DownloadResponse download(const DownloadRequest &request) override;
+    void downloadAll(const std::vector<DownloadRequest> &requests,
+                     std::vector<DownloadResponse> *responses) override;
+
+    long connectionsOpened() const { return m_connectionsOpened; } // new connections, the others were reused
+
+private:
+    CurlMultiDownloader(const CurlMultiDownloader &) = delete;
+    CurlMultiDownloader& operator=(const CurlMultiDownloader &) = delete;
+
+    struct Transfer;
+
+    // one request sent, the original or its duplicate
+    struct Attempt {
+        Transfer *transfer;
+        CURL *easy;
+        struct curl_slist *headers;
+        DownloadResponse response;
+        bool running;
+    };
+
+    struct Transfer {
+        const DownloadRequest *request;
+        DownloadResponse *response;
+        std::chrono::steady_clock::time_point start;
+        Attempt attempts[2];
+        int attemptCount;
+        bool done;
+    };
+
+    CURL *takeHandle();
+    void start(Transfer *transfer);
+    void finish(Attempt *attempt, CURLcode result);
+    int hedge(std::vector<Transfer> *transfers); // the delay until the next hedge, or -1
+    void stop(Attempt *attempt);
+
+    static size_t writeCb(char *ptr, size_t size, size_t nmemb, void *userdata);
+    static size_t headerCb(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+    CURLM *m_multi;
+    std::vector<CURL *> m_idleHandles; // reset and reused
+    long m_connectionsOpened;
+};
+
+#endif // CURLMULTIDOWNLOADER_H
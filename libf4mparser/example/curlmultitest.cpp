@@ -0,0 +1,313 @@
+/*
+ test of CurlMultiDownloader against a local HTTP/1.1 server, 'make curltest' in ../src
+
+ The server runs in the test on 127.0.0.1, it serves a multi-level manifest, a document
+ with validators and a request which stalls. Checked :
+  - the connections are reused between the set-level and the stream-level fetches, and
+    between parses
+  - a request times out after its timeoutMs
+  - If-None-Match and If-Modified-Since get a 304 when the document did not change
+
+ Exits with 1 if a check failed.
+*/
+
+#include <curl/curl.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <strings.h> // strncasecmp
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "f4mparser.h"
+#include "curlmultidownloader.h"
+
+static const char *s_etag = "\"v1\"";
+static const char *s_lastModified = "Mon, 01 Jan 2024 00:00:00 GMT";
+static const int s_stallMs = 1500;
+
+// keep-alive HTTP/1.1 server, a thread per connection
+class TestServer
+{
+public:
+    TestServer() : m_listenFd(-1), m_port(0), m_connections(0) {}
+    ~TestServer() { stop(); }
+
+    bool start();
+    void stop();
+
+    int port() const { return m_port; }
+    int connections() const { return m_connections; } // accepted so far
+
+private:
+    void acceptLoop();
+    void serve(int fd);
+    std::string respond(const std::string &request, bool *close);
+
+    int m_listenFd;
+    int m_port;
+    std::atomic<int> m_connections;
+    std::thread m_acceptThread;
+    std::mutex m_mutex;
+    std::vector<int> m_clientFds;
+    std::vector<std::thread> m_clientThreads;
+};
+
+bool TestServer::start()
+{
+    m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listenFd < 0) {
+        return false;
+    }
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0; // any free port
+    socklen_t length = sizeof(addr);
+    if (bind(m_listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+            || listen(m_listenFd, 16) != 0
+            || getsockname(m_listenFd, reinterpret_cast<sockaddr *>(&addr), &length) != 0) {
+        close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    m_port = ntohs(addr.sin_port);
+    m_acceptThread = std::thread(&TestServer::acceptLoop, this);
+    return true;
+}
+
+void TestServer::stop()
+{
+    if (m_listenFd < 0) {
+        return;
+    }
+    // unblocks accept and recv
+    shutdown(m_listenFd, SHUT_RDWR);
+    m_acceptThread.join();
+    close(m_listenFd);
+    m_listenFd = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (int fd : m_clientFds) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    for (auto &thread : m_clientThreads) {
+        thread.join();
+    }
+    for (int fd : m_clientFds) {
+        close(fd);
+    }
+}
+
+void TestServer::acceptLoop()
+{
+    for (;;) {
+        int fd = accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        m_connections++;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_clientFds.push_back(fd);
+        m_clientThreads.emplace_back(&TestServer::serve, this, fd);
+    }
+}
+
+void TestServer::serve(int fd)
+{
+    std::string received;
+    char buffer[4096];
+    bool close = false;
+    while (!close) {
+        size_t end = received.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                return;
+            }
+            received.append(buffer, n);
+            continue;
+        }
+        // GET only, there is no body
+        std::string request = received.substr(0, end + 2);
+        received.erase(0, end + 4);
+        std::string response = respond(request, &close);
+        if (send(fd, response.data(), response.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(response.size())) {
+            return;
+        }
+    }
+    shutdown(fd, SHUT_RDWR);
+}
+
+// the value of the header 'name' of 'request', empty if it has none
+static std::string headerValue(const std::string &request, const std::string &name)
+{
+    size_t pos = request.find("\r\n");
+    while (pos != std::string::npos && pos + 2 < request.size()) {
+        size_t line = pos + 2;
+        pos = request.find("\r\n", line);
+        if (request.size() - line > name.size() && request[line + name.size()] == ':'
+                && strncasecmp(request.c_str() + line, name.c_str(), name.size()) == 0) {
+            size_t value = request.find_first_not_of(" \t", line + name.size() + 1);
+            return request.substr(value, pos - value);
+        }
+    }
+    return std::string();
+}
+
+std::string TestServer::respond(const std::string &request, bool *close)
+{
+    size_t pathBegin = request.find(' ') + 1;
+    std::string path = request.substr(pathBegin, request.find(' ', pathBegin) - pathBegin);
+    *close = strcasecmp(headerValue(request, "Connection").c_str(), "close") == 0;
+
+    std::string base = "http://127.0.0.1:" + std::to_string(m_port) + "/";
+    std::string status = "200 OK";
+    std::string headers;
+    std::string body;
+    if (path == "/set.f4m") {
+        body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<manifest xmlns=\"http://ns.adobe.com/f4m/2.0\">\n"
+               "  <baseURL>" + base + "</baseURL>\n"
+               "  <media href=\"s1.f4m\" bitrate=\"300\"/>\n"
+               "  <media href=\"s2.f4m\" bitrate=\"800\"/>\n"
+               "</manifest>\n";
+    } else if (path == "/s1.f4m" || path == "/s2.f4m") {
+        std::string id = path.substr(1, 2);
+        body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<manifest xmlns=\"http://ns.adobe.com/f4m/2.0\">\n"
+               "  <id>" + id + "</id><streamType>recorded</streamType>\n"
+               "  <bootstrapInfo profile=\"named\" id=\"b\">aGVsbG8=</bootstrapInfo>\n"
+               "  <media url=\"" + id + "\" bootstrapInfoId=\"b\"/>\n"
+               "</manifest>\n";
+    } else if (path == "/doc.f4m") {
+        headers = std::string("ETag: ") + s_etag + "\r\nLast-Modified: " + s_lastModified + "\r\n";
+        if (headerValue(request, "If-None-Match") == s_etag
+                || headerValue(request, "If-Modified-Since") == s_lastModified) {
+            status = "304 Not Modified";
+        } else {
+            body = "<manifest xmlns=\"http://ns.adobe.com/f4m/1.0\"/>\n";
+        }
+    } else if (path == "/stall.f4m") {
+        std::this_thread::sleep_for(std::chrono::milliseconds(s_stallMs));
+        body = "late";
+    } else {
+        status = "404 Not Found";
+    }
+
+    return "HTTP/1.1 " + status + "\r\n" + headers
+            + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            + (*close ? "Connection: close\r\n" : "") + "\r\n" + body;
+}
+
+static int s_failures = 0;
+
+static void check(bool ok, const std::string &what)
+{
+    std::cerr << (ok ? "ok     " : "FAILED ") << what << std::endl;
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+// the set-level manifest, then its two stream-level manifests in one batch
+static void testConnectionReuse(TestServer *server)
+{
+    CurlMultiDownloader downloader;
+    std::string url = "http://127.0.0.1:" + std::to_string(server->port()) + "/set.f4m";
+
+    Manifest manifest;
+    bool parsed = F4mParseManifest(&downloader, url, &manifest, ParseOptions());
+    check(parsed && manifest.medias.size() == 2, "multi-level manifest parsed");
+    long opened = downloader.connectionsOpened();
+    // the batch of two may open a second connection, the first one is reused
+    check(opened >= 1 && opened <= 2, "3 fetches on " + std::to_string(opened) + " connections");
+    check(server->connections() == opened, "the server accepted as many connections");
+
+    int accepted = server->connections();
+    Manifest again;
+    parsed = F4mParseManifest(&downloader, url, &again, ParseOptions());
+    check(parsed && again.medias.size() == 2, "multi-level manifest parsed again");
+    check(downloader.connectionsOpened() == opened && server->connections() == accepted,
+          "no new connection for the second parse");
+}
+
+static void testTimeout(TestServer *server)
+{
+    CurlMultiDownloader downloader;
+    std::string base = "http://127.0.0.1:" + std::to_string(server->port());
+
+    DownloadRequest request;
+    request.url = base + "/stall.f4m";
+    request.timeoutMs = 200;
+    auto start = std::chrono::steady_clock::now();
+    DownloadResponse response = downloader.download(request);
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+    check(response.status == -1, "a stalled request fails");
+    check(elapsedMs < s_stallMs, "it fails after its timeoutMs, in " + std::to_string(elapsedMs) + " ms");
+
+    request.url = base + "/s1.f4m";
+    request.timeoutMs = 0;
+    response = downloader.download(request);
+    check(response.status == 200, "the next request succeeds");
+}
+
+static void testConditionalRequests(TestServer *server)
+{
+    CurlMultiDownloader downloader;
+
+    DownloadRequest request;
+    request.url = "http://127.0.0.1:" + std::to_string(server->port()) + "/doc.f4m";
+    DownloadResponse response = downloader.download(request);
+    check(response.status == 200 && !response.data.empty(), "unconditional request gets 200");
+    check(response.etag == s_etag && response.lastModified == s_lastModified,
+          "the validators of the response are kept");
+
+    DownloadRequest ifNoneMatch = request;
+    ifNoneMatch.ifNoneMatch = response.etag;
+    DownloadResponse notModified = downloader.download(ifNoneMatch);
+    check(notModified.status == 304 && notModified.data.empty(), "If-None-Match gets 304");
+
+    DownloadRequest ifModifiedSince = request;
+    ifModifiedSince.ifModifiedSince = response.lastModified;
+    notModified = downloader.download(ifModifiedSince);
+    check(notModified.status == 304 && notModified.data.empty(), "If-Modified-Since gets 304");
+
+    ifNoneMatch.ifNoneMatch = "\"v0\"";
+    DownloadResponse modified = downloader.download(ifNoneMatch);
+    check(modified.status == 200 && !modified.data.empty(), "a stale If-None-Match gets 200");
+}
+
+int main()
+{
+    if (curl_global_init(CURL_GLOBAL_DEFAULT)) {
+        std::cerr << "Curl_global_init failed" << std::endl;
+        return 1;
+    }
+
+    TestServer server;
+    if (!server.start()) {
+        std::cerr << "can't start the server" << std::endl;
+        return 1;
+    }
+
+    // the connections are counted before the stalled request leaves one behind
+    testConnectionReuse(&server);
+    testConditionalRequests(&server);
+    testTimeout(&server);
+
+    server.stop();
+    curl_global_cleanup();
+
+    std::cerr << (s_failures ? "FAILED" : "passed") << std::endl;
+    return s_failures ? 1 : 0;
+}
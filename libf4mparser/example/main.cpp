@@ -1,59 +1,16 @@
 
 /*
- g++ main.cpp -I../src/f4mparser/ -std=c++11 $(pkg-config --libs --cflags libcurl) -o testProg -l:../src/libf4mparser.so
+ g++ main.cpp curlmultidownloader.cpp -I../src/f4mparser/ -std=c++11 $(pkg-config --libs --cflags libcurl) -o testProg -l:../src/libf4mparser.so
 */
 
 #include <curl/curl.h>
 #include <iostream>
 #include <vector>
 #include "f4mparser.h"
-
-// example of callback function using curl
-std::vector<uint8_t> downloadFile(void *, std::string url, long &status)
-{
-    std::cerr << "Downloading " << url << std::endl;
-
-    std::vector<uint8_t> response;
-
-    typedef size_t(*CURL_WRITEFUNCTION_PTR)(void*, size_t, size_t, void*);
-    auto curlWriteCb = [](void *ptr, size_t size, size_t nmemb, void *stream) -> size_t {
-        std::vector<uint8_t> *buffer = static_cast<std::vector<uint8_t> *>(stream);
-        buffer->insert(end(*buffer), static_cast<uint8_t *>(ptr), static_cast<uint8_t *>(ptr) + size * nmemb);
-        return size*nmemb;
-    };
-
-    struct curl_slist *headers = NULL;
-
-    headers = curl_slist_append(headers, "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
-    headers = curl_slist_append(headers, "Accept-Language: en-US,en;q=0.5");
-    headers = curl_slist_append(headers, "Connection: keep-alive");
-
-    status = -1;
-
-    CURL *process = curl_easy_init();
-    if (process) {
-        curl_easy_setopt(process, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(process, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(process, CURLOPT_HEADER, 0L);
-        curl_easy_setopt(process, CURLOPT_AUTOREFERER, 1L);
-        curl_easy_setopt(process, CURLOPT_TIMEOUT, 30L);
-        curl_easy_setopt(process, CURLOPT_WRITEFUNCTION, static_cast<CURL_WRITEFUNCTION_PTR>(curlWriteCb));
-        curl_easy_setopt(process, CURLOPT_WRITEDATA, &response);
-        curl_easy_setopt(process, CURLOPT_FOLLOWLOCATION, 1L);
-        curl_easy_perform(process);
-        curl_easy_getinfo(process, CURLINFO_RESPONSE_CODE, &status);
-        curl_easy_cleanup(process);
-    } else {
-        std::cerr << "curl_easy_init failed" << std::endl;
-    }
-
-    curl_slist_free_all(headers);
-
-    return response;
-}
+#include "curlmultidownloader.h"
 
 // retrieve bootstrapinfo from manifest
-bool bootstrapDataIsAvailable(BootstrapInfo &bootstrapInfo)
+bool bootstrapDataIsAvailable(Downloader &downloader, BootstrapInfo &bootstrapInfo)
 {
     if (!bootstrapInfo.data.empty()) {
         return true;
@@ -64,8 +21,11 @@ bool bootstrapDataIsAvailable(BootstrapInfo &bootstrapInfo)
     }
 
     // download it
-    long status;
-    bootstrapInfo.data = downloadFile(NULL, bootstrapInfo.url, status);
+    DownloadRequest request;
+    request.url = bootstrapInfo.url;
+    DownloadResponse response = downloader.download(request);
+    long status = response.status;
+    bootstrapInfo.data = std::move(response.data);
     if (status != 200) {
         std::cerr << __func__ << " http status " << status << std::endl;
         if (!bootstrapInfo.data.empty()) {
@@ -96,8 +56,16 @@ int main (int argc, char *argv[])
         return -1;
     }
 
+    // keeps the connections alive until the end
+    CurlMultiDownloader *downloader = new CurlMultiDownloader;
+
+    // retry the failed downloads, send a duplicate request when one is slow
+    ParseOptions options;
+    options.retry.maxRetries = 2;
+    options.retry.hedgeAfterMs = 1000;
+
     Manifest manifest;
-    if (!F4mParseManifest(NULL, downloadFile, url, &manifest)) {
+    if (!F4mParseManifest(downloader, url, &manifest, options)) {
         std::cerr << "Could not get/parse manifest" << std::endl;
     }
 
@@ -108,7 +76,7 @@ int main (int argc, char *argv[])
             std::cerr << std::endl;
             std::cerr << "bitrate " << media.bitrate << std::endl;
             std::cerr << "base url " << media.url << std::endl;
-            if (bootstrapDataIsAvailable(media.bootstrapInfo)) {
+            if (bootstrapDataIsAvailable(*downloader, media.bootstrapInfo)) {
                 std::cerr << "bootstrapinfo size " << media.bootstrapInfo.data.size() << std::endl;
             } else {
                 std::cerr << "no valid bootstrapinfo" << std::endl;
@@ -123,6 +91,9 @@ int main (int argc, char *argv[])
          std::cerr << "Couldn't find valid medias" << std::endl;
     }
 
+    std::cerr << std::endl << downloader->connectionsOpened() << " connections opened" << std::endl;
+    delete downloader;
+
     curl_global_cleanup();
 
     return 0;
@@ -0,0 +1,354 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+// Microbenchmarks for the parsing pipeline.
+//
+// Every document is served from memory, no network is involved.
+// Results are printed on stdout as one JSON document :
+// { "benchmarks" : [ { "name", "iterations", "bytes", "mean_ns", "min_ns", "p50_ns", "p99_ns", "mb_per_s" } ] }
+//
+// usage : f4mbench [-n iterations] [-f name_filter] [-d corpus_dir]
+//
+// The documents come from the corpus generator (f4mcorpus.h), '-d' adds a corpus written by f4mgen.
+
+#include "f4mparser.h"
+#include "manifestparser.h"
+#include "base64utils.h"
+#include "f4mcorpus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// access to the parse steps
+
+class ManifestParserBench
+{
+public:
+    // load the document and detect version and level, as parse() does
+    static bool prepare(ManifestParser *parser, const std::vector<uint8_t> &doc, const std::string &url) {
+        parser->m_f4mDoc.reset(new ManifestDoc{url});
+        if (!parser->m_f4mDoc->setXmlDoc(doc)) {
+            return false;
+        }
+        parser->setManifestVersion(parser->m_f4mDoc->rootNs());
+        parser->setManifestLevel();
+        return true;
+    }
+
+    static bool setXmlDoc(ManifestParser *parser, std::vector<uint8_t> doc) {
+        return parser->m_f4mDoc->setXmlDoc(std::move(doc));
+    }
+
+    static Manifest parseManifest(ManifestParser *parser) { return parser->parseManifest(); }
+    static void parseMedias(ManifestParser *parser, Manifest *m) { parser->parseMedias(m); }
+    static void parseAdaptiveSets(ManifestParser *parser, Manifest *m) { parser->parseAdaptiveSets(m); }
+    static void parseDvrInfos(ManifestParser *parser, Manifest *m) { parser->parseDvrInfos(m); }
+    static void parseDrmAdditionalHeaders(ManifestParser *parser, Manifest *m) { parser->parseDrmAdditionalHeaders(m); }
+    static void parseBootstrapInfos(ManifestParser *parser, Manifest *m) { parser->parseBootstrapInfos(m); }
+    static void parseSmpteTimeCodes(ManifestParser *parser, Manifest *m) { parser->parseSmpteTimeCodes(m); }
+    static void parseCueInfos(ManifestParser *parser, Manifest *m) { parser->parseCueInfos(m); }
+    static void parseBestEffortFetchInfos(ManifestParser *parser, Manifest *m) { parser->parseBestEffortFetchInfos(m); }
+    static void parseDrmAdditionalHeaderSets(ManifestParser *parser, Manifest *m) { parser->parseDrmAdditionalHeaderSets(m); }
+};
+
+// harness
+
+class BenchResult
+{
+public:
+    std::string name;
+    size_t bytes;
+    std::vector<double> samples; // ns
+};
+
+class BenchRunner
+{
+public:
+    BenchRunner(int iterations, const char *filter) : m_iterations(iterations), m_filter(filter) {}
+
+    // 'setup' runs before each iteration and is not timed
+    void run(const std::string &name, size_t bytes,
+             std::function<void()> setup, std::function<void()> op) {
+        if (m_filter && name.find(m_filter) == std::string::npos) {
+            return;
+        }
+        BenchResult result;
+        result.name = name;
+        result.bytes = bytes;
+        result.samples.reserve(m_iterations);
+
+        // warm up
+        setup();
+        op();
+
+        for (int i = 0; i < m_iterations; ++i) {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            op();
+            auto stop = std::chrono::steady_clock::now();
+            result.samples.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+        }
+        m_results.push_back(std::move(result));
+    }
+
+    void run(const std::string &name, size_t bytes, std::function<void()> op) {
+        run(name, bytes, [](){}, op);
+    }
+
+    void print() const {
+        printf("{\n  \"iterations\": %d,\n  \"benchmarks\": [", m_iterations);
+        for (size_t i = 0; i < m_results.size(); ++i) {
+            std::vector<double> s = m_results[i].samples;
+            std::sort(begin(s), end(s));
+            double sum = 0.;
+            for (double v : s) {
+                sum += v;
+            }
+            double mean = sum / s.size();
+            double p50 = s[s.size() / 2];
+            double p99 = s[std::min(s.size() - 1, s.size() * 99 / 100)];
+            double mbPerS = mean > 0. ? m_results[i].bytes / mean * 1e3 : 0.;
+            printf("%s\n    {\"name\": \"%s\", \"iterations\": %zu, \"bytes\": %zu, \"mean_ns\": %.0f,"
+                   " \"min_ns\": %.0f, \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"mb_per_s\": %.2f}",
+                   i ? "," : "", m_results[i].name.c_str(), s.size(), m_results[i].bytes,
+                   mean, s.front(), p50, p99, mbPerS);
+        }
+        printf("\n  ]\n}\n");
+    }
+
+private:
+    int m_iterations;
+    const char *m_filter;
+    std::vector<BenchResult> m_results;
+};
+
+// benchmarks
+
+static void benchSections(BenchRunner &runner, const std::string &prefix,
+                          const std::vector<uint8_t> &doc, const std::string &url)
+{
+    ManifestParser parser(nullptr, nullptr);
+    if (!ManifestParserBench::prepare(&parser, doc, url)) {
+        fprintf(stderr, "%s: can't load document\n", prefix.c_str());
+        return;
+    }
+
+    std::vector<uint8_t> copy;
+    runner.run(prefix + "/setXmlDoc", doc.size(),
+               [&]() { copy = doc; },
+               [&]() { ManifestParserBench::setXmlDoc(&parser, std::move(copy)); });
+    ManifestParserBench::prepare(&parser, doc, url);
+
+    runner.run(prefix + "/parseManifest", doc.size(),
+               [&]() { ManifestParserBench::parseManifest(&parser); });
+
+    // the sections which assign to medias start from the parsed medias
+    Manifest withMedias;
+    withMedias.baseURL = ManifestParserBench::parseManifest(&parser).baseURL;
+    ManifestParserBench::parseMedias(&parser, &withMedias);
+    ManifestParserBench::parseAdaptiveSets(&parser, &withMedias);
+
+    Manifest m;
+    auto reset = [&]() { m = withMedias; };
+    typedef void (*SECTION)(ManifestParser *, Manifest *);
+    const std::pair<const char *, SECTION> sections[] = {
+        {"parseMedias", ManifestParserBench::parseMedias},
+        {"parseAdaptiveSets", ManifestParserBench::parseAdaptiveSets},
+        {"parseDvrInfos", ManifestParserBench::parseDvrInfos},
+        {"parseDrmAdditionalHeaders", ManifestParserBench::parseDrmAdditionalHeaders},
+        {"parseBootstrapInfos", ManifestParserBench::parseBootstrapInfos},
+        {"parseSmpteTimeCodes", ManifestParserBench::parseSmpteTimeCodes},
+        {"parseCueInfos", ManifestParserBench::parseCueInfos},
+        {"parseBestEffortFetchInfos", ManifestParserBench::parseBestEffortFetchInfos},
+        {"parseDrmAdditionalHeaderSets", ManifestParserBench::parseDrmAdditionalHeaderSets},
+    };
+    for (const auto &section : sections) {
+        SECTION fct = section.second;
+        if (fct == ManifestParserBench::parseMedias || fct == ManifestParserBench::parseAdaptiveSets) {
+            runner.run(prefix + "/" + section.first, doc.size(),
+                       [&]() { m = Manifest(); m.baseURL = withMedias.baseURL; },
+                       [&]() { fct(&parser, &m); });
+        } else {
+            runner.run(prefix + "/" + section.first, doc.size(), reset, [&]() { fct(&parser, &m); });
+        }
+    }
+}
+
+static void benchEndToEnd(BenchRunner &runner, const std::string &name, Corpus *corpus)
+{
+    Manifest manifest;
+    runner.run(name, corpus->totalBytes(), [&]() { manifest = Manifest(); }, [&]() {
+        if (!F4mParseManifest(corpus, corpusDownload, corpus->manifestUrl, &manifest)) {
+            fprintf(stderr, "%s: parse failed\n", name.c_str());
+        }
+    });
+}
+
+// same with the instrumentation on, the difference is its overhead
+static void benchEndToEndWithStats(BenchRunner &runner, const std::string &name, Corpus *corpus)
+{
+    Manifest manifest;
+    ParseStats stats;
+    runner.run(name, corpus->totalBytes(), [&]() { manifest = Manifest(); }, [&]() {
+        if (!F4mParseManifest(corpus, corpusDownload, corpus->manifestUrl, &manifest, &stats)) {
+            fprintf(stderr, "%s: parse failed\n", name.c_str());
+        }
+    });
+}
+
+// the same parser for every iteration : its document memory is reused
+static void benchPooled(BenchRunner &runner, const std::string &name, Corpus *corpus)
+{
+    ParserPool pool(1);
+    CallbackDownloader downloader(corpus, corpusDownload);
+    Manifest manifest;
+    runner.run(name, corpus->totalBytes(), [&]() { manifest = Manifest(); }, [&]() {
+        if (!pool.parse(&downloader, corpus->manifestUrl, &manifest)) {
+            fprintf(stderr, "%s: parse failed\n", name.c_str());
+        }
+    });
+}
+
+// the bitrate-discovery use case : only the media attributes are read
+class MediaCounter : public ManifestVisitor
+{
+public:
+    MediaCounter() : medias{0} {}
+    Action onMedia(const Media &, int) override { medias++; return SKIP; }
+    size_t medias;
+};
+
+static void benchVisit(BenchRunner &runner, const std::string &name, Corpus *corpus)
+{
+    MediaCounter counter;
+    runner.run(name, corpus->totalBytes(), [&]() { counter.medias = 0; }, [&]() {
+        if (!F4mVisitManifest(corpus, corpusDownload, corpus->manifestUrl, &counter)) {
+            fprintf(stderr, "%s: visit failed\n", name.c_str());
+        }
+    });
+}
+
+static void benchCorpus(BenchRunner &runner, const std::string &name, const CorpusParams &params)
+{
+    Corpus corpus;
+    generateCorpus(params, &corpus);
+    benchSections(runner, name, corpus.files[corpus.manifestUrl], corpus.manifestUrl);
+    benchEndToEnd(runner, "F4mParseManifest/" + name, &corpus);
+    benchEndToEndWithStats(runner, "F4mParseManifest+stats/" + name, &corpus);
+    benchPooled(runner, "ParserPool/" + name, &corpus);
+    benchVisit(runner, "F4mVisitManifest/" + name, &corpus);
+}
+
+static void benchBase64(BenchRunner &runner, size_t size)
+{
+    std::vector<uint8_t> raw(size);
+    for (size_t i = 0; i < size; ++i) {
+        raw[i] = static_cast<uint8_t>(i * 131);
+    }
+    std::string encoded = Base64Utils::encode(raw);
+    std::string suffix = "/" + std::to_string(size);
+
+    runner.run("base64/decode" + suffix, encoded.size(), [&]() { Base64Utils::decode(encoded); });
+    runner.run("base64/encode" + suffix, raw.size(), [&]() { Base64Utils::encode(raw); });
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = 200;
+    const char *filter = nullptr;
+    const char *corpusDir = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            iterations = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            corpusDir = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-n iterations] [-f name_filter] [-d corpus_dir]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    BenchRunner runner(iterations, filter);
+
+    CorpusParams v1;
+    v1.version = 1;
+    benchCorpus(runner, "v1", v1);
+
+    CorpusParams v3;
+    v3.cueCount = 500;
+    v3.timecodeCount = 2000;
+    benchCorpus(runner, "v3", v3);
+
+    CorpusParams v2mlm;
+    v2mlm.version = 2;
+    v2mlm.multiLevel = true;
+    benchCorpus(runner, "v2mlm", v2mlm);
+
+    // production scale
+    CorpusParams v3large;
+    v3large.mediaCount = 200;
+    v3large.adaptiveSetCount = 8;
+    v3large.adaptiveSetMediaCount = 16;
+    v3large.cueCount = 5000;
+    v3large.timecodeCount = 10000;
+    v3large.drmHeaderCount = 64;
+    benchCorpus(runner, "v3large", v3large);
+
+    // every media gets its own decoded copy of the bootstrap
+    CorpusParams v3bootstrap;
+    v3bootstrap.mediaCount = 4;
+    v3bootstrap.bootstrapBytes = 4 * 1024 * 1024;
+    benchCorpus(runner, "v3bootstrap", v3bootstrap);
+
+    CorpusParams v3mlmDeep;
+    v3mlmDeep.multiLevel = true;
+    v3mlmDeep.mediaCount = 100;
+    v3mlmDeep.hrefDepth = 4;
+    benchCorpus(runner, "v3mlmdeep", v3mlmDeep);
+
+    if (corpusDir) {
+        Corpus corpus;
+        if (!readCorpus(corpusDir, &corpus)) {
+            fprintf(stderr, "can't read corpus from %s\n", corpusDir);
+            return -1;
+        }
+        benchSections(runner, "corpus", corpus.files[corpus.manifestUrl], corpus.manifestUrl);
+        benchEndToEnd(runner, "F4mParseManifest/corpus", &corpus);
+    }
+
+    benchBase64(runner, 4 * 1024);
+    benchBase64(runner, 1024 * 1024);
+
+    runner.print();
+
+    return 0;
+}
@@ -0,0 +1,266 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "f4mcorpus.h"
+
+#include "base64utils.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
+
+static std::string base64Blob(size_t size, unsigned seed)
+{
+    std::vector<uint8_t> raw(size);
+    uint32_t state = seed * 2654435761u + 1;
+    for (size_t i = 0; i < size; ++i) {
+        state = state * 1664525u + 1013904223u;
+        raw[i] = static_cast<uint8_t>(state >> 24);
+    }
+    return Base64Utils::encode(raw);
+}
+
+static std::string num(long value)
+{
+    return std::to_string(value);
+}
+
+static std::string header(int version, const std::string &extra)
+{
+    std::string doc = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<manifest xmlns=\"http://ns.adobe.com/f4m/" + num(version) + ".0\"";
+    if (version >= 3) {
+        doc += " version=\"3.0\"";
+    }
+    return doc + extra + ">\n";
+}
+
+static void appendBootstrap(const CorpusParams &params, std::string *doc)
+{
+    *doc += "  <bootstrapInfo profile=\"named\" id=\"boot\"";
+    if (params.version >= 3) {
+        *doc += " fragmentDuration=\"4\" segmentDuration=\"20\"";
+    }
+    *doc += ">" + base64Blob(params.bootstrapBytes, 1) + "</bootstrapInfo>\n";
+}
+
+static void appendStreamLevelSections(const CorpusParams &params, std::string *doc)
+{
+    appendBootstrap(params, doc);
+    *doc += "  <drmAdditionalHeader id=\"drm\">" + base64Blob(256, 2) + "</drmAdditionalHeader>\n";
+
+    if (params.version < 3) {
+        return;
+    }
+
+    *doc += "  <drmAdditionalHeaderSet id=\"drmset\">\n";
+    for (int i = 0; i < params.drmHeaderCount; ++i) {
+        *doc += "    <drmAdditionalHeader id=\"h" + num(i) + "\" startTimestamp=\"" + num(600 * i)
+                + "\" prefetchDeadline=\"" + num(600 * i - 30) + "\">" + base64Blob(256, 3 + i)
+                + "</drmAdditionalHeader>\n";
+    }
+    *doc += "  </drmAdditionalHeaderSet>\n";
+
+    *doc += "  <cueInfo id=\"cues\">\n";
+    for (int i = 0; i < params.cueCount; ++i) {
+        *doc += "    <cue id=\"c" + num(i) + "\" type=\"spliceOut\" time=\"" + num(30 * i)
+                + ".5\" duration=\"15.0\" availNum=\"" + num(i + 1) + "\" availsExpected=\""
+                + num(params.cueCount) + "\" programId=\"p" + num(i / 10) + "\"/>\n";
+    }
+    *doc += "  </cueInfo>\n";
+
+    *doc += "  <smpteTimecodes>\n";
+    for (int i = 0; i < params.timecodeCount; ++i) {
+        char smpte[32];
+        snprintf(smpte, sizeof(smpte), "%02d:%02d:%02d:%02d", i / 3600 % 24, i / 60 % 60, i % 60, i % 25);
+        *doc += "    <smpteTimecode smpte=\"" + std::string(smpte) + "\" timestamp=\"" + num(i)
+                + ".04\" date=\"2013-09-23\" timezone=\"+02:00\"/>\n";
+    }
+    *doc += "  </smpteTimecodes>\n";
+}
+
+// attributes only legal in a single-level or a set-level manifest
+static std::string renditionAttrs(const CorpusParams &params, int i)
+{
+    std::string attrs = " bitrate=\"" + num(300 + 250 * i) + "\" width=\"" + num(320 + 64 * i)
+            + "\" height=\"" + num(180 + 36 * i) + "\" streamId=\"s" + num(i) + "\"";
+    if (params.version >= 3) {
+        attrs += " videoCodec=\"avc1.4d401f\" type=\"video\"";
+    }
+    return attrs;
+}
+
+static std::string mediaElement(const CorpusParams &params, int i, const std::string &attrs)
+{
+    std::string media = "  <media url=\"stream" + num(i) + "\" bootstrapInfoId=\"boot\"" + attrs;
+    if (params.version == 1) {
+        media += " dvrInfoId=\"dvr\" drmAdditionalHeaderId=\"drm\"";
+    } else if (params.version >= 3) {
+        media += " cueInfoId=\"cues\" drmAdditionalHeaderSetId=\"drmset\"";
+    }
+    media += ">\n    <metadata>" + base64Blob(params.metadataBytes, 10 + i) + "</metadata>\n";
+    if (params.version == 1) {
+        media += "    <moov>" + base64Blob(params.metadataBytes, 20 + i) + "</moov>\n"
+                "    <xmpMetadata>" + base64Blob(params.metadataBytes / 2, 30 + i) + "</xmpMetadata>\n";
+    }
+    return media + "  </media>\n";
+}
+
+static void appendDvrInfo(const CorpusParams &params, std::string *doc)
+{
+    if (params.version == 1) {
+        *doc += "  <dvrInfo id=\"dvr\" beginOffset=\"0\" endOffset=\"3600\"/>\n";
+    } else {
+        *doc += "  <dvrInfo windowDuration=\"7200\"/>\n";
+    }
+}
+
+static void appendAdaptiveSets(const CorpusParams &params, std::string *doc)
+{
+    if (params.version < 3) {
+        return;
+    }
+    for (int s = 0; s < params.adaptiveSetCount; ++s) {
+        *doc += "  <adaptiveSet alternate=\"true\" type=\"audio\" lang=\"l" + num(s)
+                + "\" label=\"audio " + num(s) + "\" audioCodec=\"mp4a.40.2\">\n";
+        for (int i = 0; i < params.adaptiveSetMediaCount; ++i) {
+            *doc += "    <media url=\"audio" + num(s) + "_" + num(i) + "\" bitrate=\"" + num(64 * (i + 1))
+                    + "\"><metadata>" + base64Blob(params.metadataBytes / 4, 40 + i) + "</metadata></media>\n";
+        }
+        *doc += "  </adaptiveSet>\n";
+    }
+}
+
+static std::vector<uint8_t> toBuffer(const std::string &str)
+{
+    return std::vector<uint8_t>(str.begin(), str.end());
+}
+
+size_t Corpus::totalBytes() const
+{
+    size_t bytes = 0;
+    for (const auto &file : files) {
+        bytes += file.second.size();
+    }
+    return bytes;
+}
+
+void generateCorpus(const CorpusParams &params, Corpus *corpus)
+{
+    corpus->files.clear();
+    corpus->manifestUrl = params.baseUrl + "manifest.f4m";
+
+    std::string doc = header(params.version, "");
+    doc += "  <id>corpus</id>\n  <streamType>live</streamType>\n  <deliveryType>streaming</deliveryType>\n"
+            "  <duration>0</duration>\n";
+
+    if (params.multiLevel && params.version >= 2) {
+        std::string dir;
+        for (int d = 0; d < params.hrefDepth; ++d) {
+            dir += "d" + num(d) + "/";
+        }
+        appendDvrInfo(params, &doc);
+        if (params.version >= 3) {
+            doc += "  <bestEffortFetchInfo fragmentDuration=\"4\" segmentDuration=\"20\"/>\n";
+        }
+        for (int i = 0; i < params.mediaCount; ++i) {
+            std::string href = dir + "stream" + num(i) + ".f4m";
+            doc += "  <media href=\"" + href + "\"" + renditionAttrs(params, i) + "/>\n";
+
+            std::string stream = header(params.version, "");
+            stream += "  <id>stream" + num(i) + "</id>\n  <streamType>live</streamType>\n";
+            appendStreamLevelSections(params, &stream);
+            stream += mediaElement(params, i, "");
+            stream += "</manifest>\n";
+            corpus->files[params.baseUrl + href] = toBuffer(stream);
+        }
+    } else {
+        appendStreamLevelSections(params, &doc);
+        appendDvrInfo(params, &doc);
+        for (int i = 0; i < params.mediaCount; ++i) {
+            doc += mediaElement(params, i, renditionAttrs(params, i));
+        }
+        appendAdaptiveSets(params, &doc);
+    }
+
+    doc += "</manifest>\n";
+    corpus->files[corpus->manifestUrl] = toBuffer(doc);
+}
+
+bool writeCorpus(const Corpus &corpus, const std::string &dir)
+{
+    mkdir(dir.c_str(), 0755);
+
+    std::ofstream index(dir + "/corpus.idx");
+    index << "manifest " << corpus.manifestUrl << "\n";
+
+    int n = 0;
+    for (const auto &file : corpus.files) {
+        std::string name = "doc" + num(n++) + ".f4m";
+        std::ofstream out(dir + "/" + name, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(file.second.data()), file.second.size());
+        if (!out) {
+            return false;
+        }
+        index << name << " " << file.first << "\n";
+    }
+
+    return static_cast<bool>(index);
+}
+
+bool readCorpus(const std::string &dir, Corpus *corpus)
+{
+    std::ifstream index(dir + "/corpus.idx");
+    std::string key;
+    if (!(index >> key >> corpus->manifestUrl) || key != "manifest") {
+        return false;
+    }
+
+    corpus->files.clear();
+    std::string name, url;
+    while (index >> name >> url) {
+        std::ifstream in(dir + "/" + name, std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        if (!in) {
+            return false;
+        }
+        corpus->files[url] = toBuffer(ss.str());
+    }
+
+    return corpus->files.count(corpus->manifestUrl) == 1;
+}
+
+std::vector<uint8_t> corpusDownload(void *corpus, std::string url, long &httpStatusCode)
+{
+    const Corpus *c = static_cast<const Corpus *>(corpus);
+    auto it = c->files.find(url);
+    if (it == c->files.end()) {
+        httpStatusCode = 404;
+        return std::vector<uint8_t>();
+    }
+    httpStatusCode = 200;
+    return it->second;
+}
@@ -0,0 +1,74 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#ifndef F4MCORPUS_H
+#define F4MCORPUS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Synthetic f4m documents for scale testing, and a download function serving them.
+
+class CorpusParams
+{
+public:
+    CorpusParams() : version{3}, multiLevel{false}, mediaCount{8}, adaptiveSetCount{1},
+        adaptiveSetMediaCount{4}, cueCount{100}, timecodeCount{100}, drmHeaderCount{4},
+        bootstrapBytes{16 * 1024}, metadataBytes{512}, hrefDepth{0},
+        baseUrl{"http://corpus.local/"} {}
+
+    int version; ///< 1, 2 or 3
+    bool multiLevel; ///< a set-level manifest and one stream-level manifest per media. F4M 2.0 and 3.0
+    int mediaCount;
+    int adaptiveSetCount; ///< F4M 3.0
+    int adaptiveSetMediaCount; ///< F4M 3.0
+    int cueCount; ///< F4M 3.0
+    int timecodeCount; ///< F4M 3.0
+    int drmHeaderCount; ///< in the drmAdditionalHeaderSet, F4M 3.0
+    size_t bootstrapBytes; ///< size of the raw inlined bootstrap
+    size_t metadataBytes; ///< size of the raw metadata of each media
+    int hrefDepth; ///< number of directories between the set-level and the stream-level manifests
+    std::string baseUrl; ///< url of the directory holding the documents, ends with '/'
+};
+
+class Corpus
+{
+public:
+    std::string manifestUrl; ///< the document to parse
+    std::map<std::string, std::vector<uint8_t>> files; ///< every document by url
+
+    size_t totalBytes() const;
+};
+
+void generateCorpus(const CorpusParams &params, Corpus *corpus);
+
+// write the documents under 'dir', with an index 'corpus.idx' mapping urls to files
+bool writeCorpus(const Corpus &corpus, const std::string &dir);
+bool readCorpus(const std::string &dir, Corpus *corpus);
+
+// DOWNLOAD_FILE_FUNCTION, the user pointer is a const Corpus*
+std::vector<uint8_t> corpusDownload(void *corpus, std::string url, long &httpStatusCode);
+
+#endif // F4MCORPUS_H
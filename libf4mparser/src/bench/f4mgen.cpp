@@ -0,0 +1,108 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+// Write a synthetic f4m corpus to a directory, to be read back by 'f4mbench -d dir'.
+//
+// usage : f4mgen -o dir [-v version] [-mlm] [-m medias] [-a adaptiveSets] [-am medias per adaptiveSet]
+//                [-c cues] [-t timecodes] [-drm headers] [-b bootstrap bytes] [-md metadata bytes]
+//                [-depth href depth] [-base base url]
+
+#include "f4mcorpus.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s -o dir [-v version] [-mlm] [-m medias] [-a adaptiveSets]"
+            " [-am medias per adaptiveSet] [-c cues] [-t timecodes] [-drm headers]"
+            " [-b bootstrap bytes] [-md metadata bytes] [-depth href depth] [-base base url]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    CorpusParams params;
+    std::string dir;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *opt = argv[i];
+        if (!strcmp(opt, "-mlm")) {
+            params.multiLevel = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return -1;
+        }
+        const char *value = argv[++i];
+        if (!strcmp(opt, "-o")) {
+            dir = value;
+        } else if (!strcmp(opt, "-v")) {
+            params.version = atoi(value);
+        } else if (!strcmp(opt, "-m")) {
+            params.mediaCount = atoi(value);
+        } else if (!strcmp(opt, "-a")) {
+            params.adaptiveSetCount = atoi(value);
+        } else if (!strcmp(opt, "-am")) {
+            params.adaptiveSetMediaCount = atoi(value);
+        } else if (!strcmp(opt, "-c")) {
+            params.cueCount = atoi(value);
+        } else if (!strcmp(opt, "-t")) {
+            params.timecodeCount = atoi(value);
+        } else if (!strcmp(opt, "-drm")) {
+            params.drmHeaderCount = atoi(value);
+        } else if (!strcmp(opt, "-b")) {
+            params.bootstrapBytes = strtoul(value, nullptr, 10);
+        } else if (!strcmp(opt, "-md")) {
+            params.metadataBytes = strtoul(value, nullptr, 10);
+        } else if (!strcmp(opt, "-depth")) {
+            params.hrefDepth = atoi(value);
+        } else if (!strcmp(opt, "-base")) {
+            params.baseUrl = value;
+            if (params.baseUrl.empty() || params.baseUrl.back() != '/') {
+                params.baseUrl += '/';
+            }
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (dir.empty() || params.version < 1 || params.version > 3) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    Corpus corpus;
+    generateCorpus(params, &corpus);
+    if (!writeCorpus(corpus, dir)) {
+        fprintf(stderr, "can't write corpus to %s\n", dir.c_str());
+        return -1;
+    }
+
+    fprintf(stderr, "%zu documents, %zu bytes, manifest %s\n",
+            corpus.files.size(), corpus.totalBytes(), corpus.manifestUrl.c_str());
+
+    return 0;
+}
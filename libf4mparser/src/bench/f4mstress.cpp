@@ -0,0 +1,266 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+// Multi-threaded stress test of the library.
+//
+// Threads parse the same documents at once through the F4mParseManifest functions,
+// a shared ParserPool and a shared ManifestResolver, and compare every result with
+// the one of a single-threaded parse. The diagnostics are enabled so that every thread
+// reports to their queue.
+//
+// usage : f4mstress [-t threads] [-n iterations]
+//
+// Exits with 1 at the end if any result differed. 'make tsan' runs it under ThreadSanitizer.
+
+#include "f4mparser.h"
+#include "f4mcorpus.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// one document and the result of its single-threaded parse
+
+class StressCase
+{
+public:
+    std::string name;
+    std::string url;
+    ParseOptions options;
+    bool parsed;
+    ParseOptions::Error error;
+    Manifest manifest;
+    std::vector<uint8_t> serialized;
+};
+
+class CountingSink : public DiagnosticSink
+{
+public:
+    CountingSink() : events(0) {}
+
+    void write(const DiagEvent &) override { events++; }
+
+    std::atomic<uint64_t> events;
+};
+
+class Stress
+{
+public:
+    Stress() : pool(4), failures(0), parses(0) {}
+
+    Corpus corpus; // the documents of every case, served by corpusDownload
+    std::vector<StressCase> cases;
+    ParserPool pool;
+    std::atomic<uint64_t> failures;
+    std::atomic<uint64_t> parses;
+
+    void addCase(const std::string &name, CorpusParams params, const ParseOptions &options);
+    void addBrokenCase(const std::string &name);
+    void run(int threadCount, int iterations, ManifestResolver *resolver);
+
+private:
+    void check(const StressCase &c, const char *mode, bool parsed, ParseOptions::Error error,
+               const Manifest &manifest);
+    void runThread(int thread, int iterations, ManifestResolver *resolver);
+};
+
+void Stress::addCase(const std::string &name, CorpusParams params, const ParseOptions &options)
+{
+    params.baseUrl = "http://corpus.local/" + name + "/";
+    Corpus generated;
+    generateCorpus(params, &generated);
+    for (auto &file : generated.files) {
+        corpus.files[file.first] = file.second;
+    }
+
+    StressCase c;
+    c.name = name;
+    c.url = generated.manifestUrl;
+    c.options = options;
+    cases.push_back(c);
+}
+
+// a truncated document, every parse fails with a warning
+void Stress::addBrokenCase(const std::string &name)
+{
+    CorpusParams params;
+    params.baseUrl = "http://corpus.local/" + name + "/";
+    Corpus generated;
+    generateCorpus(params, &generated);
+    std::vector<uint8_t> document = generated.files[generated.manifestUrl];
+    document.resize(document.size() / 2);
+    corpus.files[generated.manifestUrl] = document;
+
+    StressCase c;
+    c.name = name;
+    c.url = generated.manifestUrl;
+    cases.push_back(c);
+}
+
+void Stress::check(const StressCase &c, const char *mode, bool parsed, ParseOptions::Error error,
+                   const Manifest &manifest)
+{
+    parses++;
+    bool same = parsed == c.parsed && error == c.error
+            && (!parsed || F4mSerializeManifest(manifest) == c.serialized);
+    if (!same) {
+        failures++;
+        fprintf(stderr, "%s : %s result differs from the single-threaded parse\n", c.name.c_str(), mode);
+    }
+}
+
+void Stress::runThread(int thread, int iterations, ManifestResolver *resolver)
+{
+    CallbackDownloader downloader(&corpus, corpusDownload);
+    ParseStats stats;
+
+    for (int i = 0; i < iterations; i++) {
+        const StressCase &c = cases[(thread + i) % cases.size()];
+        ParseOptions options = c.options;
+        ParseOptions::Error error = ParseOptions::ERROR_NONE;
+        options.stats = &stats;
+        options.error = &error;
+        Manifest manifest;
+        bool parsed;
+
+        switch (i % 5) {
+        case 0:
+            parsed = F4mParseManifest(&corpus, corpusDownload, c.url, &manifest, options);
+            check(c, "F4mParseManifest", parsed, error, manifest);
+            break;
+        case 1:
+            parsed = pool.parse(&downloader, c.url, &manifest, options);
+            check(c, "ParserPool::parse", parsed, error, manifest);
+            break;
+        case 2: {
+            const std::vector<uint8_t> &document = corpus.files.at(c.url);
+            parsed = pool.parseBuffer(&downloader, document.data(), document.size(), c.url,
+                                      &manifest, options);
+            check(c, "ParserPool::parseBuffer", parsed, error, manifest);
+            break;
+        }
+        case 3: {
+            ManifestChangeSet changes;
+            parsed = pool.refresh(&downloader, c.url, c.manifest, &manifest, &changes, options);
+            check(c, "ParserPool::refresh", parsed, error, manifest);
+            if (parsed && !changes.empty()) {
+                failures++;
+                fprintf(stderr, "%s : refresh of an unchanged document reports changes\n", c.name.c_str());
+            }
+            break;
+        }
+        default:
+            // the resolver is shared by cases with different options, only the default ones are compared
+            if (c.options.limits.maxNodes == 0 && c.options.limits.maxSubRequests == 0) {
+                parsed = resolver->parse(c.url, &manifest, &error);
+                check(c, "ManifestResolver::parse", parsed, error, manifest);
+            }
+            break;
+        }
+    }
+}
+
+void Stress::run(int threadCount, int iterations, ManifestResolver *resolver)
+{
+    for (auto &c : cases) {
+        ParseOptions options = c.options;
+        c.error = ParseOptions::ERROR_NONE;
+        options.error = &c.error;
+        c.parsed = F4mParseManifest(&corpus, corpusDownload, c.url, &c.manifest, options);
+        if (c.parsed) {
+            c.serialized = F4mSerializeManifest(c.manifest);
+        }
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back(&Stress::runThread, this, t, iterations, resolver);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int threadCount = std::max(2u, std::thread::hardware_concurrency());
+    int iterations = 200;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            threadCount = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            iterations = std::max(1, atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "usage: %s [-t threads] [-n iterations]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    CountingSink sink;
+    F4mEnableDiagnostics(&sink, DiagEvent::DIAG_WARNING);
+
+    Stress stress;
+
+    CorpusParams v1;
+    v1.version = 1;
+    stress.addCase("v1", v1, ParseOptions());
+
+    stress.addCase("v3", CorpusParams(), ParseOptions());
+
+    CorpusParams v2mlm;
+    v2mlm.version = 2;
+    v2mlm.multiLevel = true;
+    stress.addCase("v2mlm", v2mlm, ParseOptions());
+
+    CorpusParams v3mlm;
+    v3mlm.multiLevel = true;
+    v3mlm.hrefDepth = 2;
+    stress.addCase("v3mlm", v3mlm, ParseOptions());
+
+    ParseOptions fewNodes;
+    fewNodes.limits.maxNodes = 50;
+    stress.addCase("v3limited", CorpusParams(), fewNodes);
+
+    ParseOptions fewRequests;
+    fewRequests.limits.maxSubRequests = 2;
+    stress.addCase("v3mlmlimited", v3mlm, fewRequests);
+
+    stress.addBrokenCase("broken");
+
+    ManifestResolver resolver(&stress.corpus, corpusDownload, ParseOptions());
+    stress.run(threadCount, iterations, &resolver);
+
+    F4mDisableDiagnostics();
+
+    printf("%d threads, %llu parses, %llu failures, %llu diagnostics, %llu coalesced parses\n",
+           threadCount, (unsigned long long)stress.parses, (unsigned long long)stress.failures,
+           (unsigned long long)sink.events, (unsigned long long)resolver.coalescedParses());
+
+    return stress.failures == 0 ? 0 : 1;
+}
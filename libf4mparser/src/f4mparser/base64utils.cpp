@@ -176,4 +176,56 @@ std::string encode(const std::vector<uint8_t> &input)
     return base64_encode(input);
 }
 
+size_t decodedSize(const char *text)
+{
+    size_t count = 0;
+    for (; *text != '\0'; text++) {
+        unsigned char c = *text;
+        if (isspace(c)) {
+            continue;
+        }
+        if (c == '=' || !is_base64(c)) {
+            break;
+        }
+        count++;
+    }
+    return count / 4 * 3 + (count % 4 ? count % 4 - 1 : 0);
+}
+
+// next character of the text which is not a space, '\0' at the end
+static inline char next_char(const char **text) {
+    while (isspace(static_cast<unsigned char>(**text))) {
+        (*text)++;
+    }
+    return **text == '\0' ? '\0' : *(*text)++;
+}
+
+bool matches(const char *text, const std::vector<uint8_t> &data)
+{
+    const uint8_t *bytes = data.data();
+    size_t remaining = data.size();
+    char expected[4];
+
+    while (remaining > 0) {
+        uint8_t b0 = bytes[0];
+        uint8_t b1 = remaining > 1 ? bytes[1] : 0;
+        uint8_t b2 = remaining > 2 ? bytes[2] : 0;
+        expected[0] = base64_chars[(b0 & 0xfc) >> 2];
+        expected[1] = base64_chars[((b0 & 0x03) << 4) + ((b1 & 0xf0) >> 4)];
+        expected[2] = remaining > 1 ? base64_chars[((b1 & 0x0f) << 2) + ((b2 & 0xc0) >> 6)] : '=';
+        expected[3] = remaining > 2 ? base64_chars[b2 & 0x3f] : '=';
+
+        for (int i = 0; i < 4; i++) {
+            if (next_char(&text) != expected[i]) {
+                return false;
+            }
+        }
+        size_t consumed = remaining > 3 ? 3 : remaining;
+        bytes += consumed;
+        remaining -= consumed;
+    }
+
+    return next_char(&text) == '\0';
+}
+
 } // namespace Base64Utils
@@ -33,6 +33,12 @@ namespace Base64Utils
     std::vector<uint8_t> decode(const std::string& input);
 
     std::string encode(const std::vector<uint8_t>& input);
+
+    // size decode() would return for this text, whitespace skipped
+    size_t decodedSize(const char *text);
+
+    // true if the text, whitespace skipped, is the encoding of data, nothing is allocated
+    bool matches(const char *text, const std::vector<uint8_t> &data);
 }
 
 #endif // BASE64UTILS_H
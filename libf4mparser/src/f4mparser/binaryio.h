@@ -0,0 +1,223 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#ifndef BINARYIO_H
+#define BINARYIO_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring> // memcpy
+
+// little-endian writer/reader used by the binary manifest format
+// the reader never copies on its own : strings and blobs are returned as pointer + size
+
+class BinaryWriter
+{
+public:
+    explicit BinaryWriter(std::vector<uint8_t> *out) : m_out(out) {}
+
+    void writeU8(uint8_t value) { m_out->push_back(value); }
+
+    void writeU16(uint16_t value) {
+        m_out->push_back(static_cast<uint8_t>(value));
+        m_out->push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    void writeU32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            m_out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void writeU64(uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            m_out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void writeI32(int32_t value) { writeU32(static_cast<uint32_t>(value)); }
+
+    void writeDouble(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        writeU64(bits);
+    }
+
+    void writeBytes(const uint8_t *data, size_t size) {
+        writeU32(static_cast<uint32_t>(size));
+        m_out->insert(m_out->end(), data, data + size);
+    }
+
+    void writeString(const std::string &str) {
+        writeBytes(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+    }
+
+    void writeBlob(const std::vector<uint8_t> &blob) {
+        writeBytes(blob.data(), blob.size());
+    }
+
+    // reserve room for an u32 written later with patchU32
+    size_t reserveU32() {
+        size_t pos = m_out->size();
+        writeU32(0);
+        return pos;
+    }
+
+    void patchU32(size_t pos, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            (*m_out)[pos + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    size_t size() const { return m_out->size(); }
+
+private:
+    std::vector<uint8_t> *m_out;
+};
+
+class BinaryReader
+{
+public:
+    BinaryReader(const uint8_t *data, size_t size) : m_data(data), m_size(size), m_pos(0), m_error(false) {}
+
+    bool   error() const { return m_error; }
+    size_t pos() const { return m_pos; }
+    size_t remaining() const { return m_size - m_pos; }
+
+    void seek(size_t pos) {
+        if (pos > m_size) {
+            m_error = true;
+            return;
+        }
+        m_pos = pos;
+    }
+
+    bool skip(size_t count) {
+        if (!check(count)) {
+            return false;
+        }
+        m_pos += count;
+        return true;
+    }
+
+    uint8_t readU8() {
+        if (!check(1)) {
+            return 0;
+        }
+        return m_data[m_pos++];
+    }
+
+    uint16_t readU16() {
+        if (!check(2)) {
+            return 0;
+        }
+        uint16_t value = static_cast<uint16_t>(m_data[m_pos] | (m_data[m_pos + 1] << 8));
+        m_pos += 2;
+        return value;
+    }
+
+    uint32_t readU32() {
+        if (!check(4)) {
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(m_data[m_pos + i]) << (8 * i);
+        }
+        m_pos += 4;
+        return value;
+    }
+
+    uint64_t readU64() {
+        if (!check(8)) {
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(m_data[m_pos + i]) << (8 * i);
+        }
+        m_pos += 8;
+        return value;
+    }
+
+    int32_t readI32() { return static_cast<int32_t>(readU32()); }
+
+    double readDouble() {
+        uint64_t bits = readU64();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // returns a pointer inside the buffer, nothing is copied
+    const uint8_t *readBytes(size_t *size) {
+        uint32_t len = readU32();
+        if (!check(len)) {
+            *size = 0;
+            return nullptr;
+        }
+        const uint8_t *ptr = m_data + m_pos;
+        m_pos += len;
+        *size = len;
+        return ptr;
+    }
+
+    void readString(std::string *str) {
+        size_t len;
+        const uint8_t *ptr = readBytes(&len);
+        str->assign(reinterpret_cast<const char *>(ptr), len);
+    }
+
+    void readBlob(std::vector<uint8_t> *blob) {
+        size_t len;
+        const uint8_t *ptr = readBytes(&len);
+        blob->assign(ptr, ptr + len);
+    }
+
+    // count of elements that follow, bounded by what the buffer could hold
+    uint32_t readCount(size_t minElementSize) {
+        uint32_t count = readU32();
+        if (minElementSize && count > remaining() / minElementSize) {
+            m_error = true;
+            return 0;
+        }
+        return count;
+    }
+
+private:
+    bool check(size_t count) {
+        if (m_error || count > m_size - m_pos) {
+            m_error = true;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t *m_data;
+    size_t m_size;
+    size_t m_pos;
+    bool m_error;
+};
+
+#endif // BINARYIO_H
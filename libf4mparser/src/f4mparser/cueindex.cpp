@@ -0,0 +1,133 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "manifest.h"
+
+#include <algorithm>
+
+namespace
+{
+    double endOf(const Cue &cue)
+    {
+        return cue.time + (cue.duration > 0. ? cue.duration : 0.);
+    }
+
+    template <class Entry>
+    bool startsBefore(const Entry &entry, double time)
+    {
+        return entry.time < time;
+    }
+
+    template <class Entry>
+    bool startsAfter(double time, const Entry &entry)
+    {
+        return time < entry.time;
+    }
+}
+
+void CueIndex::build(const std::vector<Cue> &cues)
+{
+    m_byTime.resize(cues.size());
+    for (size_t i = 0; i < cues.size(); ++i) {
+        m_byTime[i] = Entry{cues[i].time, endOf(cues[i]), static_cast<int>(i)};
+    }
+    std::stable_sort(m_byTime.begin(), m_byTime.end(), [](const Entry &a, const Entry &b) {
+        return a.time < b.time;
+    });
+
+    m_latestEnd.assign(4 * m_byTime.size(), 0.);
+    if (!m_byTime.empty()) {
+        buildTree(1, 0, m_byTime.size());
+    }
+}
+
+// node 1 covers [0, size), the children of a node cover its halves
+void CueIndex::buildTree(size_t node, size_t first, size_t last)
+{
+    if (last - first == 1) {
+        m_latestEnd[node] = m_byTime[first].end;
+        return;
+    }
+    size_t middle = (first + last) / 2;
+    buildTree(2 * node, first, middle);
+    buildTree(2 * node + 1, middle, last);
+    m_latestEnd[node] = std::max(m_latestEnd[2 * node], m_latestEnd[2 * node + 1]);
+}
+
+int CueIndex::find(const std::vector<Cue> &cues, double time, const std::string &id) const
+{
+    auto it = std::lower_bound(m_byTime.begin(), m_byTime.end(), time, startsBefore<Entry>);
+    for (; it != m_byTime.end() && it->time == time; ++it) {
+        if (cues[it->position].id == id) {
+            return it->position;
+        }
+    }
+    return -1;
+}
+
+// a refreshed live manifest repeats the cues still in its window, new ones come last
+bool CueIndex::insert(std::vector<Cue> *cues, const Cue &cue)
+{
+    if (find(*cues, cue.time, cue.id) >= 0) {
+        return false;
+    }
+    auto last = std::upper_bound(m_byTime.begin(), m_byTime.end(), cue.time, startsAfter<Entry>);
+    m_byTime.insert(last, Entry{cue.time, endOf(cue), static_cast<int>(cues->size())});
+    cues->push_back(cue);
+
+    m_latestEnd.assign(4 * m_byTime.size(), 0.);
+    buildTree(1, 0, m_byTime.size());
+    return true;
+}
+
+int CueIndex::nextSplice(double time) const
+{
+    auto it = std::lower_bound(m_byTime.begin(), m_byTime.end(), time, startsBefore<Entry>);
+    return it != m_byTime.end() ? it->position : -1;
+}
+
+void CueIndex::overlapping(double begin, double end, std::vector<int> *positions) const
+{
+    if (end < begin || m_byTime.empty()) {
+        return;
+    }
+    // the cues starting after 'end' are out, the others overlap if they end at or after 'begin'
+    auto last = std::upper_bound(m_byTime.begin(), m_byTime.end(), end, startsAfter<Entry>);
+    collect(1, 0, m_byTime.size(), last - m_byTime.begin(), begin, positions);
+}
+
+// only the subtrees holding a cue of [0, end) ending at or after 'begin' are visited
+void CueIndex::collect(size_t node, size_t first, size_t last, size_t end, double begin,
+                       std::vector<int> *positions) const
+{
+    if (first >= end || m_latestEnd[node] < begin) {
+        return;
+    }
+    if (last - first == 1) {
+        positions->push_back(m_byTime[first].position);
+        return;
+    }
+    size_t middle = (first + last) / 2;
+    collect(2 * node, first, middle, end, begin, positions);
+    collect(2 * node + 1, middle, last, end, begin, positions);
+}
@@ -0,0 +1,79 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#ifndef DIAGLINE_H
+#define DIAGLINE_H
+
+#include "diagnostics.h"
+
+#include <atomic>
+#include <string>
+
+// report a diagnostic event, the message is built with operator<<
+//     F4M_DIAG(DIAG_WARNING) << "ignoring malformed cue " << id;
+// nothing right of the macro is evaluated when the level is not enabled
+
+#define F4M_DIAG(level) \
+    if (!Diagnostics::enabled(DiagEvent::level)) {} else DiagLine(DiagEvent::level, __func__)
+
+namespace Diagnostics
+{
+    extern std::atomic<int> minLevel;
+
+    inline bool enabled(DiagEvent::Level level) {
+        return level >= minLevel.load(std::memory_order_relaxed);
+    }
+
+    // queue the event, never blocks
+    void push(const DiagEvent &event);
+}
+
+// formats in place into a fixed size event, no allocation
+class DiagLine
+{
+public:
+    DiagLine(DiagEvent::Level level, const char *function);
+    ~DiagLine();
+
+    DiagLine& operator<<(const char *str);
+    DiagLine& operator<<(const std::string &str) { return append(str.data(), str.size()); }
+    DiagLine& operator<<(char c) { return append(&c, 1); }
+    DiagLine& operator<<(int value);
+    DiagLine& operator<<(unsigned value);
+    DiagLine& operator<<(long value);
+    DiagLine& operator<<(unsigned long value);
+    DiagLine& operator<<(long long value);
+    DiagLine& operator<<(unsigned long long value);
+    DiagLine& operator<<(double value);
+
+private:
+    DiagLine(const DiagLine &) = delete;
+    DiagLine& operator=(const DiagLine &) = delete;
+
+    DiagLine& append(const char *str, size_t size);
+
+    DiagEvent m_event;
+    size_t m_size;
+};
+
+#endif // DIAGLINE_H
@@ -0,0 +1,257 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "diagline.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+// Bounded multi-producer queue (Dmitry Vyukov's algorithm) : each slot carries a sequence
+// number telling whether it is free for the producer of a given position or holds an event
+// for the consumer of that position. Producers only use atomics, the single consumer is
+// the drain thread.
+
+namespace
+{
+    const size_t ringSize = 1024; // power of 2
+
+    class Slot
+    {
+    public:
+        std::atomic<size_t> sequence;
+        DiagEvent event;
+    };
+
+    class Ring
+    {
+    public:
+        Ring() : m_enqueuePos(0), m_dequeuePos(0), m_dropped(0) {
+            for (size_t i = 0; i < ringSize; ++i) {
+                m_slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool push(const DiagEvent &event) {
+            size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+            for (;;) {
+                Slot &slot = m_slots[pos & (ringSize - 1)];
+                size_t seq = slot.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        slot.event = event;
+                        slot.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else {
+                    pos = m_enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // single consumer
+        bool pop(DiagEvent *event) {
+            size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+            Slot &slot = m_slots[pos & (ringSize - 1)];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0) {
+                return false;
+            }
+            *event = slot.event;
+            slot.sequence.store(pos + ringSize, std::memory_order_release);
+            m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    private:
+        Slot m_slots[ringSize];
+        std::atomic<size_t> m_enqueuePos;
+        std::atomic<size_t> m_dequeuePos;
+        std::atomic<uint64_t> m_dropped;
+    };
+
+    class StderrSink : public DiagnosticSink
+    {
+    public:
+        void write(const DiagEvent &event) override {
+            static const char *levels[] = {"debug", "info", "warning"};
+            fprintf(stderr, "f4mparser %s %s: %s\n", levels[event.level], event.function, event.message);
+        }
+    };
+
+    // owns the drain thread, stopped at exit if the user did not
+    class Drain
+    {
+    public:
+        Drain() : m_sink(nullptr), m_running(false) {}
+        ~Drain() { stop(); }
+
+        // the previous sink gets what was queued before it is replaced
+        void start(DiagnosticSink *sink) {
+            std::lock_guard<std::mutex> control(m_control);
+            stopThread();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_sink = sink ? sink : &m_stderrSink;
+            m_running = true;
+            m_thread = std::thread(&Drain::run, this);
+        }
+
+        void stop() {
+            std::lock_guard<std::mutex> control(m_control);
+            stopThread();
+        }
+
+        Ring ring;
+
+    private:
+        void stopThread() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_running) {
+                    return;
+                }
+                m_running = false;
+            }
+            m_wakeUp.notify_one();
+            m_thread.join();
+            flush();
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (m_running) {
+                lock.unlock();
+                flush();
+                lock.lock();
+                // producers never signal, poll
+                m_wakeUp.wait_for(lock, std::chrono::milliseconds(10));
+            }
+        }
+
+        void flush() {
+            DiagEvent event;
+            while (ring.pop(&event)) {
+                m_sink->write(event);
+            }
+        }
+
+        std::mutex m_control; // start and stop
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::thread m_thread;
+        DiagnosticSink *m_sink;
+        StderrSink m_stderrSink;
+        bool m_running;
+    };
+
+    Drain& drain()
+    {
+        static Drain instance;
+        return instance;
+    }
+}
+
+std::atomic<int> Diagnostics::minLevel{DiagEvent::DIAG_NONE};
+
+void Diagnostics::push(const DiagEvent &event)
+{
+    drain().ring.push(event);
+}
+
+DiagLine::DiagLine(DiagEvent::Level level, const char *function) : m_size(0)
+{
+    m_event.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    m_event.level = level;
+    m_event.function = function;
+    m_event.message[0] = '\0';
+}
+
+DiagLine::~DiagLine()
+{
+    Diagnostics::push(m_event);
+}
+
+DiagLine& DiagLine::append(const char *str, size_t size)
+{
+    size_t room = DiagEvent::maxMessageSize - 1 - m_size;
+    if (size > room) {
+        size = room;
+    }
+    memcpy(m_event.message + m_size, str, size);
+    m_size += size;
+    m_event.message[m_size] = '\0';
+    return *this;
+}
+
+DiagLine& DiagLine::operator<<(const char *str)
+{
+    return str ? append(str, strlen(str)) : *this;
+}
+
+#define DIAG_LINE_FORMAT(type, format) \
+    DiagLine& DiagLine::operator<<(type value) \
+    { \
+        char buf[32]; \
+        int size = snprintf(buf, sizeof(buf), format, value); \
+        return append(buf, size > 0 ? size : 0); \
+    }
+
+DIAG_LINE_FORMAT(int, "%d")
+DIAG_LINE_FORMAT(unsigned, "%u")
+DIAG_LINE_FORMAT(long, "%ld")
+DIAG_LINE_FORMAT(unsigned long, "%lu")
+DIAG_LINE_FORMAT(long long, "%lld")
+DIAG_LINE_FORMAT(unsigned long long, "%llu")
+DIAG_LINE_FORMAT(double, "%g")
+
+#undef DIAG_LINE_FORMAT
+
+void F4mEnableDiagnostics(DiagnosticSink *sink, DiagEvent::Level minLevel)
+{
+    if (minLevel >= DiagEvent::DIAG_NONE) {
+        return F4mDisableDiagnostics();
+    }
+    drain().start(sink);
+    Diagnostics::minLevel.store(minLevel, std::memory_order_relaxed);
+}
+
+void F4mDisableDiagnostics()
+{
+    Diagnostics::minLevel.store(DiagEvent::DIAG_NONE, std::memory_order_relaxed);
+    drain().stop();
+}
+
+uint64_t F4mDiagnosticsDropped()
+{
+    return drain().ring.dropped();
+}
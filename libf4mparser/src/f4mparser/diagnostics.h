@@ -0,0 +1,94 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file diagnostics.h
+ *  \brief Runtime switchable diagnostics of the parser.
+ *
+ *  When enabled, the parser reports what it ignores or finds malformed as DiagEvent.
+ *  Events are queued in a fixed size lock-free ring buffer and handed to the sink
+ *  by a background thread, a parsing thread never blocks nor allocates to report one.
+ *  When the buffer is full new events are dropped and counted.
+ *
+ *  When disabled, reporting an event costs one relaxed atomic load.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <cstdint>
+#include <cstddef>
+
+#pragma GCC visibility push(default)
+
+/*! \brief One diagnostic message.
+ */
+class DiagEvent
+{
+public:
+    enum Level {
+        DIAG_DEBUG, ///< every value read, every node ignored
+        DIAG_INFO, ///< unexpected but harmless content
+        DIAG_WARNING, ///< malformed content that was dropped, failed downloads or documents
+        DIAG_NONE ///< as a minimum level : diagnostics disabled
+    };
+
+    static const size_t maxMessageSize = 232;
+
+    uint64_t timeNs; ///< wall clock, nanoseconds since the epoch
+    Level level;
+    const char *function; ///< the function which reported the event, a static string
+    char message[maxMessageSize]; ///< nul terminated, truncated if too long
+};
+
+/*! \brief Receive the diagnostic events, always from the background thread.
+ */
+class DiagnosticSink
+{
+public:
+    virtual ~DiagnosticSink() {}
+
+    virtual void write(const DiagEvent &event) = 0;
+};
+
+/*! \brief start reporting the events of level 'minLevel' and above.
+ *
+ * Can be called again to change the sink or the level.
+ *
+ * \param[in]  sink                 Receives the events, or NULL to write them on stderr. Must stay valid until disabled
+ * \param[in]  minLevel             The lowest level reported
+*/
+void F4mEnableDiagnostics(DiagnosticSink *sink, DiagEvent::Level minLevel = DiagEvent::DIAG_WARNING);
+
+/*! \brief stop reporting, the queued events are handed to the sink before returning.
+*/
+void F4mDisableDiagnostics();
+
+/*! \brief number of events dropped because the ring buffer was full.
+*/
+uint64_t F4mDiagnosticsDropped();
+
+#pragma GCC visibility pop
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,89 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "downloader.h"
+
+#include "diagline.h"
+
+#include <algorithm> // nth_element
+#include <chrono>
+
+void Downloader::downloadAll(const std::vector<DownloadRequest> &requests,
+                             std::vector<DownloadResponse> *responses)
+{
+    responses->clear();
+    responses->reserve(requests.size());
+    for (auto &request : requests) {
+        responses->push_back(download(request));
+    }
+}
+
+DownloadResponse CallbackDownloader::download(const DownloadRequest &request)
+{
+    DownloadResponse response;
+    if (request.hedgeAfterMs && !m_hedgeReported) {
+        // the function blocks and can't be cancelled, a second call would only double the load
+        F4M_DIAG(DIAG_WARNING) << "hedging ignored, a download function can't hedge " << request.url;
+        m_hedgeReported = true;
+    }
+    if (m_downloadFileFctPtr) {
+        auto start = std::chrono::steady_clock::now();
+        response.data = m_downloadFileFctPtr(m_downloadFileUserPtr, request.url, response.status);
+        response.durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+    }
+    return response;
+}
+
+const size_t DownloadLatencies::capacity;
+
+void DownloadLatencies::add(uint32_t durationMs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_durations[m_count % capacity] = durationMs;
+    m_count++;
+}
+
+size_t DownloadLatencies::count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::min(m_count, capacity);
+}
+
+uint32_t DownloadLatencies::percentile(double percentile) const
+{
+    uint32_t durations[capacity];
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        count = std::min(m_count, capacity);
+        std::copy(m_durations, m_durations + count, durations);
+    }
+    if (count == 0) {
+        return 0;
+    }
+    percentile = std::max(0.0, std::min(percentile, 100.0));
+    size_t rank = std::min(static_cast<size_t>(percentile / 100.0 * count), count - 1);
+    std::nth_element(durations, durations + rank, durations + count);
+    return durations[rank];
+}
@@ -0,0 +1,149 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file downloader.h
+ *  \brief The interface the parser downloads its documents through.
+ *
+ *  A Downloader is an object : it can keep connections, sessions and caches alive
+ *  between the requests of a parse and across parses. The stream-level manifests of
+ *  a multi-level manifest are submitted together to downloadAll, an implementation
+ *  can fetch them concurrently.
+ *
+ *  A request may ask to be hedged : when it is still unanswered after hedgeAfterMs, a
+ *  duplicate is sent and the first answer is kept. Hedging is up to the implementation.
+ *
+ *  The DOWNLOAD_FILE_FUNCTION callbacks of f4mparser.h are wrapped in a CallbackDownloader.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef DOWNLOADER_H
+#define DOWNLOADER_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#pragma GCC visibility push(default)
+
+/*! \brief One document to download.
+ */
+class DownloadRequest
+{
+public:
+    DownloadRequest() : timeoutMs{0}, hedgeAfterMs{0} {}
+
+    std::string url;
+    uint32_t timeoutMs; ///< 0 for the downloader's own timeout. Set by the parser from ParseLimits::deadlineMs
+    uint32_t hedgeAfterMs; ///< send a duplicate request after this delay without answer, 0 to never. Set by the parser from RetryPolicy
+    std::string ifNoneMatch; ///< conditional request : the ETag of the copy already held, or empty
+    std::string ifModifiedSince; ///< conditional request : the http date of the copy already held, or empty
+    std::vector<std::string> headers; ///< extra "Name: value" request headers
+};
+
+/*! \brief The result of a DownloadRequest.
+ */
+class DownloadResponse
+{
+public:
+    DownloadResponse() : status{-1}, durationMs{0}, hedged{false} {}
+
+    long status; ///< the http status code, or -1 if the request failed. The parser only accepts 200
+    std::vector<uint8_t> data; ///< the body
+    uint32_t durationMs; ///< from the request to the answer, 0 if not measured
+    bool hedged; ///< a duplicate request was sent
+    std::string etag; ///< of the response, for a later conditional request, or empty
+    std::string lastModified; ///< of the response, for a later conditional request, or empty
+};
+
+/*! \brief Downloads the documents of a parse.
+ *
+ * A downloader is used by one parse at a time, the calls come from the parsing thread.
+ */
+class Downloader
+{
+public:
+    virtual ~Downloader() {}
+
+    /*! \brief download one document, blocking until it is complete or has failed.
+    */
+    virtual DownloadResponse download(const DownloadRequest &request) = 0;
+
+    /*! \brief download several documents, by default one after the other.
+     *
+     * \param[in]  requests             The documents to download
+     * \param[out] responses            Resized to the number of requests, responses[i] answers requests[i]
+    */
+    virtual void downloadAll(const std::vector<DownloadRequest> &requests,
+                             std::vector<DownloadResponse> *responses);
+};
+
+/*! \brief A Downloader calling a DOWNLOAD_FILE_FUNCTION, the request options are ignored
+ * and no request is hedged : the first request with a hedgeAfterMs is reported with a warning.
+ */
+class CallbackDownloader : public Downloader
+{
+public:
+    typedef std::vector<uint8_t>(*DOWNLOAD_FILE_FUNCTION)(void *, std::string, long &);
+
+    CallbackDownloader(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr)
+        : m_downloadFileUserPtr(downloadFileUserPtr), m_downloadFileFctPtr(downloadFileFctPtr),
+          m_hedgeReported(false) {}
+
+    DownloadResponse download(const DownloadRequest &request) override;
+
+private:
+    void *m_downloadFileUserPtr;
+    DOWNLOAD_FILE_FUNCTION m_downloadFileFctPtr;
+    bool m_hedgeReported;
+};
+
+/*! \brief The latest download durations, to hedge at a percentile of the usual latency.
+ *
+ * Shared by the parses using the same RetryPolicy, it can be used from several threads.
+ */
+class DownloadLatencies
+{
+public:
+    static const size_t capacity = 256; ///< the oldest durations are replaced
+
+    DownloadLatencies() : m_count{0} {}
+
+    void add(uint32_t durationMs);
+
+    size_t count() const; ///< durations kept, at most capacity
+
+    /*! \brief the duration under which 'percentile' percent of the kept durations are, 0 when none is kept.
+    */
+    uint32_t percentile(double percentile) const;
+
+private:
+    mutable std::mutex m_mutex;
+    uint32_t m_durations[capacity];
+    size_t m_count; ///< durations ever added
+};
+
+#pragma GCC visibility pop
+
+#endif // DOWNLOADER_H
@@ -0,0 +1,97 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "manifest.h"
+
+#include <algorithm>
+
+namespace
+{
+    template <class Entry>
+    bool after(double time, const Entry &entry)
+    {
+        return time < entry.time;
+    }
+}
+
+double DrmAdditionalHeaderTimeline::prefetchDeadlineOf(const DrmAdditionalHeader &header)
+{
+    return header.prefetchDeadline >= 0. ? header.prefetchDeadline : header.startTimestamp;
+}
+
+void DrmAdditionalHeaderTimeline::build(const std::vector<DrmAdditionalHeader> &headers)
+{
+    m_byStart.resize(headers.size());
+    m_byDeadline.resize(headers.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+        m_byStart[i] = Entry{headers[i].startTimestamp, static_cast<int>(i)};
+        m_byDeadline[i] = Entry{prefetchDeadlineOf(headers[i]), static_cast<int>(i)};
+    }
+    // equal times keep the document order
+    auto byTime = [](const Entry &a, const Entry &b) {
+        return a.time < b.time;
+    };
+    std::stable_sort(m_byStart.begin(), m_byStart.end(), byTime);
+    std::stable_sort(m_byDeadline.begin(), m_byDeadline.end(), byTime);
+}
+
+int DrmAdditionalHeaderTimeline::activeAt(double time) const
+{
+    auto it = std::upper_bound(m_byStart.begin(), m_byStart.end(), time, after<Entry>);
+    if (it == m_byStart.begin()) {
+        return -1;
+    }
+    return (it - 1)->position;
+}
+
+void DrmAdditionalHeaderTimeline::prefetchDueBy(double time, std::vector<int> *positions) const
+{
+    auto last = std::upper_bound(m_byDeadline.begin(), m_byDeadline.end(), time, after<Entry>);
+    for (auto it = m_byDeadline.begin(); it != last; ++it) {
+        positions->push_back(it->position);
+    }
+}
+
+void DrmAdditionalHeaderTimeline::prefetchSchedule(double begin, double end,
+                                                   std::vector<int> *positions) const
+{
+    if (end < begin) {
+        return;
+    }
+    // the header active at 'begin' then the ones starting inside the window
+    auto first = std::upper_bound(m_byStart.begin(), m_byStart.end(), begin, after<Entry>);
+    if (first != m_byStart.begin()) {
+        --first;
+    }
+    auto last = std::upper_bound(first, m_byStart.end(), end, after<Entry>);
+
+    std::vector<bool> used(m_byStart.size(), false);
+    for (auto it = first; it != last; ++it) {
+        used[it->position] = true;
+    }
+    for (const auto &entry : m_byDeadline) {
+        if (used[entry.position]) {
+            positions->push_back(entry.position);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "f4mnames.h"
+
+#include <cstring>
+
+namespace
+{
+    using namespace F4mNames;
+
+    uint32_t runtimeHash(const char *str)
+    {
+        uint32_t h = 2166136261u;
+        for (; *str; ++str) {
+            h = (h ^ static_cast<uint8_t>(*str)) * 16777619u;
+        }
+        return h;
+    }
+
+    Name confirm(const char *name, const char *expected, Name result)
+    {
+        return strcmp(name, expected) == 0 ? result : UNKNOWN;
+    }
+}
+
+#define F4M_NAME(str, value) case hash(str): return confirm(name, str, value)
+
+Name F4mNames::lookup(const char *name)
+{
+    switch (runtimeHash(name)) {
+    F4M_NAME("adaptiveSet", ADAPTIVE_SET);
+    F4M_NAME("baseURL", BASE_URL);
+    F4M_NAME("bestEffortFetchInfo", BEST_EFFORT_FETCH_INFO);
+    F4M_NAME("bootstrapInfo", BOOTSTRAP_INFO);
+    F4M_NAME("cueInfo", CUE_INFO);
+    F4M_NAME("deliveryType", DELIVERY_TYPE);
+    F4M_NAME("drmAdditionalHeader", DRM_ADDITIONAL_HEADER);
+    F4M_NAME("drmAdditionalHeaderSet", DRM_ADDITIONAL_HEADER_SET);
+    F4M_NAME("duration", DURATION);
+    F4M_NAME("dvrInfo", DVR_INFO);
+    F4M_NAME("media", MEDIA);
+    F4M_NAME("metadata", METADATA);
+    F4M_NAME("mimeType", MIME_TYPE);
+    F4M_NAME("moov", MOOV);
+    F4M_NAME("smpteTimecodes", SMPTE_TIMECODES);
+    F4M_NAME("startTime", START_TIME);
+    F4M_NAME("streamType", STREAM_TYPE);
+    F4M_NAME("xmpMetadata", XMP_METADATA);
+
+    F4M_NAME("alternate", ALTERNATE);
+    F4M_NAME("audioCodec", AUDIO_CODEC);
+    F4M_NAME("beginOffset", BEGIN_OFFSET);
+    F4M_NAME("bestEffortFetchInfoId", BEST_EFFORT_FETCH_INFO_ID);
+    F4M_NAME("bitrate", BITRATE);
+    F4M_NAME("bootstrapInfoId", BOOTSTRAP_INFO_ID);
+    F4M_NAME("cueInfoId", CUE_INFO_ID);
+    F4M_NAME("drmAdditionalHeaderId", DRM_ADDITIONAL_HEADER_ID);
+    F4M_NAME("drmAdditionalHeaderSetId", DRM_ADDITIONAL_HEADER_SET_ID);
+    F4M_NAME("dvrInfoId", DVR_INFO_ID);
+    F4M_NAME("endOffset", END_OFFSET);
+    F4M_NAME("fragmentDuration", FRAGMENT_DURATION);
+    F4M_NAME("groupspec", GROUPSPEC);
+    F4M_NAME("height", HEIGHT);
+    F4M_NAME("href", HREF);
+    F4M_NAME("id", ID);
+    F4M_NAME("label", LABEL);
+    F4M_NAME("lang", LANG);
+    F4M_NAME("multicastStreamName", MULTICAST_STREAM_NAME);
+    F4M_NAME("offline", OFFLINE);
+    F4M_NAME("profile", PROFILE);
+    F4M_NAME("segmentDuration", SEGMENT_DURATION);
+    F4M_NAME("streamId", STREAM_ID);
+    F4M_NAME("type", TYPE);
+    F4M_NAME("url", URL);
+    F4M_NAME("videoCodec", VIDEO_CODEC);
+    F4M_NAME("width", WIDTH);
+    F4M_NAME("windowDuration", WINDOW_DURATION);
+    default:
+        return UNKNOWN;
+    }
+}
+
+#undef F4M_NAME
@@ -0,0 +1,269 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#ifndef F4MNAMES_H
+#define F4MNAMES_H
+
+#include <cstdint>
+
+// Dispatch of the element and attribute names of a f4m document.
+//
+// A name is hashed once (FNV-1a) and switched on, the hash of each known name is computed
+// at compile time so a collision is a duplicate case label. A strcmp confirms the match.
+//
+// Which names are read depends on the F4M version and the manifest level : the 'context'
+// of a document is one bit among 4 versions (0 when the version could not be read) x 3 levels,
+// and each table gives the contexts in which a name is legal. The parser is instantiated
+// once per context, see ManifestParser::SectionParsers.
+
+namespace F4mNames
+{
+    enum Name {
+        UNKNOWN,
+
+        // elements
+        ADAPTIVE_SET,
+        BASE_URL,
+        BEST_EFFORT_FETCH_INFO,
+        BOOTSTRAP_INFO,
+        CUE_INFO,
+        DELIVERY_TYPE,
+        DRM_ADDITIONAL_HEADER,
+        DRM_ADDITIONAL_HEADER_SET,
+        DURATION,
+        DVR_INFO,
+        MEDIA,
+        METADATA,
+        MIME_TYPE,
+        MOOV,
+        SMPTE_TIMECODES,
+        START_TIME,
+        STREAM_TYPE,
+        XMP_METADATA,
+
+        // attributes, and elements sharing their name
+        ALTERNATE,
+        AUDIO_CODEC,
+        BEGIN_OFFSET,
+        BEST_EFFORT_FETCH_INFO_ID,
+        BITRATE,
+        BOOTSTRAP_INFO_ID,
+        CUE_INFO_ID,
+        DRM_ADDITIONAL_HEADER_ID,
+        DRM_ADDITIONAL_HEADER_SET_ID,
+        DVR_INFO_ID,
+        END_OFFSET,
+        FRAGMENT_DURATION,
+        GROUPSPEC,
+        HEIGHT,
+        HREF,
+        ID,
+        LABEL,
+        LANG,
+        MULTICAST_STREAM_NAME,
+        OFFLINE,
+        PROFILE,
+        SEGMENT_DURATION,
+        STREAM_ID,
+        TYPE,
+        URL,
+        VIDEO_CODEC,
+        WIDTH,
+        WINDOW_DURATION,
+
+        NAME_COUNT
+    };
+
+    enum Level {
+        LEVEL_SINGLE, // also a F4M 2.0+ manifest without href
+        LEVEL_SET,
+        LEVEL_MLM_STREAM
+    };
+
+    typedef uint16_t Contexts;
+
+    const Contexts V0 = 07 << 0;
+    const Contexts V1 = 07 << 3;
+    const Contexts V2 = 07 << 6;
+    const Contexts V3 = 07 << 9;
+    const Contexts ALL = V0 | V1 | V2 | V3;
+    const Contexts SET_LEVEL = 02 << 0 | 02 << 3 | 02 << 6 | 02 << 9;
+    const Contexts MLM_STREAM = 04 << 0 | 04 << 3 | 04 << 6 | 04 << 9;
+    const int CONTEXT_COUNT = 12;
+
+    inline int contextIndex(int versionMajor, Level level) {
+        int version = versionMajor < 0 ? 0 : (versionMajor > 3 ? 3 : versionMajor);
+        return version * 3 + level;
+    }
+
+    constexpr uint32_t hash(const char *str, uint32_t h = 2166136261u) {
+        return *str ? hash(str + 1, (h ^ static_cast<uint8_t>(*str)) * 16777619u) : h;
+    }
+
+    Name lookup(const char *name);
+
+    // the contexts in which a name is legal for an element, 0 if it is not a name of the element
+    // the sections are those read by ManifestParser::parseManifest
+    inline Contexts manifestChildContexts(Name name) {
+        switch (name) {
+        case BASE_URL: case START_TIME: case MIME_TYPE: case STREAM_TYPE: case DELIVERY_TYPE:
+        case LABEL: case ID: case LANG: case DURATION:
+        case MEDIA:
+            return ALL;
+        case DVR_INFO:
+            return ALL & ~MLM_STREAM;
+        case BOOTSTRAP_INFO: case DRM_ADDITIONAL_HEADER:
+            return ALL & ~SET_LEVEL;
+        case ADAPTIVE_SET:
+            return V3 & ~MLM_STREAM;
+        case SMPTE_TIMECODES: case CUE_INFO: case DRM_ADDITIONAL_HEADER_SET:
+            return V3 & ~SET_LEVEL;
+        case BEST_EFFORT_FETCH_INFO:
+            return V3 & SET_LEVEL;
+        default:
+            return 0;
+        }
+    }
+
+    inline Contexts mediaAttrContexts(Name name) {
+        switch (name) {
+        case DVR_INFO_ID:
+            return V1;
+        case HREF:
+            return V2 | V3;
+        case AUDIO_CODEC: case VIDEO_CODEC: case CUE_INFO_ID: case BEST_EFFORT_FETCH_INFO_ID:
+        case DRM_ADDITIONAL_HEADER_SET_ID:
+            return V3;
+        // read from the set-level manifest
+        case BITRATE: case STREAM_ID: case WIDTH: case HEIGHT: case TYPE: case ALTERNATE:
+        case LABEL: case LANG:
+            return ALL & ~MLM_STREAM;
+        case URL: case BOOTSTRAP_INFO_ID: case DRM_ADDITIONAL_HEADER_ID: case GROUPSPEC:
+        case MULTICAST_STREAM_NAME:
+            return ALL;
+        default:
+            return 0;
+        }
+    }
+
+    inline Contexts mediaChildContexts(Name name) {
+        switch (name) {
+        case MOOV: case XMP_METADATA:
+            return V1;
+        case METADATA:
+            return ALL;
+        default:
+            return 0;
+        }
+    }
+
+    inline Contexts adaptiveSetAttrContexts(Name name) {
+        switch (name) {
+        case ALTERNATE: case LABEL: case AUDIO_CODEC: case LANG: case TYPE:
+            return V3 & ~MLM_STREAM;
+        default:
+            return 0;
+        }
+    }
+
+    inline Contexts adaptiveSetMediaAttrContexts(Name name) {
+        switch (name) {
+        case HREF: case VIDEO_CODEC: case CUE_INFO_ID: case BEST_EFFORT_FETCH_INFO_ID:
+        case DRM_ADDITIONAL_HEADER_SET_ID: case BITRATE: case STREAM_ID: case WIDTH: case HEIGHT:
+        case URL: case BOOTSTRAP_INFO_ID: case DRM_ADDITIONAL_HEADER_ID: case GROUPSPEC:
+        case MULTICAST_STREAM_NAME:
+            return V3 & ~MLM_STREAM;
+        default:
+            return 0;
+        }
+    }
+
+    inline Contexts dvrInfoAttrContexts(Name name) {
+        switch (name) {
+        case ID: case BEGIN_OFFSET: case END_OFFSET:
+            return V1;
+        case WINDOW_DURATION:
+            return V2 | V3;
+        case URL: case OFFLINE:
+            return ALL;
+        default:
+            return 0;
+        }
+    }
+
+    inline Contexts bootstrapInfoAttrContexts(Name name) {
+        switch (name) {
+        case PROFILE: case ID: case URL:
+            return ALL;
+        case FRAGMENT_DURATION: case SEGMENT_DURATION:
+            return V3;
+        default:
+            return 0;
+        }
+    }
+
+    // the name if it is legal for the element in 'Context', UNKNOWN otherwise.
+    // 'Context' is a single bit, the tables above fold to the names of that context.
+    template <Contexts Context, Contexts (*Table)(Name)>
+    inline Name legalName(const char *name) {
+        Name n = lookup(name);
+        return (Table(n) & Context) ? n : UNKNOWN;
+    }
+
+    template <Contexts Context>
+    inline Name manifestChild(const char *name) {
+        return legalName<Context, manifestChildContexts>(name);
+    }
+
+    template <Contexts Context>
+    inline Name mediaAttr(const char *name) {
+        return legalName<Context, mediaAttrContexts>(name);
+    }
+
+    template <Contexts Context>
+    inline Name mediaChild(const char *name) {
+        return legalName<Context, mediaChildContexts>(name);
+    }
+
+    template <Contexts Context>
+    inline Name adaptiveSetAttr(const char *name) {
+        return legalName<Context, adaptiveSetAttrContexts>(name);
+    }
+
+    template <Contexts Context>
+    inline Name adaptiveSetMediaAttr(const char *name) {
+        return legalName<Context, adaptiveSetMediaAttrContexts>(name);
+    }
+
+    template <Contexts Context>
+    inline Name dvrInfoAttr(const char *name) {
+        return legalName<Context, dvrInfoAttrContexts>(name);
+    }
+
+    template <Contexts Context>
+    inline Name bootstrapInfoAttr(const char *name) {
+        return legalName<Context, bootstrapInfoAttrContexts>(name);
+    }
+}
+
+#endif // F4MNAMES_H
@@ -24,6 +24,7 @@
 #include "f4mparser.h"
 
 #include "manifestparser.h"
+#include "manifestserializer.h"
 
 bool F4mParseManifest(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
                       const std::string &url, Manifest *manifest)
@@ -32,8 +33,118 @@ bool F4mParseManifest(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION download
     return manifestParser.parse(url, manifest);
 }
 
+bool F4mParseManifest(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                      const std::string &url, Manifest *manifest, ParseStats *stats)
+{
+    ParseOptions options;
+    options.stats = stats;
+    return F4mParseManifest(downloadFileUserPtr, downloadFileFctPtr, url, manifest, options);
+}
+
+bool F4mParseManifest(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                      const std::string &url, Manifest *manifest, const ParseOptions &options)
+{
+    CallbackDownloader downloader(downloadFileUserPtr, downloadFileFctPtr);
+    return F4mParseManifest(&downloader, url, manifest, options);
+}
+
+bool F4mParseManifest(Downloader *downloader, const std::string &url, Manifest *manifest,
+                      const ParseOptions &options)
+{
+    ManifestParser manifestParser(downloader);
+    return manifestParser.parse(url, manifest, options);
+}
+
+bool F4mRefreshManifest(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                        const std::string &url, const Manifest &previous, Manifest *manifest,
+                        ManifestChangeSet *changes)
+{
+    return F4mRefreshManifest(downloadFileUserPtr, downloadFileFctPtr, url, previous, manifest,
+                              changes, ParseOptions());
+}
+
+bool F4mRefreshManifest(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                        const std::string &url, const Manifest &previous, Manifest *manifest,
+                        ManifestChangeSet *changes, const ParseOptions &options)
+{
+    CallbackDownloader downloader(downloadFileUserPtr, downloadFileFctPtr);
+    return F4mRefreshManifest(&downloader, url, previous, manifest, changes, options);
+}
+
+bool F4mRefreshManifest(Downloader *downloader, const std::string &url, const Manifest &previous,
+                        Manifest *manifest, ManifestChangeSet *changes, const ParseOptions &options)
+{
+    ManifestParser manifestParser(downloader);
+    return manifestParser.refresh(url, previous, manifest, changes, options);
+}
+
+bool F4mParseManifestFromBuffer(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                                const uint8_t *data, size_t size, const std::string &url,
+                                Manifest *manifest)
+{
+    ManifestParser manifestParser(downloadFileUserPtr, downloadFileFctPtr);
+    return manifestParser.parseBuffer(data, size, url, manifest);
+}
+
+bool F4mParseManifestFromBuffer(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                                std::vector<uint8_t> &&data, const std::string &url,
+                                Manifest *manifest)
+{
+    ManifestParser manifestParser(downloadFileUserPtr, downloadFileFctPtr);
+    return manifestParser.parseBuffer(std::move(data), url, manifest);
+}
+
+bool F4mParseManifestFromFile(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                              const std::string &path, Manifest *manifest)
+{
+    ManifestParser manifestParser(downloadFileUserPtr, downloadFileFctPtr);
+    return manifestParser.parseFile(path, manifest);
+}
+
+bool F4mVisitManifest(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                      const std::string &url, ManifestVisitor *visitor)
+{
+    ManifestParser manifestParser(downloadFileUserPtr, downloadFileFctPtr);
+    return manifestParser.visit(url, visitor);
+}
+
+bool F4mVisitManifestFromBuffer(const uint8_t *data, size_t size, const std::string &url,
+                                ManifestVisitor *visitor)
+{
+    ManifestParser manifestParser(nullptr, nullptr);
+    return manifestParser.visitBuffer(data, size, url, visitor);
+}
+
+bool F4mVisitManifestFromFile(const std::string &path, ManifestVisitor *visitor)
+{
+    ManifestParser manifestParser(nullptr, nullptr);
+    return manifestParser.visitFile(path, visitor);
+}
+
 bool F4mUpdateDvrInfo(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
                       const std::string &url, DvrInfo *dvrInfo)
 {
     return ManifestParser::updateDvrInfo(downloadFileUserPtr, downloadFileFctPtr, url, dvrInfo);
 }
+
+bool F4mUpdateDvrInfo(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                      const std::string &url, DvrInfo *dvrInfo, ParseTracer *tracer)
+{
+    return ManifestParser::updateDvrInfo(downloadFileUserPtr, downloadFileFctPtr, url, dvrInfo, tracer);
+}
+
+bool F4mUpdateDvrInfo(Downloader *downloader, const std::string &url, DvrInfo *dvrInfo,
+                      ParseTracer *tracer)
+{
+    return ManifestParser::updateDvrInfo(downloader, url, dvrInfo, tracer);
+}
+
+std::vector<uint8_t> F4mSerializeManifest(const Manifest &manifest)
+{
+    return ManifestSerializer::serialize(manifest);
+}
+
+bool F4mDeserializeManifest(const uint8_t *data, size_t size, Manifest *manifest)
+{
+    return ManifestSerializer::deserialize(data, size, manifest);
+}
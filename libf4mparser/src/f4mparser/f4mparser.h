@@ -27,6 +27,14 @@
  *  This contains the interfaces needed to parse a manifest from an url
  *  and to update a dvrInfo structure.
  *
+ *  Thread safety : the library keeps no mutable state shared between parses, except
+ *  the diagnostics which are synchronized. Every function can be called from several
+ *  threads at once, as long as the objects given to one call are not used by another
+ *  thread meanwhile. A Downloader or a download function is called from the thread
+ *  of the parse, ManifestResolver calls it from all the threads using the resolver.
+ *  DownloadLatencies, ManifestResolver and ParserPool can be shared by threads : their
+ *  state is synchronized and only shared by the parses given the same object.
+ *
  *  \author (rafirafi)
  */
 
@@ -34,6 +42,14 @@
 #define F4MPARSER_H
 
 #include "manifest.h"
+#include "downloader.h"
+#include "manifestchangeset.h"
+#include "manifestvisitor.h"
+#include "manifeststore.h"
+#include "manifestresolver.h"
+#include "parserpool.h"
+#include "parseoptions.h"
+#include "diagnostics.h"
 
 #pragma GCC visibility push(default)
 
@@ -63,6 +79,152 @@ bool F4mParseManifest(void *downloadFileUserPtr,
                       const std::string &url,
                       Manifest *manifest);
 
+/*! \brief same as above, collecting timings and counters about the parse.
+ *
+ * \param[out] stats                Reset then filled during the parse, or NULL to collect nothing
+*/
+bool F4mParseManifest(void *downloadFileUserPtr,
+                      DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                      const std::string &url,
+                      Manifest *manifest,
+                      ParseStats *stats);
+
+/*! \brief same as above, with the instrumentation given in the options.
+ *
+ * \param[in]  options              Instrumentation, skipped sections and limits of this parse, reports why it failed
+*/
+bool F4mParseManifest(void *downloadFileUserPtr,
+                      DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                      const std::string &url,
+                      Manifest *manifest,
+                      const ParseOptions &options);
+
+/*! \brief same as above, downloading through a Downloader.
+ *
+ * The stream-level manifests of a multi-level manifest are submitted together to
+ * Downloader::downloadAll.
+ *
+ * \param[in]  downloader           Downloads the documents, see downloader.h
+*/
+bool F4mParseManifest(Downloader *downloader,
+                      const std::string &url,
+                      Manifest *manifest,
+                      const ParseOptions &options);
+
+/*! \brief retrieve the medias information from a f4m document already in memory.
+ *
+ * The stream-level manifests of a multi-level manifest are still retrieved with the callback.
+ *
+ * \param[in]  downloadFileUserPtr  A user pointer passed with callback function when downloading a file, or NULL
+ * \param[in]  downloadFileFctPtr   A callback function for downloading a file, or NULL if no file is to be downloaded
+ * \param[in]  data                 The f4m document, copied in a buffer of the parser and parsed in place
+ * \param[in]  size                 The size of the document
+ * \param[in]  url                  The url the document was retrieved from, relative urls are resolved against it
+ * \param[out] manifest             The structure containing all the valid informations for each media described in the manifest file
+ * \return bool                     Returns true if the parsing was successfull
+*/
+bool F4mParseManifestFromBuffer(void *downloadFileUserPtr,
+                                DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                                const uint8_t *data, size_t size,
+                                const std::string &url,
+                                Manifest *manifest);
+
+/*! \brief same as above but the buffer is taken over and parsed in place, no copy is made.
+*/
+bool F4mParseManifestFromBuffer(void *downloadFileUserPtr,
+                                DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                                std::vector<uint8_t> &&data,
+                                const std::string &url,
+                                Manifest *manifest);
+
+/*! \brief retrieve the medias information from a local f4m file.
+ *
+ * The file is mapped in memory and parsed in place. Relative hrefs of a multi-level
+ * manifest are resolved against the path and passed as is to the callback.
+ *
+ * \param[in]  downloadFileUserPtr  A user pointer passed with callback function when downloading a file, or NULL
+ * \param[in]  downloadFileFctPtr   A callback function for downloading a file, or NULL if no file is to be downloaded
+ * \param[in]  path                 The path of the f4m file
+ * \param[out] manifest             The structure containing all the valid informations for each media described in the manifest file
+ * \return bool                     Returns true if the parsing was successfull
+*/
+bool F4mParseManifestFromFile(void *downloadFileUserPtr,
+                              DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                              const std::string &path,
+                              Manifest *manifest);
+
+/*! \brief parse again a live manifest and report what changed since the previous parse.
+ *
+ * The blobs (bootstrap info, drm headers, metadata) whose base64 text is unchanged are
+ * copied from 'previous' instead of being decoded again.
+ *
+ * \param[in]  downloadFileUserPtr  A user pointer passed with callback function when downloading a file, or NULL
+ * \param[in]  downloadFileFctPtr   A callback function for downloading a file
+ * \param[in]  url                  The url pointing to the manifest file
+ * \param[in]  previous             The result of the previous parse of this url
+ * \param[out] manifest             The new manifest, left untouched on failure. It may be 'previous'
+ * \param[out] changes              The differences from 'previous' to 'manifest', or NULL
+ * \return bool                     Returns true if the parsing was successfull
+*/
+bool F4mRefreshManifest(void *downloadFileUserPtr,
+                        DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                        const std::string &url,
+                        const Manifest &previous,
+                        Manifest *manifest,
+                        ManifestChangeSet *changes);
+
+/*! \brief same as above, with the instrumentation given in the options.
+ *
+ * \param[in]  options              Instrumentation, skipped sections and limits of this parse, reports why it failed
+*/
+bool F4mRefreshManifest(void *downloadFileUserPtr,
+                        DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                        const std::string &url,
+                        const Manifest &previous,
+                        Manifest *manifest,
+                        ManifestChangeSet *changes,
+                        const ParseOptions &options);
+
+/*! \brief same as above, downloading through a Downloader.
+ *
+ * \param[in]  downloader           Downloads the documents, see downloader.h
+*/
+bool F4mRefreshManifest(Downloader *downloader,
+                        const std::string &url,
+                        const Manifest &previous,
+                        Manifest *manifest,
+                        ManifestChangeSet *changes,
+                        const ParseOptions &options);
+
+/*! \brief walk the elements of a f4m document, reporting them to a visitor.
+ *
+ * No Manifest is built, see ManifestVisitor. The stream-level manifests of a
+ * multi-level manifest are not retrieved.
+ *
+ * \param[in]  downloadFileUserPtr  A user pointer passed with callback function when downloading a file, or NULL
+ * \param[in]  downloadFileFctPtr   A callback function for downloading a file
+ * \param[in]  url                  The url pointing to the manifest file
+ * \param[in]  visitor              Receives the elements
+ * \return bool                     Returns true if the document was loaded, even if the visitor stopped the walk
+*/
+bool F4mVisitManifest(void *downloadFileUserPtr,
+                      DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                      const std::string &url,
+                      ManifestVisitor *visitor);
+
+/*! \brief same as above, from a document already in memory.
+ *
+ * \param[in]  url                  The url the document was retrieved from, relative urls are resolved against it
+*/
+bool F4mVisitManifestFromBuffer(const uint8_t *data, size_t size,
+                                const std::string &url,
+                                ManifestVisitor *visitor);
+
+/*! \brief same as above, from a local f4m file which is mapped in memory.
+*/
+bool F4mVisitManifestFromFile(const std::string &path,
+                              ManifestVisitor *visitor);
+
 /*! \brief retrieve the medias information from a http pointing to a dvr xml document.
  *
  * \param[in]  downloadFileUserPtr  A user pointer passed with callback function when downloading a file
@@ -76,6 +238,44 @@ bool F4mUpdateDvrInfo(void *downloadFileUserPtr,
                       const std::string &url,
                       DvrInfo *dvrInfo);
 
+/*! \brief same as above, reporting the download to a tracer.
+ *
+ * \param[in]  tracer               Receives the spans of the download and of the document loading, or NULL
+*/
+bool F4mUpdateDvrInfo(void *downloadFileUserPtr,
+                      DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                      const std::string &url,
+                      DvrInfo *dvrInfo,
+                      ParseTracer *tracer);
+
+/*! \brief same as above, downloading through a Downloader.
+ *
+ * \param[in]  downloader           Downloads the dvrInfo document, see downloader.h
+*/
+bool F4mUpdateDvrInfo(Downloader *downloader,
+                      const std::string &url,
+                      DvrInfo *dvrInfo,
+                      ParseTracer *tracer);
+
+/*! \brief serialize a parsed manifest to a compact binary buffer.
+ *
+ * The format is versioned, the buffer can be stored and loaded back by
+ * F4mDeserializeManifest without parsing the f4m document again.
+ *
+ * \param[in]  manifest             The manifest to serialize
+ * \return std::vector<uint8_t>     The binary representation of the manifest
+*/
+std::vector<uint8_t> F4mSerializeManifest(const Manifest &manifest);
+
+/*! \brief load a manifest from a buffer created by F4mSerializeManifest.
+ *
+ * \param[in]  data                 The binary buffer
+ * \param[in]  size                 The size of the buffer
+ * \param[out] manifest             The manifest, left untouched on failure
+ * \return bool                     Returns false if the buffer is malformed or from another format version
+*/
+bool F4mDeserializeManifest(const uint8_t *data, size_t size, Manifest *manifest);
+
 #pragma GCC visibility pop
 
 #endif // F4MPARSER_H
@@ -39,6 +39,8 @@
 #include <vector>
 #include <cstdint> // uint8_t
 
+#include "renditionindex.h"
+
 /*! \brief The <drmAdditionalHeader> element represents the DRM AdditionalHeader
  * needed for DRM authentication. It contains either a BASE64 encoded
  * representation of, or a URL to, the DRM AdditionalHeader (including
@@ -63,6 +65,60 @@ public:
     double startTimestamp; ///< Since F4M 3.0
 };
 
+#pragma GCC visibility push(default)
+
+/*! \brief The headers of a <drmAdditionalHeaderSet> on the presentation timeline, for
+ * license rotation.
+ *
+ * Media::drmAdditionalHeaderTimeline is built from Media::drmAdditionalHeaderSet. A header is
+ * referred to by its position in that vector, the timeline stays valid when the Media is copied
+ * but must be built again if its headers are modified. A header without startTimestamp is active
+ * from the start of the presentation, a header without prefetchDeadline must be fetched by its
+ * startTimestamp. Lookups are O(log n).
+ * Since F4M 3.0
+ */
+class DrmAdditionalHeaderTimeline
+{
+public:
+    void build(const std::vector<DrmAdditionalHeader> &headers);
+    void clear() { m_byStart.clear(); m_byDeadline.clear(); }
+
+    bool   empty() const { return m_byStart.empty(); }
+    size_t size() const { return m_byStart.size(); }
+
+    /*! \brief The position of the header used to play 'time' : the last one started at or before it,
+     * the last in document order of those starting together.
+     *
+     * -1 if every header starts after 'time'.
+     */
+    int activeAt(double time) const;
+
+    /*! \brief Append to 'positions' the headers whose prefetch deadline is at or before 'time',
+     * by increasing deadline.
+     */
+    void prefetchDueBy(double time, std::vector<int> *positions) const;
+
+    /*! \brief Append to 'positions' the headers used to play [begin, end], by increasing
+     * prefetch deadline : the order in which they have to be fetched.
+     */
+    void prefetchSchedule(double begin, double end, std::vector<int> *positions) const;
+
+    static double prefetchDeadlineOf(const DrmAdditionalHeader &header); ///< prefetchDeadline, or startTimestamp when it has none
+
+private:
+    class Entry
+    {
+    public:
+        double time;
+        int position;
+    };
+
+    std::vector<Entry> m_byStart; // by startTimestamp
+    std::vector<Entry> m_byDeadline; // by prefetch deadline
+};
+
+#pragma GCC visibility pop
+
 /*! \brief The <dvrInfo> element represents all information needed to play DVR
  * media. It contains no content, only attributes. It is optional.
  *
@@ -113,13 +169,103 @@ public:
 class SmpteTimecode
 {
 public:
-    SmpteTimecode() : timestamp{-1.0} {}
+    SmpteTimecode() : timestamp{-1.0}, hours{-1}, minutes{-1}, seconds{-1}, frames{-1}, dropFrame{false} {}
     std::string smpte; ///< mandatory, format : “hour:minute:second:frame”
     double timestamp; ///< mandatory, format : decimal number of seconds
     std::string date; ///< optional, format : "YYYY-MM-DD"
     std::string timezone; ///< optional, format : "[+/-]hh:mm"
+
+    int hours; ///< parsed from smpte, -1 if it is malformed
+    int minutes; ///< parsed from smpte, -1 if it is malformed
+    int seconds; ///< parsed from smpte, -1 if it is malformed
+    int frames; ///< parsed from smpte, -1 if it is malformed
+    bool dropFrame; ///< true when the frames are separated by ';' or ',' (drop-frame timecode)
+};
+
+#pragma GCC visibility push(default)
+
+/*! \brief The SMPTE timecode samples of a media sorted by timestamp, and the mapping
+ * between presentation time and timecode they define.
+ *
+ * Media::smpteTimecodeIndex is built from Media::smpteTimeCodes and their parsed fields. A sample
+ * is referred to by its position in that vector, the index stays valid when the Media is copied
+ * but must be built again if its samples are modified.
+ * Between two samples the timecode advances at the frame rate, a conversion is anchored on the
+ * closest sample before it : the sample with the greatest timestamp, or timecode, not after the
+ * converted value (or the first one).
+ * The frame rate is guessed among the standard ones above the highest frame number of the samples :
+ * it is the only one mapping the first sample to the last within a tenth of a frame. With a single
+ * sample, samples too close to tell 24 from 23.976 fps for instance, or a timecode discontinuity,
+ * it stays unknown and no conversion is done until setFrameRate() is called.
+ * F4M 3.0 only
+ */
+class SmpteTimecodeIndex
+{
+public:
+    SmpteTimecodeIndex() : m_frameRate{0.}, m_nominalFrameRate{0}, m_dropFrame{false} {}
+
+    void build(const std::vector<SmpteTimecode> &timecodes); ///< The malformed samples (frames < 0) are not anchors.
+    void clear();
+    void setFrameRate(double frameRate);
+    double frameRate() const { return m_frameRate; } ///< 0 if unknown, no conversion is possible then.
+
+    bool   empty() const { return m_samples.empty(); }
+    size_t size() const { return m_samples.size(); }
+
+    /*! \brief The position of the sample with this timestamp and smpte, -1 if there is none.
+     */
+    int find(const std::vector<SmpteTimecode> &timecodes, double timestamp, const std::string &smpte) const;
+
+    /*! \brief The timecode of the frame displayed at 'timestamp' (seconds).
+     *
+     * Only the smpte string and the parsed fields of 'timecode' are set.
+     */
+    bool timecodeAt(double timestamp, SmpteTimecode *timecode) const;
+
+    /*! \brief The presentation time (seconds) of the frame with this timecode.
+     */
+    bool timestampOf(const SmpteTimecode &timecode, double *timestamp) const;
+    bool timestampOf(const std::string &smpte, double *timestamp) const;
+
+    /*! \brief Fill the parsed fields of 'timecode' from 'smpte', false if it is malformed.
+     */
+    static bool parseSmpte(const std::string &smpte, SmpteTimecode *timecode);
+
+private:
+    // a sample without its strings
+    class Sample
+    {
+    public:
+        double timestamp;
+        int position;
+        int hours;
+        int minutes;
+        int seconds;
+        int frames;
+    };
+
+    class Anchor
+    {
+    public:
+        double timestamp;
+        int64_t frameNumber;
+    };
+
+    int64_t frameNumber(int hours, int minutes, int seconds, int frames) const;
+    int64_t frameNumber(const Sample &sample) const;
+    void    setTimecode(int64_t frameNumber, bool dropFrame, SmpteTimecode *timecode) const;
+    void    buildAnchors();
+
+    std::vector<Sample> m_samples; // by timestamp
+    std::vector<Anchor> m_byTimestamp; // the well-formed samples
+    std::vector<Anchor> m_byFrameNumber;
+    double m_frameRate;
+    int m_nominalFrameRate; // frames counted in a timecode second
+    bool m_dropFrame;
 };
 
+#pragma GCC visibility pop
+
 /*! \brief convey a splice, a sequence of time within the presentation where content may be inserted.
  * Essentially for helping the client to insert advertising content.
  * F4M 3.0 only
@@ -137,6 +283,63 @@ public:
     std::string programId; ///<  optional, an identifier for the program content.
 };
 
+#pragma GCC visibility push(default)
+
+/*! \brief The cues of a <cueInfo> element, sorted by time.
+ *
+ * Media::cueIndex is built from Media::cueInfo. A cue is referred to by its position in that
+ * vector, the index stays valid when the Media is copied but must be built again if its cues
+ * are modified otherwise than by insert(). Lookups are binary searches on the start time,
+ * overlap queries walk an interval tree : O(log n) plus O(log n) per cue found.
+ * F4M 3.0 only
+ */
+class CueIndex
+{
+public:
+    void build(const std::vector<Cue> &cues); ///< Cues of equal time keep their order.
+    void clear() { m_byTime.clear(); m_latestEnd.clear(); }
+
+    bool   empty() const { return m_byTime.empty(); }
+    size_t size() const { return m_byTime.size(); }
+
+    /*! \brief The position of the cue with this time and id, -1 if there is none.
+     */
+    int find(const std::vector<Cue> &cues, double time, const std::string &id) const;
+
+    /*! \brief Append 'cue' to 'cues', the vector the index was built from, and index it.
+     *
+     * False if a cue with this id and time is already there. O(n).
+     */
+    bool insert(std::vector<Cue> *cues, const Cue &cue);
+
+    /*! \brief The position of the first cue starting at or after 'time', -1 if there is none.
+     */
+    int nextSplice(double time) const;
+
+    /*! \brief Append to 'positions' the cues whose [time, time + duration] intersects [begin, end],
+     * by increasing time.
+     */
+    void overlapping(double begin, double end, std::vector<int> *positions) const;
+
+private:
+    class Entry
+    {
+    public:
+        double time;
+        double end;
+        int position;
+    };
+
+    void   buildTree(size_t node, size_t first, size_t last);
+    void   collect(size_t node, size_t first, size_t last, size_t end, double begin,
+                   std::vector<int> *positions) const;
+
+    std::vector<Entry> m_byTime;
+    std::vector<double> m_latestEnd; // interval tree over m_byTime : the latest end of each node's range
+};
+
+#pragma GCC visibility pop
+
 
 /*! \brief Contain information needed to enable best-effort fetch support on HTTP streamed media.
  * only set level, multiple instance possible : only one for an adaptive set if id not present, apply to all medias
@@ -196,6 +399,7 @@ public:
 
     std::string cueInfoId; ///< The ID of a <cueInfo> element. Since F4M 3.0
     std::vector<Cue> cueInfo; ///< The collection of Cue associated with the media. Since F4M 3.0
+    CueIndex cueIndex; ///< Built from cueInfo by the parser. To build again if cueInfo is modified.
 
     std::string bestEffortFetchInfoId; ///< The ID of a <bestEffortFetchInfo> element. Since F4M 3.0
     BestEffortFetchInfo bestEffortFetchInfo; ///< store 'ideal' fragment and segment duration, deprecated. Since F4M 3.0
@@ -203,8 +407,10 @@ public:
     std::string drmAdditionalHeaderSetId; ///< F4M 3.0, to link several drmAdditionalHeader to a media
                                           ///< drmAdditionalHeaderId must not be present if this one is : exclusive
     std::vector<DrmAdditionalHeader> drmAdditionalHeaderSet; ///< For license rotation.
+    DrmAdditionalHeaderTimeline drmAdditionalHeaderTimeline; ///< Built from drmAdditionalHeaderSet by the parser. To build again if drmAdditionalHeaderSet is modified.
 
     std::vector<SmpteTimecode> smpteTimeCodes; ///< . Since F4M 3.0
+    SmpteTimecodeIndex smpteTimecodeIndex; ///< Built from smpteTimeCodes by the parser. To build again if smpteTimeCodes is modified.
 };
 
 /*! \brief Back-up/additionnal definition for medias
@@ -243,6 +449,8 @@ public:
     std::vector<std::string> profiles; ///< F4M 3.0 spec (says 2.0) , defaut to "urn://profile.adobe.com/F4F", list of hds profiles supported, each separated by a space. URN as specified in [RFC2142]
 
     std::vector<AdaptiveSet> adaptiveSets; ///< F4M 3.0 only : 'explicit' adaptive sets.
+
+    RenditionIndex renditions; ///< Built from medias and adaptiveSets, call renditions.build(*this) after modifying them.
 };
 
 #endif // MANIFEST_H
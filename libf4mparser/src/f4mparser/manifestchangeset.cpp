@@ -0,0 +1,262 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "manifestchangeset.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+template <class Sequence, class Equal>
+static bool sameSequence(const Sequence &a, const Sequence &b, Equal equal)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), equal);
+}
+
+static bool sameDvrInfo(const DvrInfo &a, const DvrInfo &b)
+{
+    return a.empty == b.empty && a.id == b.id && a.beginOffset == b.beginOffset
+            && a.endOffset == b.endOffset && a.offline == b.offline && a.url == b.url
+            && a.windowDuration == b.windowDuration;
+}
+
+static bool sameBootstrapInfo(const BootstrapInfo &a, const BootstrapInfo &b)
+{
+    return a.empty == b.empty && a.id == b.id && a.profile == b.profile && a.url == b.url
+            && a.fragmentDuration == b.fragmentDuration && a.segmentDuration == b.segmentDuration
+            && a.data == b.data;
+}
+
+static bool sameDrmAdditionalHeader(const DrmAdditionalHeader &a, const DrmAdditionalHeader &b)
+{
+    return a.empty == b.empty && a.id == b.id && a.url == b.url
+            && a.prefetchDeadline == b.prefetchDeadline && a.startTimestamp == b.startTimestamp
+            && a.data == b.data;
+}
+
+static bool sameBestEffortFetchInfo(const BestEffortFetchInfo &a, const BestEffortFetchInfo &b)
+{
+    return a.empty == b.empty && a.id == b.id && a.fragmentDuration == b.fragmentDuration
+            && a.segmentDuration == b.segmentDuration;
+}
+
+static bool sameCue(const Cue &a, const Cue &b)
+{
+    return a.time == b.time && a.id == b.id && a.duration == b.duration && a.type == b.type
+            && a.availNum == b.availNum && a.availsExpected == b.availsExpected
+            && a.programId == b.programId;
+}
+
+static bool sameSmpteTimecode(const SmpteTimecode &a, const SmpteTimecode &b)
+{
+    return a.timestamp == b.timestamp && a.smpte == b.smpte && a.date == b.date
+            && a.timezone == b.timezone;
+}
+
+static bool sameAttributes(const Media &a, const Media &b)
+{
+    return a.bitrate == b.bitrate && a.width == b.width && a.height == b.height
+            && a.streamId == b.streamId && a.alternate == b.alternate && a.type == b.type
+            && a.label == b.label && a.lang == b.lang && a.groupspec == b.groupspec
+            && a.multicastStreamName == b.multicastStreamName
+            && a.audioCodec == b.audioCodec && a.videoCodec == b.videoCodec
+            && a.bootstrapInfoId == b.bootstrapInfoId
+            && a.drmAdditionalHeaderId == b.drmAdditionalHeaderId && a.dvrInfoId == b.dvrInfoId
+            && a.cueInfoId == b.cueInfoId && a.bestEffortFetchInfoId == b.bestEffortFetchInfoId
+            && a.drmAdditionalHeaderSetId == b.drmAdditionalHeaderSetId;
+}
+
+static bool sameManifestFields(const Manifest &a, const Manifest &b)
+{
+    return a.id == b.id && a.duration == b.duration && a.startTime == b.startTime
+            && a.mimeType == b.mimeType && a.streamType == b.streamType
+            && a.deliveryType == b.deliveryType && a.label == b.label && a.lang == b.lang
+            && a.baseURL == b.baseURL && a.profiles == b.profiles
+            && a.adaptiveSets.size() == b.adaptiveSets.size();
+}
+
+// a cue is new if no previous cue has its time and id
+static void findNewCues(const Media &previous, const Media &current, std::vector<Cue> *cues)
+{
+    for (auto &cue : current.cueInfo) {
+        if (previous.cueIndex.find(previous.cueInfo, cue.time, cue.id) < 0) {
+            cues->push_back(cue);
+        }
+    }
+    std::stable_sort(cues->begin(), cues->end(), [](const Cue &a, const Cue &b) {
+        return a.time < b.time;
+    });
+}
+
+// a sample is new if no previous sample has its timestamp and smpte
+static void findNewSmpteTimecodes(const Media &previous, const Media &current,
+                                  std::vector<SmpteTimecode> *timecodes)
+{
+    for (auto &timecode : current.smpteTimeCodes) {
+        if (previous.smpteTimecodeIndex.find(previous.smpteTimeCodes, timecode.timestamp,
+                                             timecode.smpte) < 0) {
+            timecodes->push_back(timecode);
+        }
+    }
+    std::stable_sort(timecodes->begin(), timecodes->end(),
+                     [](const SmpteTimecode &a, const SmpteTimecode &b) {
+        return a.timestamp < b.timestamp;
+    });
+}
+
+static void compareMedias(const Media &previous, const Media &current, MediaChange *change)
+{
+    if (previous.url != current.url) {
+        change->fields |= MediaChange::FIELD_URL;
+    }
+    if (previous.href != current.href) {
+        change->fields |= MediaChange::FIELD_HREF;
+    }
+    if (!sameDvrInfo(previous.dvrInfo, current.dvrInfo)) {
+        change->fields |= MediaChange::FIELD_DVR_INFO;
+    }
+    if (!sameBootstrapInfo(previous.bootstrapInfo, current.bootstrapInfo)) {
+        change->fields |= MediaChange::FIELD_BOOTSTRAP_INFO;
+    }
+    if (!sameDrmAdditionalHeader(previous.drmAdditionalHeader, current.drmAdditionalHeader)) {
+        change->fields |= MediaChange::FIELD_DRM_ADDITIONAL_HEADER;
+    }
+    if (!sameSequence(previous.drmAdditionalHeaderSet, current.drmAdditionalHeaderSet,
+                      sameDrmAdditionalHeader)) {
+        change->fields |= MediaChange::FIELD_DRM_ADDITIONAL_HEADER_SET;
+    }
+    if (!sameSequence(previous.cueInfo, current.cueInfo, sameCue)) {
+        change->fields |= MediaChange::FIELD_CUES;
+        findNewCues(previous, current, &change->newCues);
+    }
+    if (!sameSequence(previous.smpteTimeCodes, current.smpteTimeCodes, sameSmpteTimecode)) {
+        change->fields |= MediaChange::FIELD_SMPTE_TIMECODES;
+        findNewSmpteTimecodes(previous, current, &change->newSmpteTimecodes);
+    }
+    if (previous.metadata != current.metadata || previous.xmpMetadata != current.xmpMetadata
+            || previous.moov != current.moov) {
+        change->fields |= MediaChange::FIELD_METADATA;
+    }
+    if (!sameBestEffortFetchInfo(previous.bestEffortFetchInfo, current.bestEffortFetchInfo)) {
+        change->fields |= MediaChange::FIELD_BEST_EFFORT_FETCH_INFO;
+    }
+    if (!sameAttributes(previous, current)) {
+        change->fields |= MediaChange::FIELD_ATTRIBUTES;
+    }
+}
+
+// what identifies a media from one version of the manifest to the next
+static std::string identity(int set, const Media &media)
+{
+    std::string key = std::to_string(set);
+    if (!media.streamId.empty()) {
+        key += "\x1fs\x1f";
+        key += media.streamId;
+    } else {
+        key += "\x1f" + media.bitrate + "\x1f" + std::to_string(media.width)
+                + "\x1f" + std::to_string(media.height) + "\x1f" + media.type
+                + "\x1f" + media.lang + "\x1f" + media.label;
+    }
+    return key;
+}
+
+void ManifestChangeSet::clear()
+{
+    manifestChanged = false;
+    added.clear();
+    removed.clear();
+    changed.clear();
+}
+
+void ManifestChangeSet::compute(const Manifest &previous, const Manifest &current)
+{
+    clear();
+
+    manifestChanged = !sameManifestFields(previous, current);
+
+    auto forEachMedia = [](const Manifest &manifest,
+            std::function<void (const MediaPosition &, const Media &)> func) {
+        for (size_t i = 0; i < manifest.medias.size(); i++) {
+            func(MediaPosition(-1, i), manifest.medias[i]);
+        }
+        for (size_t set = 0; set < manifest.adaptiveSets.size(); set++) {
+            auto &medias = manifest.adaptiveSets[set].medias;
+            for (size_t i = 0; i < medias.size(); i++) {
+                func(MediaPosition(set, i), medias[i]);
+            }
+        }
+    };
+
+    // previous medias not matched yet, by identity, in document order
+    std::unordered_multimap<std::string, MediaPosition> unmatched;
+    forEachMedia(previous, [&](const MediaPosition &position, const Media &media) {
+        unmatched.emplace(identity(position.set, media), position);
+    });
+
+    forEachMedia(current, [&](const MediaPosition &position, const Media &media) {
+        auto candidates = unmatched.equal_range(identity(position.set, media));
+        if (candidates.first == candidates.second) {
+            added.push_back(position);
+            return;
+        }
+        // equal_range gives no order guarantee : take the first in the document
+        auto match = candidates.first;
+        for (auto it = candidates.first; it != candidates.second; ++it) {
+            if (it->second.index < match->second.index) {
+                match = it;
+            }
+        }
+        MediaChange change;
+        change.position = position;
+        change.previousPosition = match->second;
+        unmatched.erase(match);
+
+        compareMedias(*ManifestChangeSet::media(previous, change.previousPosition), media, &change);
+        if (change.fields != 0) {
+            changed.push_back(std::move(change));
+        }
+    });
+
+    for (auto &entry : unmatched) {
+        removed.push_back(entry.second);
+    }
+    std::sort(removed.begin(), removed.end(), [](const MediaPosition &a, const MediaPosition &b) {
+        return a.set != b.set ? a.set < b.set : a.index < b.index;
+    });
+}
+
+const Media* ManifestChangeSet::media(const Manifest &manifest, const MediaPosition &position)
+{
+    const std::vector<Media> *medias = &manifest.medias;
+    if (position.set >= 0) {
+        if (static_cast<size_t>(position.set) >= manifest.adaptiveSets.size()) {
+            return nullptr;
+        }
+        medias = &manifest.adaptiveSets[position.set].medias;
+    }
+    if (position.index < 0 || static_cast<size_t>(position.index) >= medias->size()) {
+        return nullptr;
+    }
+    return &(*medias)[position.index];
+}
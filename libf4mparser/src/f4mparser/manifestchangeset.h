@@ -0,0 +1,108 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file manifestchangeset.h
+ *  \brief What changed between two parses of a live manifest.
+ *
+ *  A media of the new manifest is matched with a media of the previous one in the same
+ *  adaptive set, by streamId or, when it has none, by its bitrate, size, type, language
+ *  and label. Medias with the same identity are matched in document order.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef MANIFESTCHANGESET_H
+#define MANIFESTCHANGESET_H
+
+#include "manifest.h"
+
+#pragma GCC visibility push(default)
+
+/*! \brief The place of a media in a manifest.
+ */
+class MediaPosition
+{
+public:
+    MediaPosition() : set{-1}, index{-1} {}
+    MediaPosition(int set, int index) : set{set}, index{index} {}
+
+    int set; ///< -1 for Manifest::medias, else the position in Manifest::adaptiveSets
+    int index; ///< position of the media in its medias vector
+};
+
+/*! \brief A media present in both manifests whose content changed.
+ */
+class MediaChange
+{
+public:
+    enum Field {
+        FIELD_URL = 1 << 0,
+        FIELD_HREF = 1 << 1,
+        FIELD_DVR_INFO = 1 << 2, ///< the DVR window moved, or the stream went offline
+        FIELD_BOOTSTRAP_INFO = 1 << 3,
+        FIELD_DRM_ADDITIONAL_HEADER = 1 << 4,
+        FIELD_DRM_ADDITIONAL_HEADER_SET = 1 << 5,
+        FIELD_CUES = 1 << 6, ///< cues were added, removed or modified
+        FIELD_SMPTE_TIMECODES = 1 << 7, ///< samples were added, removed or modified
+        FIELD_METADATA = 1 << 8, ///< metadata, xmpMetadata or moov
+        FIELD_BEST_EFFORT_FETCH_INFO = 1 << 9,
+        FIELD_ATTRIBUTES = 1 << 10 ///< any other member of Media, the ids of the referenced elements included
+    };
+
+    MediaChange() : fields{0} {}
+
+    bool has(Field field) const { return (fields & field) != 0; }
+
+    MediaPosition position; ///< in the new manifest
+    MediaPosition previousPosition; ///< in the previous manifest
+    unsigned fields; ///< the Field values which changed, or-ed
+    std::vector<Cue> newCues; ///< cues of the new manifest without a cue of the same id and time in the previous one, by time
+    std::vector<SmpteTimecode> newSmpteTimecodes; ///< samples of the new manifest not in the previous one, by timestamp
+};
+
+/*! \brief The differences between two versions of a manifest.
+ */
+class ManifestChangeSet
+{
+public:
+    ManifestChangeSet() : manifestChanged{false} {}
+
+    /*! \brief Fill the change set with the differences from 'previous' to 'current'.
+     */
+    void compute(const Manifest &previous, const Manifest &current);
+    void clear();
+    bool empty() const { return !manifestChanged && added.empty() && removed.empty() && changed.empty(); }
+
+    /*! \brief The media at 'position', nullptr if the manifest has none there.
+     */
+    static const Media* media(const Manifest &manifest, const MediaPosition &position);
+
+    bool manifestChanged; ///< a member of Manifest which is not a media changed : id, duration, streamType, baseURL...
+    std::vector<MediaPosition> added; ///< medias of the new manifest, by position
+    std::vector<MediaPosition> removed; ///< medias of the previous manifest, by position
+    std::vector<MediaChange> changed; ///< by position in the new manifest
+};
+
+#pragma GCC visibility pop
+
+#endif // MANIFESTCHANGESET_H
@@ -23,20 +23,17 @@
 
 #include "manifestdoc.h"
 
-#include <cstring> // strchr
+#include "mappedfile.h"
+#include "numberutils.h"
+#include "diagline.h"
 
-#ifndef F4M_DEBUG
-#define F4M_DLOG(x)
-#else
-#include <iostream>  // std::cerr
-#define F4M_DLOG(x) do { x } while(0)
-#endif
+#include <cstring> // strchr
 
 // ns
 const std::string ManifestDoc::m_nsF4mBase("http://ns.adobe.com/f4m/");
 
 ManifestDoc::ManifestDoc(std::string url)
-    : m_fileUrl(url), m_major(0), m_minor(0), m_manifestLevel(UNKNOWN_LEVEL)
+    : m_fileUrl(url), m_xmlSize(0), m_major(0), m_minor(0), m_manifestLevel(UNKNOWN_LEVEL)
 {
 }
 
@@ -44,6 +41,20 @@ ManifestDoc::~ManifestDoc()
 {
 }
 
+void ManifestDoc::reset(const std::string &url)
+{
+    m_fileUrl = url;
+    // the document may point into the mapping
+    m_doc.reset();
+    if (m_mappedFile) {
+        m_mappedFile->close();
+    }
+    m_xmlSize = 0;
+    m_major = 0;
+    m_minor = 0;
+    m_manifestLevel = UNKNOWN_LEVEL;
+}
+
 // the F4M 3.0 spec says only '1.0' '2.0' and '3.0' values are valid
 bool ManifestDoc::setVersion(std::string version)
 {
@@ -51,11 +62,11 @@ bool ManifestDoc::setVersion(std::string version)
     int major = 1, minor = 0;
     size_t pos;
     if ((pos = version.find('.')) != std::string::npos) {
-        try { major = std::stoi(version.substr(0, pos)); } catch (...) {
+        if (NumberUtils::parseInt(version.c_str(), &major) == false) {
             major = 1;
             ret = false;
         }
-        try { minor = std::stoi(version.substr(pos + 1)); } catch (...) {
+        if (NumberUtils::parseInt(version.c_str() + pos + 1, &minor) == false) {
             major = 1;
             minor = 0;
             ret = false;
@@ -82,10 +93,46 @@ bool ManifestDoc::setXmlDoc(std::vector<uint8_t> rawDoc)
 {
     // set the raw buffer
     m_xmlRawBuffer = std::move(rawDoc);
+    m_xmlSize = m_xmlRawBuffer.size();
 
     pugi::xml_parse_result result = m_doc.load_buffer_inplace(m_xmlRawBuffer.data(), m_xmlRawBuffer.size());
     if (!result) {
-        F4M_DLOG(std::cerr << __func__ << " Error description: " << result.description() << "\n";);
+        F4M_DIAG(DIAG_WARNING) << "Error description: " << result.description();
+        return false;
+    }
+
+    return true;
+}
+
+// the raw buffer keeps its capacity from one document given by pointer to the next
+bool ManifestDoc::setXmlDoc(const uint8_t *data, size_t size)
+{
+    m_xmlRawBuffer.assign(data, data + size);
+    m_xmlSize = size;
+    pugi::xml_parse_result result = m_doc.load_buffer_inplace(m_xmlRawBuffer.data(), m_xmlRawBuffer.size());
+    if (!result) {
+        F4M_DIAG(DIAG_WARNING) << "Error description: " << result.description();
+        return false;
+    }
+
+    return true;
+}
+
+bool ManifestDoc::setXmlDocFromFile(const std::string &path)
+{
+    // copy on write : pugixml modify the buffer while parsing in place
+    if (!m_mappedFile) {
+        m_mappedFile.reset(new MappedFile);
+    }
+    if (!m_mappedFile->open(path, true)) {
+        F4M_DIAG(DIAG_WARNING) << "can't map " << path;
+        return false;
+    }
+    m_xmlSize = m_mappedFile->size();
+
+    pugi::xml_parse_result result = m_doc.load_buffer_inplace(m_mappedFile->data(), m_mappedFile->size());
+    if (!result) {
+        F4M_DIAG(DIAG_WARNING) << "Error description: " << result.description();
         return false;
     }
 
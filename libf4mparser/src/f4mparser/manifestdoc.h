@@ -26,9 +26,12 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include <pugixml.hpp>
 
+class MappedFile;
+
 // manage what is specific to the manifest (not to the media presentation)
 
 class ManifestDoc
@@ -47,6 +50,10 @@ public:
     explicit ManifestDoc(std::string url);
     ~ManifestDoc();
 
+    // for the next document : the object and its mapping object are kept, pugixml frees its pages.
+    // The raw buffer keeps its capacity only for setXmlDoc(data, size), a downloaded document replaces it
+    void reset(const std::string &url);
+
     bool setVersion(std::string version);
     int  versionMajor() const { return m_major; }
     int  versionMinor() const { return m_minor; }
@@ -63,7 +70,10 @@ public:
     const std::string&  fileUrl() const { return m_fileUrl; }
 
     pugi::xml_document& doc() { return m_doc; }
-    bool                setXmlDoc(std::vector<uint8_t> rawDoc);
+    bool                setXmlDoc(std::vector<uint8_t> rawDoc);  // taken over as the raw buffer, the previous one is freed
+    bool                setXmlDoc(const uint8_t *data, size_t size);  // copied in the raw buffer
+    bool                setXmlDocFromFile(const std::string &path);  // parsed in place in a private mapping
+    size_t              xmlSize() const { return m_xmlSize; }  // size of the last document given to pugixml
 
     std::string         rootNs();
     std::string         selectNs();
@@ -73,6 +83,8 @@ private:
 
     pugi::xml_document m_doc;
     std::vector<uint8_t> m_xmlRawBuffer; // hods the buffer for pugixml
+    std::unique_ptr<MappedFile> m_mappedFile; // or the file mapping
+    size_t m_xmlSize;
 
     int m_major;
     int m_minor;
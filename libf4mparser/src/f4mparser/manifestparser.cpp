@@ -24,160 +24,356 @@
 #include "manifestparser.h"
 
 #include "urlutils.h"
+#include "diagline.h"
+#include "f4mnames.h"
 
 #include <cstring>
 #include <pugixml.hpp>
 
-#ifndef F4M_DEBUG
-#define F4M_DLOG(x)
-#else
-#include <iostream> // std::cerr
-#define F4M_DLOG(x) do { x } while(0)
-#endif
-
 ManifestParser::ManifestParser(void *downloadFileUserPtr,
                                ManifestParser::DOWNLOAD_FILE_FUNCTION downloadFileFctPtr)
-    : m_downloadFileUserPtr(downloadFileUserPtr), m_downloadFileFctPtr(downloadFileFctPtr)
+    : m_callbackDownloader(downloadFileUserPtr, downloadFileFctPtr),
+      m_downloader(downloadFileFctPtr ? &m_callbackDownloader : nullptr),
+      m_sectionParsers(&s_sectionParsers[0]), m_skip(0),
+      m_random(std::chrono::steady_clock::now().time_since_epoch().count())
+{
+}
+
+ManifestParser::ManifestParser(Downloader *downloader)
+    : m_callbackDownloader(nullptr, nullptr), m_downloader(downloader),
+      m_sectionParsers(&s_sectionParsers[0]), m_skip(0),
+      m_random(std::chrono::steady_clock::now().time_since_epoch().count())
+{
+}
+
+void ManifestParser::setParseOptions(const ParseOptions &options)
+{
+    m_instruments.stats = options.stats;
+    m_instruments.tracer = options.tracer;
+    m_instruments.nextSpanId = 1;
+    m_skip = options.skip;
+    m_budget.start(options.limits);
+    m_retry = options.retry;
+    // no parse sees the blobs of a previous manifest given to an earlier call
+    m_previousBlobs.clear();
+}
+
+void ManifestParser::setPreviousManifest(const Manifest *previous)
+{
+    m_previousBlobs.clear();
+    if (previous == nullptr) {
+        return;
+    }
+    for (auto &media : previous->medias) {
+        addPreviousBlobs(media);
+    }
+    for (auto &aSet : previous->adaptiveSets) {
+        for (auto &media : aSet.medias) {
+            addPreviousBlobs(media);
+        }
+    }
+}
+
+ParseOptions::Error ManifestParser::error() const
 {
+    return m_budget.exceeded() ? m_budget.error() : ParseOptions::ERROR_FAILED;
 }
 
 bool ManifestParser::parse(std::string url, Manifest *manifest)
 {
-    m_f4mDoc = std::unique_ptr<ManifestDoc>(new ManifestDoc{url});
+    return load(url) && parseDocument(manifest);
+}
+
+bool ManifestParser::parse(const std::string &url, Manifest *manifest, const ParseOptions &options)
+{
+    return parseWith(options, [&]() { return parse(url, manifest); });
+}
+
+bool ManifestParser::parseBuffer(const uint8_t *data, size_t size, const std::string &url,
+                                 Manifest *manifest, const ParseOptions &options)
+{
+    return parseWith(options, [&]() { return parseBuffer(data, size, url, manifest); });
+}
+
+bool ManifestParser::refresh(const std::string &url, const Manifest &previous, Manifest *manifest,
+                             ManifestChangeSet *changes, const ParseOptions &options)
+{
+    // 'previous' belongs to the caller : its blobs are forgotten on every way out,
+    // an exception included, before the parser goes back to a pool
+    class PreviousManifest
+    {
+    public:
+        PreviousManifest(ManifestParser *parser, const Manifest *previous) : m_parser(parser) {
+            m_parser->setPreviousManifest(previous);
+        }
+        ~PreviousManifest() { m_parser->setPreviousManifest(nullptr); }
+
+    private:
+        ManifestParser *m_parser;
+    };
+
+    // 'manifest' may be 'previous' : it is kept until the change set is computed
+    bool ret = parseWith(options, [&]() {
+        PreviousManifest previousBlobs(this, &previous);
+        Manifest refreshed;
+        if (!parse(url, &refreshed)) {
+            if (changes) {
+                changes->clear();
+            }
+            return false;
+        }
+        if (changes) {
+            changes->compute(previous, refreshed);
+        }
+        *manifest = std::move(refreshed);
+        return true;
+    });
+
+    return ret;
+}
+
+bool ManifestParser::parseBuffer(std::vector<uint8_t> buffer, const std::string &url, Manifest *manifest)
+{
+    return loadBuffer(std::move(buffer), url) && parseDocument(manifest);
+}
+
+bool ManifestParser::parseBuffer(const uint8_t *data, size_t size, const std::string &url,
+                                 Manifest *manifest)
+{
+    return loadBuffer(data, size, url) && parseDocument(manifest);
+}
+
+bool ManifestParser::parseFile(const std::string &path, Manifest *manifest)
+{
+    return loadFile(path) && parseDocument(manifest);
+}
+
+bool ManifestParser::visit(std::string url, ManifestVisitor *visitor)
+{
+    return load(url) && visitDocument(visitor);
+}
+
+bool ManifestParser::visitBuffer(const uint8_t *data, size_t size, const std::string &url,
+                                 ManifestVisitor *visitor)
+{
+    return loadBuffer(data, size, url) && visitDocument(visitor);
+}
+
+bool ManifestParser::visitFile(const std::string &path, ManifestVisitor *visitor)
+{
+    return loadFile(path) && visitDocument(visitor);
+}
+
+// the document object of the previous parse is reused, see ManifestDoc::reset
+void ManifestParser::resetDoc(const std::string &url)
+{
+    if (m_f4mDoc) {
+        m_f4mDoc->reset(url);
+    } else {
+        m_f4mDoc = std::unique_ptr<ManifestDoc>(new ManifestDoc{url});
+    }
+}
+
+bool ManifestParser::load(const std::string &url)
+{
+    resetDoc(url);
 
-    if (!initManifestParser()) {
+    if (UrlUtils::haveHttpScheme(m_f4mDoc->fileUrl()) == false) {
+        F4M_DIAG(DIAG_WARNING) << "manifest url scheme don't begin with http";
         return false;
     }
 
-    setManifestLevel();
+    return initManifestParser(TraceSpan::SPAN_MANIFEST_DOWNLOAD);
+}
 
-    *manifest = parseManifest();
+// url is the location of the document, relative urls are resolved against it
+bool ManifestParser::loadBuffer(std::vector<uint8_t> buffer, const std::string &url)
+{
+    resetDoc(url);
 
-    if (m_f4mDoc->isSetLevel()) {
-        parseMLStreamManifests(manifest);
+    bool loaded;
+    {
+        PhaseTimer timer(&m_instruments, ParseStats::PHASE_LOAD_XML, &m_f4mDoc->fileUrl());
+        loaded = !buffer.empty() && m_f4mDoc->setXmlDoc(std::move(buffer));
+        timer.setResult(m_f4mDoc->xmlSize(), loaded ? 0 : -1);
+    }
+    if (!loaded) {
+        F4M_DIAG(DIAG_WARNING) << "setXmlDoc failed";
+        return false;
     }
 
+    setManifestVersion(m_f4mDoc->rootNs());
+
     return true;
 }
 
-bool ManifestParser::initManifestParser()
+bool ManifestParser::loadBuffer(const uint8_t *data, size_t size, const std::string &url)
 {
-    if (m_f4mDoc->fileUrl().empty()) {
-        F4M_DLOG(std::cerr << __func__ << " manifest url empty" << std::endl;);
+    resetDoc(url);
+
+    bool loaded;
+    {
+        PhaseTimer timer(&m_instruments, ParseStats::PHASE_LOAD_XML, &m_f4mDoc->fileUrl());
+        loaded = data && size != 0 && m_f4mDoc->setXmlDoc(data, size);
+        timer.setResult(m_f4mDoc->xmlSize(), loaded ? 0 : -1);
+    }
+    if (!loaded) {
+        F4M_DIAG(DIAG_WARNING) << "setXmlDoc failed";
         return false;
     }
 
-    if (UrlUtils::haveHttpScheme(m_f4mDoc->fileUrl()) == false) {
-        F4M_DLOG(std::cerr << __func__
-                 << " manifest url scheme don't begin with http" << std::endl;);
+    setManifestVersion(m_f4mDoc->rootNs());
+
+    return true;
+}
+
+// relative hrefs are resolved against the path, the download function gets them as is
+bool ManifestParser::loadFile(const std::string &path)
+{
+    resetDoc(path);
+
+    bool loaded;
+    {
+        PhaseTimer timer(&m_instruments, ParseStats::PHASE_LOAD_XML, &m_f4mDoc->fileUrl());
+        loaded = !path.empty() && m_f4mDoc->setXmlDocFromFile(path);
+        timer.setResult(m_f4mDoc->xmlSize(), loaded ? 0 : -1);
+    }
+    if (!loaded) {
+        F4M_DIAG(DIAG_WARNING) << "setXmlDocFromFile failed";
         return false;
     }
 
-    std::vector<uint8_t> response;
-    if (downloadF4mFile(&response) == false) {
-        F4M_DLOG(std::cout << __func__ << " failed to dowload manifest" << std::endl;);
-        return false;
+    setManifestVersion(m_f4mDoc->rootNs());
+
+    return true;
+}
+
+bool ManifestParser::parseDocument(Manifest *manifest)
+{
+    setManifestLevel();
+
+    Manifest parsed = parseManifest();
+
+    if (m_f4mDoc->isSetLevel() && !skips(ParseOptions::SKIP_STREAM_MANIFESTS)) {
+        parseMLStreamManifests(&parsed);
     }
 
-    if (m_f4mDoc->setXmlDoc(std::move(response)) == false) {
-        F4M_DLOG(std::cerr << __func__ << " setXmlDoc failed" << std::endl;);
+    // a partial manifest is not handed out
+    if (m_budget.exceeded()) {
         return false;
     }
 
-    setManifestVersion(m_f4mDoc->rootNs());
+    parsed.renditions.build(parsed);
+    *manifest = std::move(parsed);
 
     return true;
 }
 
-Manifest ManifestParser::parseManifest()
+bool ManifestParser::parseWith(const ParseOptions &options, const std::function<bool ()> &run)
 {
-    Manifest manifest;
-    if (m_f4mDoc->versionMajor() >= 2) {
-        getManifestProfiles(&manifest);
+    if (options.stats) {
+        options.stats->reset();
     }
+    auto start = std::chrono::steady_clock::now();
 
-    std::string query{"/manifest" + m_f4mDoc->selectNs() + "/*" + m_f4mDoc->selectNs()};
+    setParseOptions(options);
+    bool ret = run();
 
-    pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
+    if (options.error) {
+        *options.error = ret ? ParseOptions::ERROR_NONE : error();
+    }
+    if (options.stats) {
+        options.stats->totalNs = PhaseTimer::elapsedNs(start);
+    }
+    return ret;
+}
 
-    for (auto &node : nodes) {
-        if (nodeNameIs(node, "baseURL")) {
-            manifest.baseURL = getNodeContentAsString(node);
-        } else if (nodeNameIs(node, "startTime")) {
-            manifest.startTime = getNodeContentAsString(node);
-        } else if (nodeNameIs(node, "mimeType")) {
-            manifest.mimeType = getNodeContentAsString(node);
-        } else if (nodeNameIs(node, "streamType")) {
-            manifest.streamType = getNodeContentAsString(node);
-        } else if (nodeNameIs(node, "deliveryType")) {
-            manifest.deliveryType = getNodeContentAsString(node);
-        } else if (nodeNameIs(node, "label")) {
-            manifest.label = getNodeContentAsString(node);
-        } else if (nodeNameIs(node, "id")) {
-            manifest.id = getNodeContentAsString(node);
-        } else if (nodeNameIs(node, "lang")) {
-            manifest.lang = getNodeContentAsString(node);
-        }  else if (nodeNameIs(node, "duration")) {
-            manifest.duration = getNodeContentAsNumber(node);
-        }
-        // report element we don't parse
-        else if ((nodeNameIs(node, "media")
-                  || nodeNameIs(node, "bootstrapInfo")
-                  || nodeNameIs(node, "dvrInfo")
-                  || nodeNameIs(node, "drmAdditionalHeader")
-                  || nodeNameIs(node, "smpteTimecodes")
-                  || nodeNameIs(node, "cueInfo")
-                  || nodeNameIs(node, "bestEffortFetchInfo")
-                  || nodeNameIs(node, "drmAdditionalHeaderSet")
-                  || nodeNameIs(node, "adaptiveSet")) == false) {
-            F4M_DLOG(std::cerr << __func__ <<  " : node : ["
-                     << node.node().name() << "] ignored" << std::endl;);
-            getNodeContentAsString(node);
-        }
+bool ManifestParser::initManifestParser(TraceSpan::Kind downloadKind)
+{
+    if (m_f4mDoc->fileUrl().empty()) {
+        F4M_DIAG(DIAG_WARNING) << "manifest url empty";
+        return false;
     }
 
-    if (!manifest.deliveryType.empty() && manifest.deliveryType != "streaming"
-            && manifest.deliveryType != "progressive") {
-        F4M_DLOG(std::cerr << __func__ <<  "deliveryType invalid "
-                 << manifest.deliveryType << std::endl;);
-        manifest.deliveryType.clear();  // 'streaming' is the one used in practice
+    std::vector<uint8_t> response;
+    if (downloadF4mFile(&response, downloadKind) == false) {
+        F4M_DIAG(DIAG_WARNING) << "failed to dowload manifest";
+        return false;
     }
 
-    if (!manifest.streamType.empty() && manifest.streamType != "live"
-            && manifest.streamType != "recorded"
-            && manifest.streamType != "liveOrRecorded") {
-        F4M_DLOG(std::cerr << __func__ <<  "streamType invalid "
-                 << manifest.streamType << std::endl;);
-        manifest.streamType.clear();  // or fallback to default "liveOrRecorded"
+    bool loaded;
+    {
+        PhaseTimer timer(&m_instruments, ParseStats::PHASE_LOAD_XML, &m_f4mDoc->fileUrl());
+        loaded = m_f4mDoc->setXmlDoc(std::move(response));
+        timer.setResult(m_f4mDoc->xmlSize(), loaded ? 0 : -1);
+    }
+    if (!loaded) {
+        F4M_DIAG(DIAG_WARNING) << "setXmlDoc failed";
+        return false;
     }
 
-    if (manifest.baseURL.empty()) {
-        manifest.baseURL = sanitizeBaseUrl(m_f4mDoc->fileUrl());
+    setManifestVersion(m_f4mDoc->rootNs());
+
+    return true;
+}
+
+bool ManifestParser::visitDocument(ManifestVisitor *visitor)
+{
+    setManifestLevel();
+
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_MANIFEST, &m_f4mDoc->fileUrl());
+
+    Manifest header;
+    parseManifestHeader(&header);
+
+    if (visitor->onManifestHeader(header) == ManifestVisitor::VISIT) {
+        (this->*m_sectionParsers->visitSections)(visitor);
     }
 
+    return !m_budget.exceeded();
+}
+
+Manifest ManifestParser::parseManifest()
+{
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_MANIFEST, &m_f4mDoc->fileUrl());
+
+    Manifest manifest;
+    parseManifestHeader(&manifest);
+
     parseMedias(&manifest);
 
     if (m_f4mDoc->versionMajor() >= 3
-            && m_f4mDoc->isMultiLevelStreamLevel() == false) {
+            && m_f4mDoc->isMultiLevelStreamLevel() == false
+            && !skips(ParseOptions::SKIP_ADAPTIVE_SETS)) {
         parseAdaptiveSets(&manifest);
     }
 
-    if (m_f4mDoc->isMultiLevelStreamLevel() == false) {
+    if (m_f4mDoc->isMultiLevelStreamLevel() == false && !skips(ParseOptions::SKIP_DVR_INFOS)) {
         parseDvrInfos(&manifest);
     }
 
     if (m_f4mDoc->isSetLevel() == false) {
-        parseDrmAdditionalHeaders(&manifest);
-        parseBootstrapInfos(&manifest);
+        if (!skips(ParseOptions::SKIP_DRM_ADDITIONAL_HEADERS)) {
+            parseDrmAdditionalHeaders(&manifest);
+        }
+        if (!skips(ParseOptions::SKIP_BOOTSTRAP_INFOS)) {
+            parseBootstrapInfos(&manifest);
+        }
     }
 
     if (m_f4mDoc->versionMajor() >= 3 ) {
         if (m_f4mDoc->isSetLevel() == false) {
-            parseSmpteTimeCodes(&manifest);
-            parseCueInfos(&manifest);
-            parseDrmAdditionalHeaderSets(&manifest);
+            if (!skips(ParseOptions::SKIP_SMPTE_TIMECODES)) {
+                parseSmpteTimeCodes(&manifest);
+            }
+            if (!skips(ParseOptions::SKIP_CUE_INFOS)) {
+                parseCueInfos(&manifest);
+            }
+            if (!skips(ParseOptions::SKIP_DRM_ADDITIONAL_HEADER_SETS)) {
+                parseDrmAdditionalHeaderSets(&manifest);
+            }
         }
-        if (m_f4mDoc->isSetLevel() == true) {
+        if (m_f4mDoc->isSetLevel() == true && !skips(ParseOptions::SKIP_BEST_EFFORT_FETCH_INFOS)) {
             parseBestEffortFetchInfos(&manifest);
         }
     }
@@ -185,20 +381,134 @@ Manifest ManifestParser::parseManifest()
     return manifest;
 }
 
+// the elements of <manifest> which are not sections, and the base url
+void ManifestParser::parseManifestHeader(Manifest *manifest)
+{
+    if (m_f4mDoc->versionMajor() >= 2) {
+        getManifestProfiles(manifest);
+    }
+
+    std::string query{"/manifest" + m_f4mDoc->selectNs() + "/*" + m_f4mDoc->selectNs()};
+
+    pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
+
+    for (auto &node : nodes) {
+        if (!countNodes(1)) {
+            break;
+        }
+        switch (F4mNames::manifestChild<F4mNames::ALL>(node.node().name())) {
+        case F4mNames::BASE_URL:
+            manifest->baseURL = getNodeContentAsString(node);
+            break;
+        case F4mNames::START_TIME:
+            manifest->startTime = getNodeContentAsString(node);
+            break;
+        case F4mNames::MIME_TYPE:
+            manifest->mimeType = getNodeContentAsString(node);
+            break;
+        case F4mNames::STREAM_TYPE:
+            manifest->streamType = getNodeContentAsString(node);
+            break;
+        case F4mNames::DELIVERY_TYPE:
+            manifest->deliveryType = getNodeContentAsString(node);
+            break;
+        case F4mNames::LABEL:
+            manifest->label = getNodeContentAsString(node);
+            break;
+        case F4mNames::ID:
+            manifest->id = getNodeContentAsString(node);
+            break;
+        case F4mNames::LANG:
+            manifest->lang = getNodeContentAsString(node);
+            break;
+        case F4mNames::DURATION:
+            manifest->duration = getNodeContentAsNumber(node);
+            break;
+        // parsed by their own section
+        case F4mNames::MEDIA:
+        case F4mNames::BOOTSTRAP_INFO:
+        case F4mNames::DVR_INFO:
+        case F4mNames::DRM_ADDITIONAL_HEADER:
+        case F4mNames::SMPTE_TIMECODES:
+        case F4mNames::CUE_INFO:
+        case F4mNames::BEST_EFFORT_FETCH_INFO:
+        case F4mNames::DRM_ADDITIONAL_HEADER_SET:
+        case F4mNames::ADAPTIVE_SET:
+            break;
+        // report element we don't parse
+        default:
+            F4M_DIAG(DIAG_DEBUG) << "node : [" << node.node().name() << "] ignored";
+            getNodeContentAsString(node);
+            break;
+        }
+    }
+
+    if (!manifest->deliveryType.empty() && manifest->deliveryType != "streaming"
+            && manifest->deliveryType != "progressive") {
+        F4M_DIAG(DIAG_WARNING) << "deliveryType invalid " << manifest->deliveryType;
+        manifest->deliveryType.clear();  // 'streaming' is the one used in practice
+    }
+
+    if (!manifest->streamType.empty() && manifest->streamType != "live"
+            && manifest->streamType != "recorded"
+            && manifest->streamType != "liveOrRecorded") {
+        F4M_DIAG(DIAG_WARNING) << "streamType invalid " << manifest->streamType;
+        manifest->streamType.clear();  // or fallback to default "liveOrRecorded"
+    }
+
+    if (manifest->baseURL.empty()) {
+        manifest->baseURL = sanitizeBaseUrl(m_f4mDoc->fileUrl());
+    }
+    m_baseUrl = UrlUtils::BaseUrl{directoryUrl(manifest->baseURL)};
+}
+
+// the stream-level manifests are submitted together to the downloader, which may fetch
+// them concurrently, then parsed one after the other.
+// the hrefs go through the downloader whatever their scheme
 void ManifestParser::parseMLStreamManifests(Manifest *manifest)
 {
-    auto doParse = [&](Media &media) {
-        parseMLStreamManifest(manifest, media);
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_ML_STREAM_MANIFESTS, &m_f4mDoc->fileUrl());
+
+    std::vector<Media *> medias;
+    std::vector<DownloadRequest> requests;
+    auto addRequest = [&](Media &media) {
+        if (media.href.empty()) {
+            F4M_DIAG(DIAG_WARNING) << "ML stream-level manifest url empty";
+            return;
+        }
+        if (m_budget.addSubRequest()) {
+            medias.push_back(&media);
+            requests.push_back(downloadRequest(media.href));
+        }
     };
-    forEachMedia(manifest, doParse);
+    forEachMedia(manifest, addRequest);
+
+    if (m_budget.exceeded() || requests.empty()) {
+        return;
+    }
+    if (m_instruments.stats) {
+        m_instruments.stats->subRequests += requests.size();
+    }
+
+    std::vector<DownloadResponse> responses;
+    if (!downloadF4mFiles(requests, &responses, TraceSpan::SPAN_STREAM_MANIFEST_DOWNLOAD)) {
+        return;
+    }
+
+    for (size_t i = 0; i < medias.size() && !m_budget.exceeded(); i++) {
+        if (!acceptDownload(&responses[i])) {
+            F4M_DIAG(DIAG_WARNING) << "failed to dowload ML stream-level manifest " << requests[i].url;
+            continue;
+        }
+        parseMLStreamManifest(manifest, *medias[i], std::move(responses[i].data));
+    }
 }
 
-void ManifestParser::parseMLStreamManifest(Manifest *manifest, Media &media)
+void ManifestParser::parseMLStreamManifest(Manifest *manifest, Media &media,
+                                           std::vector<uint8_t> document)
 {
-    m_f4mDoc.reset(new ManifestDoc{media.href});
-
-    if (!initManifestParser()) {
-        F4M_DLOG(std::cerr << "initParser for ML stream-level manifest failed" << std::endl;);
+    if (!loadBuffer(std::move(document), media.href)) {
+        F4M_DIAG(DIAG_WARNING) << "loading ML stream-level manifest failed";
         return;
     }
 
@@ -206,6 +516,12 @@ void ManifestParser::parseMLStreamManifest(Manifest *manifest, Media &media)
 
     Manifest subManifest = parseManifest();
 
+    // a limit may have stopped the parse before the media
+    if (m_budget.exceeded() || subManifest.medias.empty()) {
+        F4M_DIAG(DIAG_WARNING) << "no media in ML stream-level manifest " << media.href;
+        return;
+    }
+
     // these values should be read only from the set-level manifest
     subManifest.medias.at(0).width = media.width;
     subManifest.medias.at(0).height = media.height;
@@ -243,162 +559,166 @@ void ManifestParser::parseMLStreamManifest(Manifest *manifest, Media &media)
     }
 }
 
-void ManifestParser::parseMedias(Manifest* manifest)
+template <F4mNames::Contexts Context>
+bool ManifestParser::parseMediaAttrs(const pugi::xml_node &node, Media *media)
 {
-    std::string query{"/manifest" + m_f4mDoc->selectNs() + "/media" + m_f4mDoc->selectNs()};
-
-    pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
-
-    for (auto &node : nodes) {
-
-        Media media;
+    for (auto &attr : node.attributes()) {
+        switch (F4mNames::mediaAttr<Context>(attr.name())) {
+        case F4mNames::DVR_INFO_ID:
+            media->dvrInfoId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::HREF:
+            media->href = getAttrValueAsUrl(attr);
+            break;
+        case F4mNames::AUDIO_CODEC:
+            media->audioCodec = getAttrValueAsString(attr);
+            break;
+        case F4mNames::VIDEO_CODEC:
+            media->videoCodec = getAttrValueAsString(attr);
+            break;
+        case F4mNames::CUE_INFO_ID:
+            media->cueInfoId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::BEST_EFFORT_FETCH_INFO_ID:
+            media->bestEffortFetchInfoId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::DRM_ADDITIONAL_HEADER_SET_ID:
+            media->drmAdditionalHeaderSetId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::BITRATE:
+            media->bitrate = getAttrValueAsString(attr);
+            break;
+        case F4mNames::STREAM_ID:
+            media->streamId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::WIDTH:
+            media->width = getAttrValueAsInt(attr);
+            break;
+        case F4mNames::HEIGHT:
+            media->height = getAttrValueAsInt(attr);
+            break;
+        case F4mNames::TYPE:
+            media->type = getAttrValueAsString(attr);
+            break;
+        case F4mNames::ALTERNATE:
+            media->alternate = true;
+            break;
+        case F4mNames::LABEL:
+            media->label = getAttrValueAsString(attr);
+            break;
+        case F4mNames::LANG:
+            media->lang = getAttrValueAsString(attr);
+            break;
+        case F4mNames::URL:
+            media->url = getAttrValueAsUrl(attr);
+            break;
+        case F4mNames::BOOTSTRAP_INFO_ID:
+            media->bootstrapInfoId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::DRM_ADDITIONAL_HEADER_ID:
+            media->drmAdditionalHeaderId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::GROUPSPEC:
+            media->groupspec = getAttrValueAsString(attr);
+            break;
+        case F4mNames::MULTICAST_STREAM_NAME:
+            media->multicastStreamName = getAttrValueAsString(attr);
+            break;
+        default:
+            F4M_DIAG(DIAG_DEBUG) << "attr " << attr.name() << " ignored";
+            getAttrValueAsString(attr);
+            break;
+        }
+    }
 
-        for (auto &attr : node.node().attributes())
-        {
-            if (m_f4mDoc->versionMajor() == 1) {
-                if (attrNameIs(attr, "dvrInfoId")) {
-                    media.dvrInfoId = getAttrValueAsString(attr);
-                    continue;
-                }
+    // check rtmfp
+    if (!media->groupspec.empty() || !media->multicastStreamName.empty()) {
+        if ((media->groupspec.empty() != media->multicastStreamName.empty()) ||
+                UrlUtils::haveRtmfpScheme(media->url) == false) {
+            F4M_DIAG(DIAG_WARNING) << "multicast for rtmfp not valid";
+            return false;
+        }
+    }
 
-            } else if (m_f4mDoc->versionMajor() >= 2) {
-                if (attrNameIs(attr, "href")) {
-                    media.href = getAttrValueAsString(attr);
-                    if (UrlUtils::isAbsolute(media.href) == false) {
-                        media.href.insert(0, manifest->baseURL + "/");
-                    }
-                    continue;
-                }
+    // check media type
+    if (!media->type.empty()
+            && media->type != "audio"
+            && media->type != "audio+video"
+            && media->type != "data"
+            && media->type != "text"
+            && media->type != "video"
+            && !((Context & F4mNames::V3)
+                 && media->type == "video-keyframe-only")) {
+        F4M_DIAG(DIAG_WARNING) << "invalid media type " << media->type;
+        media->type.clear(); // default to "audio+video"
+    }
 
-                if (m_f4mDoc->versionMajor() >= 3) {
-                    if (attrNameIs(attr, "audioCodec")) {
-                        media.audioCodec = getAttrValueAsString(attr);
-                        continue;
-                    } else if (attrNameIs(attr, "videoCodec")) {
-                        media.videoCodec = getAttrValueAsString(attr);
-                        continue;
-                    }
-                    else if (attrNameIs(attr, "cueInfoId")) {
-                        media.cueInfoId = getAttrValueAsString(attr);
-                        continue;
-                    }
-                    else if (attrNameIs(attr, "bestEffortFetchInfoId")) {
-                        media.bestEffortFetchInfoId = getAttrValueAsString(attr);
-                        continue;
-                    }
-                    else if (attrNameIs(attr, "drmAdditionalHeaderSetId")) {
-                        media.drmAdditionalHeaderSetId = getAttrValueAsString(attr);
-                        continue;
-                    }
-                }
-            }
+    // malformed manifest
+    if (Context & F4mNames::V3) {
+        if (!media->videoCodec.empty() && (!media->type.empty()  && media->type != "video"
+                                           && media->type != "audio+video"
+                                           && media->type != "video-keyframe-only")) {
+            F4M_DIAG(DIAG_WARNING) << "videoCodec " << media->videoCodec
+                    << " present with media type " << media->type;
+            media->videoCodec.clear();
+        }
 
-            if (m_f4mDoc->isMultiLevelStreamLevel() == false) {
+        if (!media->drmAdditionalHeaderId.empty() && !media->drmAdditionalHeaderSetId.empty()) {
+            F4M_DIAG(DIAG_INFO)
+                    << "both drmAdditionalHeaderId and drmAdditionalHeaderSetId are present";
+        }
+    }
 
-                if (attrNameIs(attr, "bitrate")) {
-                    media.bitrate = getAttrValueAsString(attr);
-                    continue;
-                } else if (attrNameIs(attr, "streamId")) {
-                    media.streamId = getAttrValueAsString(attr);
-                    continue;
-                } else if (attrNameIs(attr, "width")) {
-                    media.width = getAttrValueAsInt(attr);
-                    continue;
-                } else if (attrNameIs(attr, "height")) {
-                    media.height = getAttrValueAsInt(attr);
-                    continue;
-                } else if (attrNameIs(attr, "type")) {
-                    media.type = getAttrValueAsString(attr);
-                    continue;
-                } else if (attrNameIs(attr, "alternate")) {
-                    media.alternate = true;
-                    continue;
-                } else if (attrNameIs(attr, "label")) {
-                    media.label = getAttrValueAsString(attr);
-                    continue;
-                } else if (attrNameIs(attr, "lang")) {
-                    media.lang = getAttrValueAsString(attr);
-                    continue;
-                }
-            }
+    return true;
+}
 
-            if (attrNameIs(attr, "url")) {
-                media.url = getAttrValueAsString(attr);
-                if (UrlUtils::isAbsolute(media.url) == false) {
-                    media.url.insert(0, manifest->baseURL + "/");
-                }
-            } else if (attrNameIs(attr, "bootstrapInfoId")) {
-                media.bootstrapInfoId = getAttrValueAsString(attr);
-            } else if (attrNameIs(attr, "drmAdditionalHeaderId")) {
-                media.drmAdditionalHeaderId = getAttrValueAsString(attr);
-            } else if (attrNameIs(attr, "groupspec")) {
-                media.groupspec = getAttrValueAsString(attr);
-            } else if (attrNameIs(attr, "multicastStreamName")) {
-                media.multicastStreamName = getAttrValueAsString(attr);
-            }   else {
-                F4M_DLOG(std::cerr << __func__ <<  " : attr "
-                         << attr.name() << " ignored" << std::endl;);
-                getAttrValueAsString(attr);
+// the blobs, which are only in the children
+template <F4mNames::Contexts Context>
+void ManifestParser::parseMediaData(const pugi::xml_node &node, Media *media)
+{
+    for (auto &child : node.children()) {
+        if (!countNodes(1)) {
+            break;
+        }
+        if (nodeIsInF4mNs(child)) {
+            switch (F4mNames::mediaChild<Context>(child.name())) {
+            case F4mNames::MOOV:
+                media->moov = getNodeBase64Data(child);
+                break;
+            case F4mNames::XMP_METADATA:
+                media->xmpMetadata = getNodeBase64Data(child);
+                break;
+            case F4mNames::METADATA:
+                media->metadata = getNodeBase64Data(child);
+                break;
+            default:
+                break;
             }
         }
+    }
+}
 
-        for (auto &child : node.node().children()) {
-            if (nodeIsInF4mNs(child)) {
-                if (m_f4mDoc->versionMajor() == 1) {
-                    if (nodeNameIs(child, "moov")) {
-                        media.moov = getNodeBase64Data(child);
-                        continue;
-                    } else if (nodeNameIs(child, "xmpMetadata")) {
-                        media.xmpMetadata = getNodeBase64Data(child);
-                        continue;
-                    }
-                }
+template <F4mNames::Contexts Context>
+void ManifestParser::parseMediasFor(Manifest* manifest)
+{
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_MEDIAS, &m_f4mDoc->fileUrl());
 
-                if (nodeNameIs(child, "metadata")) {
-                    media.metadata = getNodeBase64Data(child);
-                }
-            }
-        }
+    std::string query{"/manifest" + m_f4mDoc->selectNs() + "/media" + m_f4mDoc->selectNs()};
 
-        // check rtmfp
-        if (!media.groupspec.empty() || !media.multicastStreamName.empty()) {
-            if ((media.groupspec.empty() != media.multicastStreamName.empty()) ||
-                    UrlUtils::haveRtmfpScheme(media.url) == false) {
-                F4M_DLOG(std::cerr << __func__ << " multicast for rtmfp not valid " << std::endl;);
-                continue;
-            }
+    pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
+
+    for (auto &node : nodes) {
+        if (!countNodes(1)) {
+            break;
         }
 
-        // check media type
-        if (!media.type.empty()
-                && media.type != "audio"
-                && media.type != "audio+video"
-                && media.type != "data"
-                && media.type != "text"
-                && media.type != "video"
-                && !(m_f4mDoc->versionMajor() >= 3
-                     && media.type == "video-keyframe-only")) {
-            F4M_DLOG(std::cerr << __func__ << " invalid media type "
-                     << media.type << std::endl;);
-            media.type.clear(); // default to "audio+video"
-        }
-
-        // malformed manifest
-        if (m_f4mDoc->versionMajor() >= 3) {
-            if (!media.videoCodec.empty() && (!media.type.empty()  && media.type != "video"
-                                              && media.type != "audio+video"
-                                              && media.type != "video-keyframe-only")) {
-                F4M_DLOG(std::cerr << __func__ << " videoCodec " << media.videoCodec
-                         << " present with media type " << media.type
-                         << std::endl;);
-                media.videoCodec.clear();
-            }
+        Media media;
 
-            if (!media.drmAdditionalHeaderId.empty() && !media.drmAdditionalHeaderSetId.empty()) {
-                F4M_DLOG(std::cerr << __func__
-                         << " both drmAdditionalHeaderId and drmAdditionalHeaderSetId are present"
-                         <<std::endl;);
-            }
+        if (!parseMediaAttrs<Context>(node.node(), &media)) {
+            continue;
+        }
+        if (!skips(ParseOptions::SKIP_MEDIA_METADATA)) {
+            parseMediaData<Context>(node.node(), &media);
         }
 
         printDebugMediaCheck(media);  // INFO
@@ -407,124 +727,131 @@ void ManifestParser::parseMedias(Manifest* manifest)
         manifest->medias.push_back(media);
 
         // Only one if we're in a multi-level stream-level
-        if (m_f4mDoc->isMultiLevelStreamLevel()) {
+        if (Context & F4mNames::MLM_STREAM) {
             break;
         }
     }
 }
 
-// for now just duplicate parseMedias code
-void ManifestParser::parseAdaptiveSets(Manifest *manifest)
+// the attributes of an adaptive set are shared by its medias
+template <F4mNames::Contexts Context>
+void ManifestParser::parseAdaptiveSetAttrs(const pugi::xml_node &node, Media *shared)
+{
+    for (auto &attr : node.attributes()) {
+        switch (F4mNames::adaptiveSetAttr<Context>(attr.name())) {
+        case F4mNames::ALTERNATE:
+            shared->alternate = true;
+            break;
+        case F4mNames::LABEL:
+            shared->label = getAttrValueAsString(attr);
+            break;
+        case F4mNames::AUDIO_CODEC:
+            shared->audioCodec = getAttrValueAsString(attr);
+            break;
+        case F4mNames::LANG:
+            shared->lang = getAttrValueAsString(attr);
+            break;
+        case F4mNames::TYPE:
+            shared->type = getAttrValueAsString(attr);
+            break;
+        default:
+            F4M_DIAG(DIAG_DEBUG) << "ignoring adaptiveSet attr " << attr.name();
+            break;
+        }
+    }
+}
+
+template <F4mNames::Contexts Context>
+void ManifestParser::parseAdaptiveSetMediaAttrs(const pugi::xml_node &node, Media *media)
 {
+    for (auto &attr : node.attributes()) {
+        switch (F4mNames::adaptiveSetMediaAttr<Context>(attr.name())) {
+        case F4mNames::HREF:
+            media->href = getAttrValueAsUrl(attr);
+            break;
+        case F4mNames::VIDEO_CODEC:
+            media->videoCodec = getAttrValueAsString(attr);
+            break;
+        case F4mNames::CUE_INFO_ID:
+            media->cueInfoId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::BEST_EFFORT_FETCH_INFO_ID:
+            media->bestEffortFetchInfoId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::DRM_ADDITIONAL_HEADER_SET_ID:
+            media->drmAdditionalHeaderSetId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::BITRATE:
+            media->bitrate = getAttrValueAsString(attr);
+            break;
+        case F4mNames::STREAM_ID:
+            media->streamId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::WIDTH:
+            media->width = getAttrValueAsInt(attr);
+            break;
+        case F4mNames::HEIGHT:
+            media->height = getAttrValueAsInt(attr);
+            break;
+        case F4mNames::URL:
+            media->url = getAttrValueAsUrl(attr);
+            break;
+        case F4mNames::BOOTSTRAP_INFO_ID:
+            media->bootstrapInfoId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::DRM_ADDITIONAL_HEADER_ID:
+            media->drmAdditionalHeaderId = getAttrValueAsString(attr);
+            break;
+        case F4mNames::GROUPSPEC:
+            media->groupspec = getAttrValueAsString(attr);
+            break;
+        case F4mNames::MULTICAST_STREAM_NAME:
+            media->multicastStreamName = getAttrValueAsString(attr);
+            break;
+        default:
+            F4M_DIAG(DIAG_DEBUG) << "attr " << attr.name() << " ignored";
+            getAttrValueAsString(attr);
+            break;
+        }
+    }
+}
+
+template <F4mNames::Contexts Context>
+void ManifestParser::parseAdaptiveSetsFor(Manifest *manifest)
+{
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_ADAPTIVE_SETS, &m_f4mDoc->fileUrl());
+
     std::string query{"/manifest" + m_f4mDoc->selectNs() + "/adaptiveSet" + m_f4mDoc->selectNs()};
 
     pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
 
     for (auto &node : nodes) {
+        if (!countNodes(1)) {
+            break;
+        }
 
-        bool alternate = false;
-        std::string audioCodec;
-        std::string label;
-        std::string lang;
-        std::string type;
+        Media shared;
+        parseAdaptiveSetAttrs<Context>(node.node(), &shared);
 
         std::vector<Media> medias;
 
-        for (auto &attr : node.node().attributes()) {
-
-            if (attrNameIs(attr, "alternate")) {
-                alternate = true;
-                continue;
-            } else if (attrNameIs(attr, "label")) {
-                label = getAttrValueAsString(attr);
-                continue;
-            } else if (attrNameIs(attr, "audioCodec")) {
-                lang = getAttrValueAsString(attr);
-                continue;
-            } else if (attrNameIs(attr, "lang")) {
-                lang = getAttrValueAsString(attr);
-                continue;
-            } else if (attrNameIs(attr, "type")) {
-                type = getAttrValueAsString(attr);
-                continue;
-            } {
-                F4M_DLOG(std::cerr << __func__ << " ignoring adaptiveSet attr "
-                         << attr.name() << std::endl;);
-            }
-        }
-
         // then get the media nodes
         for (auto &child : node.node().children()) {
+            if (!countNodes(1)) {
+                break;
+            }
             // check we don't escape ns
             if (nodeIsInF4mNs(child)) {
 
-                if (nodeNameIs(child, "media") == false) {
-                    F4M_DLOG(std::cerr << __func__ << " ignoring adaptiveSet child element "
-                             << child.name() << std::endl;);
+                if (F4mNames::lookup(child.name()) != F4mNames::MEDIA) {
+                    F4M_DIAG(DIAG_DEBUG) << "ignoring adaptiveSet child element " << child.name();
                     continue;
                 }
 
-                Media media;
-
-                // set attrs
-                media.alternate = alternate;
-                media.label = label;
-                media.lang = lang;
-                media.audioCodec = audioCodec;
-                media.type = type;
-
-                // get attrs
-                for (auto &attr : child.attributes()) {
-
-                    if (attrNameIs(attr, "href")) {
-                        media.href = getAttrValueAsString(attr);
-                        if (UrlUtils::isAbsolute(media.href) == false) {
-                            media.href.insert(0, manifest->baseURL + "/");
-                        }
-                    } else if (attrNameIs(attr, "videoCodec")) {
-                        media.videoCodec = getAttrValueAsString(attr);
-                    } else if (attrNameIs(attr, "cueInfoId")) {
-                        media.cueInfoId = getAttrValueAsString(attr);
-                    } else if (attrNameIs(attr, "bestEffortFetchInfoId")) {
-                        media.bestEffortFetchInfoId = getAttrValueAsString(attr);
-                    } else if (attrNameIs(attr, "drmAdditionalHeaderSetId")) {
-                        media.drmAdditionalHeaderSetId = getAttrValueAsString(attr);
-                    } else if (attrNameIs(attr, "bitrate")) {
-                        media.bitrate = getAttrValueAsString(attr);
-                    } else if (attrNameIs(attr, "streamId")) {
-                        media.streamId = getAttrValueAsString(attr);
-                    } else if (attrNameIs(attr, "width")) {
-                        media.width = getAttrValueAsInt(attr);
-                    } else if (attrNameIs(attr, "height")) {
-                        media.height = getAttrValueAsInt(attr);
-                    } else if (attrNameIs(attr, "url")) {
-                        media.url = getAttrValueAsString(attr);
-                        if (UrlUtils::isAbsolute(media.url) == false) {
-                            media.url.insert(0, manifest->baseURL + "/");
-                        }
-                    } else if (attrNameIs(attr, "bootstrapInfoId")) {
-                        media.bootstrapInfoId = getAttrValueAsString(attr);
-                    } else if (attrNameIs(attr, "drmAdditionalHeaderId")) {
-                        media.drmAdditionalHeaderId = getAttrValueAsString(attr);
-                    } else if (attrNameIs(attr, "groupspec")) {
-                        media.groupspec = getAttrValueAsString(attr);
-                    } else if (attrNameIs(attr, "multicastStreamName")) {
-                        media.multicastStreamName = getAttrValueAsString(attr);
-                    } else {
-                        F4M_DLOG(std::cerr << __func__ <<  " : attr "
-                                 << attr.name() << " ignored" << std::endl;);
-                        getAttrValueAsString(attr);
-                    }
-                }
-
-                // get metadata
-                for (auto &lchild : child.children()) {
-                    // check we don't escape ns
-                    if (nodeIsInF4mNs(lchild)) {
-                        if (nodeNameIs(lchild, "metadata")) {
-                            media.metadata = getNodeBase64Data(lchild);
-                        }
-                    }
+                Media media = shared;
+                parseAdaptiveSetMediaAttrs<Context>(child, &media);
+                if (!skips(ParseOptions::SKIP_MEDIA_METADATA)) {
+                    parseMediaData<Context>(child, &media);
                 }
                 medias.push_back(media);
             }
@@ -538,53 +865,57 @@ void ManifestParser::parseAdaptiveSets(Manifest *manifest)
 
 }
 
-void ManifestParser::parseDvrInfos(Manifest *manifest)
+template <F4mNames::Contexts Context>
+void ManifestParser::parseDvrInfoNode(const pugi::xml_node &node, DvrInfo *dvrInfo)
 {
-    std::string query{"/manifest" + m_f4mDoc->selectNs() + "/dvrInfo" + m_f4mDoc->selectNs()};
-
-    pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
-
-    for (auto &node : nodes) {
-
-        DvrInfo dvrInfo;
+    for (auto &attr : node.attributes()) {
+        switch (F4mNames::dvrInfoAttr<Context>(attr.name())) {
+        case F4mNames::ID:
+            dvrInfo->id = getAttrValueAsString(attr);
+            break;
+        case F4mNames::BEGIN_OFFSET:
+            dvrInfo->beginOffset = getAttrValueAsInt(attr);
+            break;
+        case F4mNames::END_OFFSET:
+            dvrInfo->endOffset = getAttrValueAsInt(attr);
+            break;
+        case F4mNames::WINDOW_DURATION:
+            dvrInfo->windowDuration = getAttrValueAsInt(attr);
+            break;
+        case F4mNames::URL:
+            dvrInfo->url = getAttrValueAsUrl(attr);
+            break;
+        case F4mNames::OFFLINE:
+            dvrInfo->offline = true;
+            break;
+        default:
+            F4M_DIAG(DIAG_DEBUG) << "attr " << attr.name() << " ignored";
+            getAttrValueAsString(attr);  // D
+            break;
+        }
+    }
+}
 
-        for (auto &attr : node.node().attributes()) {
+template <F4mNames::Contexts Context>
+void ManifestParser::parseDvrInfosFor(Manifest *manifest)
+{
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_DVR_INFOS, &m_f4mDoc->fileUrl());
 
-            if (m_f4mDoc->versionMajor() == 1) {
-                if (attrNameIs(attr, "id")) {
-                    dvrInfo.id = getAttrValueAsString(attr);
-                    continue;
-                } else if (attrNameIs(attr, "beginOffset")) {
-                    dvrInfo.beginOffset = getAttrValueAsInt(attr);
-                    continue;
-                } else if (attrNameIs(attr, "endOffset")) {
-                    dvrInfo.endOffset = getAttrValueAsInt(attr);
-                    continue;
-                }
+    std::string query{"/manifest" + m_f4mDoc->selectNs() + "/dvrInfo" + m_f4mDoc->selectNs()};
 
-            } else if (m_f4mDoc->versionMajor() >= 2) {
-                if (attrNameIs(attr, "windowDuration")) {
-                    dvrInfo.windowDuration = getAttrValueAsInt(attr);
-                    continue;
-                }
-            }
+    pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
 
-            if (attrNameIs(attr, "url")) {
-                dvrInfo.url = getAttrValueAsString(attr);
-                if (UrlUtils::isAbsolute(dvrInfo.url) == false) {
-                    dvrInfo.url.insert(0, manifest->baseURL + "/");
-                }
-            } else if (attrNameIs(attr, "offline")) {
-                dvrInfo.offline = true;
-            } else {
-                F4M_DLOG(std::cerr << __func__ <<  " : attr " << attr.name()
-                         << " ignored" << std::endl;);
-                getAttrValueAsString(attr);  // D
-            }
+    for (auto &node : nodes) {
+        if (!countNodes(1)) {
+            break;
         }
 
-        auto assign = [&](Media media) {
-            if (m_f4mDoc->versionMajor() >= 2 ||
+        DvrInfo dvrInfo;
+
+        parseDvrInfoNode<Context>(node.node(), &dvrInfo);
+
+        auto assign = [&](Media &media) {
+            if ((Context & (F4mNames::V2 | F4mNames::V3)) ||
                     (media.dvrInfoId.empty() || media.dvrInfoId == dvrInfo.id)) {
                 media.dvrInfo = dvrInfo;
             }
@@ -594,44 +925,68 @@ void ManifestParser::parseDvrInfos(Manifest *manifest)
     }
 }
 
+// prefetchDeadline and startTimestamp are only read in a drmAdditionalHeaderSet
+void ManifestParser::parseDrmAdditionalHeaderAttrs(const pugi::xml_node &node,
+                                                   DrmAdditionalHeader *drmAdditionalHeader,
+                                                   bool inSet)
+{
+    for (auto &attr : node.attributes()) {
+
+        if (attrNameIs(attr, "id")) {
+            drmAdditionalHeader->id = getAttrValueAsString(attr);
+        }
+        // only in Set
+        else if (inSet && attrNameIs(attr, "prefetchDeadline")) {
+            drmAdditionalHeader->prefetchDeadline = getAttrValueAsNumber(attr);
+        }  else if (inSet && attrNameIs(attr, "startTimestamp")) {
+            drmAdditionalHeader->startTimestamp = getAttrValueAsNumber(attr);
+        }
+        else if (attrNameIs(attr, "url")) {
+            drmAdditionalHeader->url = getAttrValueAsUrl(attr);
+        } else {
+            F4M_DIAG(DIAG_DEBUG) << "attr " << attr.name() << " ignored";
+            getAttrValueAsString(attr);  // D
+        }
+    }
+}
+
+// get the data if it's here, false if the header is malformed
+bool ManifestParser::parseDrmAdditionalHeaderData(const pugi::xml_node &node,
+                                                  DrmAdditionalHeader *drmAdditionalHeader)
+{
+    if (drmAdditionalHeader->url.empty()) {
+        drmAdditionalHeader->data = getNodeBase64Data(node);
+        // check
+        if (drmAdditionalHeader->data.empty()) {
+            F4M_DIAG(DIAG_WARNING) << "ignoring malformed drmAdditionalHeader : no data";
+            return false;
+        }
+    }
+    return true;
+}
+
 void ManifestParser::parseDrmAdditionalHeaders(Manifest *manifest)
 {
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_DRM_ADDITIONAL_HEADERS, &m_f4mDoc->fileUrl());
+
     std::string query{"/manifest" + m_f4mDoc->selectNs()
                 + "/drmAdditionalHeader" + m_f4mDoc->selectNs()};
 
     pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
 
     for (auto &node : nodes) {
+        if (!countNodes(1)) {
+            break;
+        }
 
         DrmAdditionalHeader drmAdditionalHeader;
 
-        for (auto &attr : node.node().attributes()) {
-
-            if (attrNameIs(attr, "id")) {
-                drmAdditionalHeader.id = getAttrValueAsString(attr);
-            }  else if (attrNameIs(attr, "url")) {
-                drmAdditionalHeader.url = getAttrValueAsString(attr);
-                if (UrlUtils::isAbsolute(drmAdditionalHeader.url) == false) {
-                    drmAdditionalHeader.url.insert(0, manifest->baseURL + "/");
-                }
-            } else {
-                F4M_DLOG(std::cerr << __func__ <<  " : attr " << attr.name()
-                         << " ignored" << std::endl;);
-                getAttrValueAsString(attr);  // D
-            }
-        }
-
-        if (drmAdditionalHeader.url.empty()) {
-            drmAdditionalHeader.data = getNodeBase64Data(node);
-            // check
-            if (drmAdditionalHeader.data.empty()) {
-                F4M_DLOG(std::cerr << __func__ << "ignoring malformed drmAdditionalHeader : no data"
-                         << std::endl;);
-                continue;
-            }
+        parseDrmAdditionalHeaderAttrs(node.node(), &drmAdditionalHeader, false);
+        if (!parseDrmAdditionalHeaderData(node.node(), &drmAdditionalHeader)) {
+            continue;
         }
 
-        auto assign = [&](Media media) {
+        auto assign = [&](Media &media) {
             if (media.drmAdditionalHeaderId.empty() ||
                     media.drmAdditionalHeaderId == drmAdditionalHeader.id) {
                 media.drmAdditionalHeader = drmAdditionalHeader;
@@ -642,58 +997,62 @@ void ManifestParser::parseDrmAdditionalHeaders(Manifest *manifest)
 
 }
 
-void ManifestParser::parseBootstrapInfos(Manifest *manifest)
+// false if the bootstrapInfo is malformed
+template <F4mNames::Contexts Context>
+bool ManifestParser::parseBootstrapInfoAttrs(const pugi::xml_node &node, BootstrapInfo *bootstrapInfo)
+{
+    for (auto &attr : node.attributes()) {
+        switch (F4mNames::bootstrapInfoAttr<Context>(attr.name())) {
+        case F4mNames::PROFILE:
+            bootstrapInfo->profile = getAttrValueAsString(attr);  //mandatory
+            break;
+        case F4mNames::ID:
+            bootstrapInfo->id = getAttrValueAsString(attr);
+            break;
+        case F4mNames::URL:
+            bootstrapInfo->url = getAttrValueAsUrl(attr);
+            break;
+        case F4mNames::FRAGMENT_DURATION:
+            bootstrapInfo->fragmentDuration = getAttrValueAsNumber(attr);
+            break;
+        case F4mNames::SEGMENT_DURATION:
+            bootstrapInfo->segmentDuration = getAttrValueAsNumber(attr);
+            break;
+        default:
+            F4M_DIAG(DIAG_DEBUG) << "attr " << attr.name() << " ignored";
+            getAttrValueAsString(attr);  // D
+            break;
+        }
+    }
+
+    // check
+    if (bootstrapInfo->profile.empty()) {
+        F4M_DIAG(DIAG_WARNING) << "ignoring malformed bootstrap : no profile attr";
+        return false;
+    }
+    return true;
+}
+
+template <F4mNames::Contexts Context>
+void ManifestParser::parseBootstrapInfosFor(Manifest *manifest)
 {
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_BOOTSTRAP_INFOS, &m_f4mDoc->fileUrl());
+
     std::string query{"/manifest" + m_f4mDoc->selectNs() + "/bootstrapInfo" + m_f4mDoc->selectNs()};
 
     pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
 
     for (auto &node : nodes) {
+        if (!countNodes(1)) {
+            break;
+        }
 
         BootstrapInfo bootstrapInfo;
 
-        for (auto &attr : node.node().attributes()) {
-
-            if (attrNameIs(attr, "profile")) {
-                bootstrapInfo.profile = getAttrValueAsString(attr);  //mandatory
-            } else if (attrNameIs(attr, "id")) {
-                bootstrapInfo.id = getAttrValueAsString(attr);
-            } else if (attrNameIs(attr, "url")) {
-                bootstrapInfo.url = getAttrValueAsString(attr);
-                if (UrlUtils::isAbsolute(bootstrapInfo.url) == false) {
-                    bootstrapInfo.url.insert(0, manifest->baseURL + "/");
-                }
-            }
-
-            else if (m_f4mDoc->versionMajor() >= 3
-                     && attrNameIs(attr, "fragmentDuration")) {
-                bootstrapInfo.fragmentDuration = getAttrValueAsNumber(attr);
-            } else if (m_f4mDoc->versionMajor() >= 3
-                       && attrNameIs(attr, "segmentDuration")) {
-                bootstrapInfo.segmentDuration = getAttrValueAsNumber(attr);
-            }
-
-            else {
-                F4M_DLOG(std::cerr << __func__ <<  " : attr " << attr.name()
-                         << " ignored" << std::endl;);
-                getAttrValueAsString(attr);  // D
-            }
-        }
-
-        // check
-        if (bootstrapInfo.profile.empty()) {
-            F4M_DLOG(std::cerr << __func__ << " ignoring malformed bootstrap : no profile attr"
-                     << std::endl;);
+        if (!parseBootstrapInfoAttrs<Context>(node.node(), &bootstrapInfo)
+                || !parseBootstrapInfoData(node.node(), &bootstrapInfo)) {
             continue;
         }
-        if (bootstrapInfo.url.empty()) {
-            bootstrapInfo.data = getNodeBase64Data(node);
-            if (bootstrapInfo.data.empty()) {
-                F4M_DLOG(std::cerr << __func__ << " ignoring malformed bootstrap : no data"
-                         << std::endl;);
-                continue;
-            }
-        }
 
         auto assign = [&](Media &media) {
             if (media.bootstrapInfoId.empty() ||
@@ -706,83 +1065,151 @@ void ManifestParser::parseBootstrapInfos(Manifest *manifest)
 
 }
 
+// get the data if it's here, false if the bootstrapInfo is malformed
+bool ManifestParser::parseBootstrapInfoData(const pugi::xml_node &node, BootstrapInfo *bootstrapInfo)
+{
+    if (bootstrapInfo->url.empty()) {
+        bootstrapInfo->data = getNodeBase64Data(node);
+        if (bootstrapInfo->data.empty()) {
+            F4M_DIAG(DIAG_WARNING) << "ignoring malformed bootstrap : no data";
+            return false;
+        }
+    }
+    return true;
+}
+
+// false if the sample is malformed
+bool ManifestParser::parseSmpteTimecodeNode(const pugi::xml_node &node, SmpteTimecode *smpteTimeCode)
+{
+    for (auto &attr : node.attributes()) {
+
+        if (attrNameIs(attr, "timestamp")) {
+            // 0.0 is valid, could be a problem here
+            smpteTimeCode->timestamp = getAttrValueAsNumber(attr);
+            continue;
+        } else if (attrNameIs(attr, "smpte")) {
+            smpteTimeCode->smpte = getAttrValueAsString(attr);
+            continue;
+        } if (attrNameIs(attr, "date")) {
+            smpteTimeCode->date = getAttrValueAsString(attr);
+            continue;
+        } if (attrNameIs(attr, "timezone")) {
+            smpteTimeCode->timezone = getAttrValueAsString(attr);
+            continue;
+        } else {
+            F4M_DIAG(DIAG_DEBUG) << "ignoring attr " << attr.name();
+        }
+    }
+
+    // ignore malformed
+    if (smpteTimeCode->timestamp < 0.0 || smpteTimeCode->smpte.empty()) {
+        F4M_DIAG(DIAG_WARNING) << "ignoring malformed smpteTimeCode";
+        return false;
+    }
+
+    if (SmpteTimecodeIndex::parseSmpte(smpteTimeCode->smpte, smpteTimeCode) == false) {
+        F4M_DIAG(DIAG_WARNING) << "malformed smpte " << smpteTimeCode->smpte;
+    }
+
+    return true;
+}
+
 void ManifestParser::parseSmpteTimeCodes(Manifest *manifest)
 {
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_SMPTE_TIMECODES, &m_f4mDoc->fileUrl());
+
     std::string query{"/manifest" + m_f4mDoc->selectNs()
                 + "/smpteTimecodes" + m_f4mDoc->selectNs()
                 + "/smpteTimecode" + m_f4mDoc->selectNs()};
 
     pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
 
-    for (auto &node : nodes) {
-
-        SmpteTimecode smpteTimeCode;
+    std::vector<SmpteTimecode> smpteTimeCodes;
+    smpteTimeCodes.reserve(nodes.size());
 
-        for (auto &attr : node.node().attributes()) {
-
-            if (attrNameIs(attr, "timestamp")) {
-                // 0.0 is valid, could be a problem here
-                smpteTimeCode.timestamp = getAttrValueAsNumber(attr);
-                continue;
-            } else if (attrNameIs(attr, "smpte")) {
-                smpteTimeCode.smpte = getAttrValueAsString(attr);
-                continue;
-            } if (attrNameIs(attr, "date")) {
-                smpteTimeCode.date = getAttrValueAsString(attr);
-                continue;
-            } if (attrNameIs(attr, "timezone")) {
-                smpteTimeCode.timezone = getAttrValueAsString(attr);
-                continue;
-            } else {
-                F4M_DLOG(std::cerr << __func__ << " ignoring attr"
-                         << attr.name()
-                         << std::endl;);
-            }
+    for (auto &node : nodes) {
+        if (!countNodes(1)) {
+            break;
         }
 
-        // ignore malformed
-        if (smpteTimeCode.timestamp < 0.0 || smpteTimeCode.smpte.empty()) {
-            F4M_DLOG(std::cerr << __func__ << " ignoring malformed smpteTimeCode"
-                     << std::endl;);
+        SmpteTimecode smpteTimeCode;
+        if (!parseSmpteTimecodeNode(node.node(), &smpteTimeCode)) {
             continue;
         }
 
-        // TODO: check formats, check that timestamp is increasing
+        smpteTimeCodes.push_back(smpteTimeCode);
+    }
 
-        auto assign = [&](Media media) {
-            media.smpteTimeCodes.push_back(smpteTimeCode);
+    if (!smpteTimeCodes.empty()) {
+        // sorted by timestamp, the frame numbers are computed once for every media
+        SmpteTimecodeIndex index;
+        index.build(smpteTimeCodes);
+        auto assign = [&](Media &media) {
+            media.smpteTimeCodes = smpteTimeCodes;
+            media.smpteTimecodeIndex = index;
         };
         forEachMedia(manifest, assign);
+    }
+}
+
+// false if the cue is malformed
+bool ManifestParser::parseCueNode(const pugi::xml_node &node, Cue *cue)
+{
+    for (auto &attr : node.attributes()) {
 
+        if (attrNameIs(attr, "availNum")) {
+            cue->availNum = getAttrValueAsInt(attr);
+            continue;
+        } else if (attrNameIs(attr, "availsExpected")) {
+            cue->availsExpected = getAttrValueAsInt(attr);
+            continue;
+        } else if (attrNameIs(attr, "duration")) {
+            cue->duration = getAttrValueAsNumber(attr);
+            continue;
+        } else if (attrNameIs(attr, "id")) {
+            cue->id = getAttrValueAsString(attr);
+            continue;
+        } else if (attrNameIs(attr, "time")) {
+            cue->time = getAttrValueAsNumber(attr);
+            continue;
+        } else if (attrNameIs(attr, "type")) {
+            cue->type = getAttrValueAsString(attr);
+            continue;
+        } else if (attrNameIs(attr, "programId")) {
+            cue->programId = getAttrValueAsString(attr);
+            continue;
+        }  else {
+            F4M_DIAG(DIAG_DEBUG) << "ignoring cue attr " << attr.name();
+        }
     }
 
+    // cues should be in ascending time order, CueIndex sorts them anyway
+    if (cue->duration < 0.0 || cue->id.empty() || cue->time < 0.0
+            || cue->type.empty() || cue->type != "spliceOut") {
+        F4M_DIAG(DIAG_WARNING) << "ignoring malformed cue";
+        return false;
+    }
+    return true;
 }
 
 void ManifestParser::parseCueInfos(Manifest *manifest)
 {
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_CUE_INFOS, &m_f4mDoc->fileUrl());
+
     std::string query{"/manifest" + m_f4mDoc->selectNs() + "/cueInfo" + m_f4mDoc->selectNs()};
 
     pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
 
     for (auto &node : nodes) {
-
-        std::string id;
-
-        // get the id
-        for (auto &attr : node.node().attributes()) {
-            if (attrNameIs(attr, "id")) {
-                id = getAttrValueAsString(attr);
-                continue;
-            } else {
-                F4M_DLOG(std::cerr << __func__ << " ignoring cueInfo attr "
-                         << attr.name()
-                         << std::endl;);
-            }
+        if (!countNodes(1)) {
+            break;
         }
 
+        std::string id = getIdAttr(node.node());
+
         // ignore malformed
         if (id.empty()) {
-            F4M_DLOG(std::cerr << __func__ << " ignoring cueInfo withour id " << std::endl;);
+            F4M_DIAG(DIAG_WARNING) << "ignoring cueInfo withour id";
             continue;
         }
 
@@ -790,6 +1217,9 @@ void ManifestParser::parseCueInfos(Manifest *manifest)
 
         // get the children Cue
         for (auto &child : node.node().children()) {
+            if (!countNodes(1)) {
+                break;
+            }
 
             // check we don't escape ns
             if (nodeIsInF4mNs(child)) {
@@ -797,40 +1227,7 @@ void ManifestParser::parseCueInfos(Manifest *manifest)
                 if (nodeNameIs(child, "cue")) {
 
                     Cue cue;
-                    for (auto &attr : child.attributes()) {
-
-                        if (attrNameIs(attr, "availNum")) {
-                            cue.availNum = getAttrValueAsInt(attr);
-                            continue;
-                        } else if (attrNameIs(attr, "availsExpected")) {
-                            cue.availsExpected = getAttrValueAsInt(attr);
-                            continue;
-                        } else if (attrNameIs(attr, "duration")) {
-                            cue.duration = getAttrValueAsNumber(attr);
-                            continue;
-                        } else if (attrNameIs(attr, "id")) {
-                            cue.id = getAttrValueAsString(attr);
-                            continue;
-                        } else if (attrNameIs(attr, "time")) {
-                            cue.time = getAttrValueAsNumber(attr);
-                            continue;
-                        } else if (attrNameIs(attr, "type")) {
-                            cue.type = getAttrValueAsString(attr);
-                            continue;
-                        } else if (attrNameIs(attr, "programId")) {
-                            cue.programId = getAttrValueAsString(attr);
-                            continue;
-                        }  else {
-                            F4M_DLOG(std::cerr << __func__ << " ignoring cue attr "
-                                     << attr.name() << std::endl;);
-                        }
-                    }
-
-                    // TODO: check. Cue must be stored in ascending time order
-                    if (cue.duration < 0.0 || cue.id.empty() || cue.time < 0.0
-                            || cue.type.empty() || cue.type != "spliceOut") {
-                        F4M_DLOG(std::cerr << __func__ << " ignoring malformed cue"
-                                 << std::endl;);
+                    if (!parseCueNode(child, &cue)) {
                         continue;
                     }
                     cues.push_back(cue);
@@ -839,57 +1236,67 @@ void ManifestParser::parseCueInfos(Manifest *manifest)
         }
 
         if (!cues.empty()) {
-            auto assign = [&](Media media) {
+            CueIndex cueIndex;
+            cueIndex.build(cues);
+            auto assign = [&](Media &media) {
                 if (!media.cueInfoId.empty() && media.cueInfoId == id) {
                     media.cueInfo = cues;
+                    media.cueIndex = cueIndex;
                 }
             };
             forEachMedia(manifest, assign);
         } else {
-            F4M_DLOG(std::cerr << __func__ << " ignoring empty cueInfo" << std::endl;);
+            F4M_DIAG(DIAG_INFO) << "ignoring empty cueInfo";
         }
 
     }
 
 }
 
+void ManifestParser::parseBestEffortFetchInfoNode(const pugi::xml_node &node,
+                                                  BestEffortFetchInfo *bestEffortFetchInfo)
+{
+    for (auto &attr : node.attributes()) {
+
+        if (attrNameIs(attr, "id")) {
+            bestEffortFetchInfo->id = getAttrValueAsString(attr);//mandatory
+        }
+        else if (attrNameIs(attr, "fragmentDuration")) {
+            bestEffortFetchInfo->fragmentDuration = getAttrValueAsNumber(attr);
+        }
+        else if (attrNameIs(attr, "segmentDuration")) {
+            bestEffortFetchInfo->segmentDuration = getAttrValueAsNumber(attr);
+        }
+        else {
+            F4M_DIAG(DIAG_DEBUG) << "attr " << attr.name() << " ignored";
+            getAttrValueAsString(attr);  // D
+        }
+    }
+}
+
 void ManifestParser::parseBestEffortFetchInfos(Manifest *manifest)
 {
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_BEST_EFFORT_FETCH_INFOS, &m_f4mDoc->fileUrl());
+
     std::string query{"/manifest" + m_f4mDoc->selectNs()
                 + "/bestEffortFetchInfo" + m_f4mDoc->selectNs()};
 
     pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
 
-
     for (auto &node : nodes) {
+        if (!countNodes(1)) {
+            break;
+        }
 
         BestEffortFetchInfo bestEffortFetchInfo;
-
-        for (auto &attr : node.node().attributes()) {
-
-            if (attrNameIs(attr, "id")) {
-                bestEffortFetchInfo.id = getAttrValueAsString(attr);//mandatory
-            }
-            else if (attrNameIs(attr, "fragmentDuration")) {
-                bestEffortFetchInfo.fragmentDuration = getAttrValueAsNumber(attr);
-            }
-            else if (attrNameIs(attr, "segmentDuration")) {
-                bestEffortFetchInfo.segmentDuration = getAttrValueAsNumber(attr);
-            }
-            else {
-                F4M_DLOG(std::cerr << __func__ <<  " : attr " << attr.name()
-                         << " ignored" << std::endl;);
-                getAttrValueAsString(attr);  // D
-            }
-        }
+        parseBestEffortFetchInfoNode(node.node(), &bestEffortFetchInfo);
 
         // info
         if (nodes.size() > 1 && bestEffortFetchInfo.id.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     <<  " several bestEffortFetchInfo but no id" << std::endl;);
+            F4M_DIAG(DIAG_INFO) << "several bestEffortFetchInfo but no id";
         }
 
-        auto assign = [&](Media media) {
+        auto assign = [&](Media &media) {
             if (media.bestEffortFetchInfoId.empty() ||
                     media.bestEffortFetchInfoId == bestEffortFetchInfo.id ||
                     bestEffortFetchInfo.id.empty()) {
@@ -908,28 +1315,26 @@ void ManifestParser::parseBestEffortFetchInfos(Manifest *manifest)
 
 void ManifestParser::parseDrmAdditionalHeaderSets(Manifest *manifest)
 {
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_PARSE_DRM_ADDITIONAL_HEADER_SETS, &m_f4mDoc->fileUrl());
+
     std::string query{"/manifest" + m_f4mDoc->selectNs()
                 + "/drmAdditionalHeaderSet" + m_f4mDoc->selectNs()};
 
     pugi::xpath_node_set nodes = m_f4mDoc->doc().select_nodes(query.data());
 
     for (auto &node : nodes) {
-
-        std::string id;
-
-        // get the id
-        for (auto &attr : node.node().attributes()) {
-            if (attrNameIs(attr, "id")) {
-                id = getAttrValueAsString(attr);
-            } else {
-                F4M_DLOG(std::cerr << __func__ << " ignoring drmAdditionalHeaderSet attr "
-                         << attr.name() << std::endl;);
-            }
+        if (!countNodes(1)) {
+            break;
         }
 
+        std::string id = getIdAttr(node.node());
+
         std::vector<DrmAdditionalHeader> dAHs;
 
         for (auto &child : node.node().children()) {
+            if (!countNodes(1)) {
+                break;
+            }
 
             // check we don't escape ns
             if (nodeIsInF4mNs(child)) {
@@ -938,51 +1343,22 @@ void ManifestParser::parseDrmAdditionalHeaderSets(Manifest *manifest)
 
                     DrmAdditionalHeader drmAdditionalHeader;
 
-                    for (auto &attr : child.attributes()) {
-
-                        if (attrNameIs(attr, "id")) {
-                            drmAdditionalHeader.id = getAttrValueAsString(attr);
-                        }
-                        // only in Set
-                        else if (attrNameIs(attr, "prefetchDeadline")) {
-                            drmAdditionalHeader.prefetchDeadline = getAttrValueAsNumber(attr);
-                        }  else if (attrNameIs(attr, "startTimestamp")) {
-                            drmAdditionalHeader.startTimestamp = getAttrValueAsNumber(attr);
-                        }
-                        else if (attrNameIs(attr, "url")) {
-                            drmAdditionalHeader.url = getAttrValueAsString(attr);
-                            if (UrlUtils::isAbsolute(drmAdditionalHeader.url) == false) {
-                                drmAdditionalHeader.url.insert(0, manifest->baseURL + "/");
-                            }
-                        } else {
-                            F4M_DLOG(std::cerr << __func__ <<  " : attr " << attr.name()
-                                     << " ignored" << std::endl;);
-                            getAttrValueAsString(attr);  // D
-                        }
-                    }
-
-                    // get the data if it's here
-                    if (drmAdditionalHeader.url.empty()) {
-                        drmAdditionalHeader.data = getNodeBase64Data(child);
-                        // check
-                        if (drmAdditionalHeader.data.empty()) {
-                            F4M_DLOG(std::cerr << __func__
-                                     << "ignoring malformed drmAdditionalHeader : no data"
-                                     << std::endl;);
-                            continue;
-                        }
+                    parseDrmAdditionalHeaderAttrs(child, &drmAdditionalHeader, true);
+                    if (!parseDrmAdditionalHeaderData(child, &drmAdditionalHeader)) {
+                        continue;
                     }
 
-                    // TODO: check
-
                     dAHs.push_back(drmAdditionalHeader);
                 }
             }
         }
 
-        auto assign = [&](Media media) {
-            if (id.empty() || media.drmAdditionalHeaderId == id) {
+        DrmAdditionalHeaderTimeline timeline;
+        timeline.build(dAHs);
+        auto assign = [&](Media &media) {
+            if (id.empty() || media.drmAdditionalHeaderSetId == id) {
                 media.drmAdditionalHeaderSet = dAHs;
+                media.drmAdditionalHeaderTimeline = timeline;
             }
         };
         forEachMedia(manifest, assign);
@@ -990,42 +1366,275 @@ void ManifestParser::parseDrmAdditionalHeaderSets(Manifest *manifest)
 
 }
 
+// a media whose attributes are parsed, false to end the walk
+template <F4mNames::Contexts Context>
+bool ManifestParser::visitMedia(const pugi::xml_node &node, Media *media, int set,
+                                ManifestVisitor *visitor)
+{
+    ManifestVisitor::Action action = visitor->onMedia(*media, set);
+    if (action == ManifestVisitor::VISIT) {
+        parseMediaData<Context>(node, media);
+        action = visitor->onMediaData(*media, set);
+    }
+    return action != ManifestVisitor::STOP;
+}
+
+bool ManifestParser::visitDrmAdditionalHeader(const pugi::xml_node &node, bool inSet,
+                                              const std::string &setId, ManifestVisitor *visitor)
+{
+    DrmAdditionalHeader drmAdditionalHeader;
+    parseDrmAdditionalHeaderAttrs(node, &drmAdditionalHeader, inSet);
+
+    ManifestVisitor::Action action = visitor->onDrmAdditionalHeader(drmAdditionalHeader, setId);
+    if (action == ManifestVisitor::VISIT
+            && parseDrmAdditionalHeaderData(node, &drmAdditionalHeader)) {
+        action = visitor->onDrmAdditionalHeaderData(drmAdditionalHeader, setId);
+    }
+    return action != ManifestVisitor::STOP;
+}
+
+// the children of <manifest> in document order, the same sections as parseManifest
+template <F4mNames::Contexts Context>
+void ManifestParser::visitSectionsFor(ManifestVisitor *visitor)
+{
+    int set = 0;
+    bool goOn = true;
+
+    for (auto &node : m_f4mDoc->doc().child("manifest").children()) {
+        if (!countNodes(1)) {
+            break;
+        }
+        if (!nodeIsInF4mNs(node)) {
+            continue;
+        }
+
+        switch (F4mNames::manifestChild<Context>(node.name())) {
+        case F4mNames::MEDIA: {
+            Media media;
+            if (parseMediaAttrs<Context>(node, &media)) {
+                goOn = visitMedia<Context>(node, &media, -1, visitor);
+            }
+            break;
+        }
+        case F4mNames::ADAPTIVE_SET: {
+            int index = set++;
+            ManifestVisitor::Action action = visitor->onAdaptiveSet(index);
+            goOn = action != ManifestVisitor::STOP;
+            if (action != ManifestVisitor::VISIT) {
+                break;
+            }
+            Media shared;
+            parseAdaptiveSetAttrs<Context>(node, &shared);
+            for (auto &child : node.children()) {
+                if (!countNodes(1)) {
+                    break;
+                }
+                if (nodeIsInF4mNs(child) && F4mNames::lookup(child.name()) == F4mNames::MEDIA) {
+                    Media media = shared;
+                    parseAdaptiveSetMediaAttrs<Context>(child, &media);
+                    if (!(goOn = visitMedia<Context>(child, &media, index, visitor))) {
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+        case F4mNames::DVR_INFO: {
+            DvrInfo dvrInfo;
+            parseDvrInfoNode<Context>(node, &dvrInfo);
+            goOn = visitor->onDvrInfo(dvrInfo) != ManifestVisitor::STOP;
+            break;
+        }
+        case F4mNames::BOOTSTRAP_INFO: {
+            BootstrapInfo bootstrapInfo;
+            if (!parseBootstrapInfoAttrs<Context>(node, &bootstrapInfo)) {
+                break;
+            }
+            ManifestVisitor::Action action = visitor->onBootstrapInfo(bootstrapInfo);
+            if (action == ManifestVisitor::VISIT && parseBootstrapInfoData(node, &bootstrapInfo)) {
+                action = visitor->onBootstrapInfoData(bootstrapInfo);
+            }
+            goOn = action != ManifestVisitor::STOP;
+            break;
+        }
+        case F4mNames::DRM_ADDITIONAL_HEADER:
+            goOn = visitDrmAdditionalHeader(node, false, std::string(), visitor);
+            break;
+        case F4mNames::DRM_ADDITIONAL_HEADER_SET: {
+            std::string id = getIdAttr(node);
+            ManifestVisitor::Action action = visitor->onDrmAdditionalHeaderSet(id);
+            goOn = action != ManifestVisitor::STOP;
+            if (action != ManifestVisitor::VISIT) {
+                break;
+            }
+            for (auto &child : node.children()) {
+                if (!countNodes(1)) {
+                    break;
+                }
+                if (nodeIsInF4mNs(child) && nodeNameIs(child, "drmAdditionalHeader")) {
+                    if (!(goOn = visitDrmAdditionalHeader(child, true, id, visitor))) {
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+        case F4mNames::CUE_INFO: {
+            std::string id = getIdAttr(node);
+            if (id.empty()) {
+                F4M_DIAG(DIAG_WARNING) << "ignoring cueInfo withour id";
+                break;
+            }
+            ManifestVisitor::Action action = visitor->onCueInfo(id);
+            goOn = action != ManifestVisitor::STOP;
+            if (action != ManifestVisitor::VISIT) {
+                break;
+            }
+            for (auto &child : node.children()) {
+                if (!countNodes(1)) {
+                    break;
+                }
+                Cue cue;
+                if (nodeIsInF4mNs(child) && nodeNameIs(child, "cue") && parseCueNode(child, &cue)) {
+                    if (!(goOn = visitor->onCue(cue, id) != ManifestVisitor::STOP)) {
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+        case F4mNames::SMPTE_TIMECODES: {
+            ManifestVisitor::Action action = visitor->onSmpteTimecodes();
+            goOn = action != ManifestVisitor::STOP;
+            if (action != ManifestVisitor::VISIT) {
+                break;
+            }
+            for (auto &child : node.children()) {
+                if (!countNodes(1)) {
+                    break;
+                }
+                SmpteTimecode smpteTimeCode;
+                if (nodeIsInF4mNs(child) && nodeNameIs(child, "smpteTimecode")
+                        && parseSmpteTimecodeNode(child, &smpteTimeCode)) {
+                    if (!(goOn = visitor->onSmpteTimecode(smpteTimeCode) != ManifestVisitor::STOP)) {
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+        case F4mNames::BEST_EFFORT_FETCH_INFO: {
+            BestEffortFetchInfo bestEffortFetchInfo;
+            parseBestEffortFetchInfoNode(node, &bestEffortFetchInfo);
+            goOn = visitor->onBestEffortFetchInfo(bestEffortFetchInfo) != ManifestVisitor::STOP;
+            break;
+        }
+        // read by the header, or not read in this context
+        default:
+            break;
+        }
+
+        if (!goOn) {
+            return;
+        }
+    }
+}
+
+// one instantiation of the section parsers per F4mNames context
+#define F4M_SECTION_PARSERS(index) \
+    { &ManifestParser::parseMediasFor<1u << (index)>, \
+      &ManifestParser::parseAdaptiveSetsFor<1u << (index)>, \
+      &ManifestParser::parseDvrInfosFor<1u << (index)>, \
+      &ManifestParser::parseBootstrapInfosFor<1u << (index)>, \
+      &ManifestParser::visitSectionsFor<1u << (index)> }
+
+const ManifestParser::SectionParsers ManifestParser::s_sectionParsers[F4mNames::CONTEXT_COUNT] = {
+    F4M_SECTION_PARSERS(0), F4M_SECTION_PARSERS(1), F4M_SECTION_PARSERS(2),
+    F4M_SECTION_PARSERS(3), F4M_SECTION_PARSERS(4), F4M_SECTION_PARSERS(5),
+    F4M_SECTION_PARSERS(6), F4M_SECTION_PARSERS(7), F4M_SECTION_PARSERS(8),
+    F4M_SECTION_PARSERS(9), F4M_SECTION_PARSERS(10), F4M_SECTION_PARSERS(11)
+};
+
+#undef F4M_SECTION_PARSERS
+
+void ManifestParser::parseMedias(Manifest *manifest)
+{
+    (this->*m_sectionParsers->parseMedias)(manifest);
+}
+
+void ManifestParser::parseAdaptiveSets(Manifest *manifest)
+{
+    (this->*m_sectionParsers->parseAdaptiveSets)(manifest);
+}
+
+void ManifestParser::parseDvrInfos(Manifest *manifest)
+{
+    (this->*m_sectionParsers->parseDvrInfos)(manifest);
+}
+
+void ManifestParser::parseBootstrapInfos(Manifest *manifest)
+{
+    (this->*m_sectionParsers->parseBootstrapInfos)(manifest);
+}
+
 bool ManifestParser::updateDvrInfo(void *downloadFileUserPtr,
                                    DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
                                    const std::string &url,
-                                   DvrInfo *dvrInfo)
+                                   DvrInfo *dvrInfo,
+                                   ParseTracer *tracer)
 {
-    long status = -1;
-    std::vector<uint8_t> response;
+    if (!downloadFileUserPtr) {
+        F4M_DIAG(DIAG_WARNING) << "unable to download from url";
+        return false;
+    }
+    CallbackDownloader downloader(downloadFileUserPtr, downloadFileFctPtr);
+    return updateDvrInfo(&downloader, url, dvrInfo, tracer);
+}
+
+bool ManifestParser::updateDvrInfo(Downloader *downloader, const std::string &url,
+                                   DvrInfo *dvrInfo, ParseTracer *tracer)
+{
+    DownloadResponse response;
     pugi::xml_document doc;
+    Instruments instruments;
+    instruments.tracer = tracer;
 
     // check we can download
-    if (!downloadFileUserPtr || url.empty() || !UrlUtils::haveHttpScheme(url)) {
-        F4M_DLOG(std::cerr << __func__ << " unable to download from url" << std::endl;);
+    if (!downloader || url.empty() || !UrlUtils::haveHttpScheme(url)) {
+        F4M_DIAG(DIAG_WARNING) << "unable to download from url";
         return false;
     }
 
     // get xml file
-    response = downloadFileFctPtr(downloadFileUserPtr, url, status);
-    if (status != 200 || response.empty()) {
-        response.clear();
-        F4M_DLOG(std::cerr << __func__
-                 << " get dvrInfo failed with status " << status << std::endl;);
+    {
+        DownloadRequest request;
+        request.url = url;
+        PhaseTimer timer(&instruments, ParseStats::PHASE_DOWNLOAD, &url, TraceSpan::SPAN_DVR_INFO_DOWNLOAD);
+        response = downloader->download(request);
+        timer.setResult(response.data.size(), response.status);
+    }
+    if (response.status != 200 || response.data.empty()) {
+        F4M_DIAG(DIAG_WARNING) << "get dvrInfo failed with status " << response.status;
         return false;
     }
-    response.push_back('\0');
+    response.data.push_back('\0');
 
     // get xml doc
     // response not empty
-    pugi::xml_parse_result result = doc.load_buffer_inplace(response.data(), response.size());
+    pugi::xml_parse_result result;
+    {
+        PhaseTimer timer(&instruments, ParseStats::PHASE_LOAD_XML, &url);
+        result = doc.load_buffer_inplace(response.data.data(), response.data.size());
+        timer.setResult(response.data.size(), result ? 0 : -1);
+    }
     if (!result) {
-        F4M_DLOG(std::cerr << __func__ << " Error description: " << result.description() << "\n";);
+        F4M_DIAG(DIAG_WARNING) << "Error description: " << result.description();
         return false;
     }
 
     // check tag
     if (strcmp(doc.first_child().name(), "dvrInfo")) {
-        F4M_DLOG(std::cerr << __func__ << " root tag is not dvrInfo" << std::endl;);
+        F4M_DIAG(DIAG_WARNING) << "root tag is not dvrInfo";
         return false;
     }
 
@@ -1043,8 +1652,7 @@ bool ManifestParser::updateDvrInfo(void *downloadFileUserPtr,
         } else if (attrNameIs(attr, "offline")) {
             dvrInfo->offline = true;
         } else {
-            F4M_DLOG(std::cerr << __func__ <<  " : attr " << attr.name()
-                     << " ignored" << std::endl;);
+            F4M_DIAG(DIAG_DEBUG) << "attr " << attr.name() << " ignored";
             getAttrValueAsString(attr);  // D
         }
     }
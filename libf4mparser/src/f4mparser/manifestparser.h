@@ -25,29 +25,94 @@
 #define MANIFESTPARSER_H
 
 #include "manifest.h"
+#include "manifestchangeset.h"
+#include "manifestvisitor.h"
+#include "downloader.h"
 #include "manifestdoc.h"
+#include "phasetimer.h"
+#include "parsebudget.h"
+#include "f4mnames.h"
+#include "urlutils.h"
 #include <memory>
+#include <random>
+#include <unordered_map>
+
+// a parser is used by one thread at a time. It can parse several documents one after
+// the other, setParseOptions clears what was left by the previous parse
 
 class ManifestParser
 {
+    friend class ManifestParserBench; // times the private parse steps
+
 private:
     typedef std::vector<uint8_t>(*DOWNLOAD_FILE_FUNCTION)(void *, std::string, long &);
+    typedef void (ManifestParser::*SECTION_PARSE_FUNCTION)(Manifest *);
+    typedef void (ManifestParser::*SECTION_VISIT_FUNCTION)(ManifestVisitor *);
+
+    // the parse steps which depend on the F4M version and the manifest level,
+    // selected once the level is known
+    struct SectionParsers {
+        SECTION_PARSE_FUNCTION parseMedias;
+        SECTION_PARSE_FUNCTION parseAdaptiveSets;
+        SECTION_PARSE_FUNCTION parseDvrInfos;
+        SECTION_PARSE_FUNCTION parseBootstrapInfos;
+        SECTION_VISIT_FUNCTION visitSections;
+    };
+    static const SectionParsers s_sectionParsers[F4mNames::CONTEXT_COUNT];
 
 public:
     ManifestParser(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr);
+    explicit ManifestParser(Downloader *downloader); // NULL if no file is to be downloaded
     bool        parse(std::string url, Manifest* manifest);
+    bool        parseBuffer(std::vector<uint8_t> buffer, const std::string &url, Manifest* manifest);
+    bool        parseBuffer(const uint8_t *data, size_t size, const std::string &url, Manifest* manifest);
+    bool        parseFile(const std::string &path, Manifest* manifest);
+    bool        visit(std::string url, ManifestVisitor *visitor);
+    bool        visitBuffer(const uint8_t *data, size_t size, const std::string &url,
+                            ManifestVisitor *visitor);
+    bool        visitFile(const std::string &path, ManifestVisitor *visitor);
+    // the stats are reset and the error is set as the F4mParseManifest functions do
+    bool        parse(const std::string &url, Manifest *manifest, const ParseOptions &options);
+    bool        parseBuffer(const uint8_t *data, size_t size, const std::string &url, Manifest *manifest,
+                            const ParseOptions &options);
+    bool        refresh(const std::string &url, const Manifest &previous, Manifest *manifest,
+                        ManifestChangeSet *changes, const ParseOptions &options);
+    void        setDownloader(Downloader *downloader) { m_downloader = downloader; }
+    void        setParseOptions(const ParseOptions &options);
+    void        setPreviousManifest(const Manifest *previous); // its blobs are reused when the encoded text is the same
+    ParseOptions::Error error() const; // why the last parse or visit failed
     static bool updateDvrInfo(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
-                              const std::string &url, DvrInfo *dvrInfo);
+                              const std::string &url, DvrInfo *dvrInfo,
+                              ParseTracer *tracer = nullptr);
+    static bool updateDvrInfo(Downloader *downloader, const std::string &url, DvrInfo *dvrInfo,
+                              ParseTracer *tracer = nullptr);
 
 private:
-    void *m_downloadFileUserPtr;
-    DOWNLOAD_FILE_FUNCTION m_downloadFileFctPtr;
-    std::unique_ptr<ManifestDoc> m_f4mDoc;
+    CallbackDownloader m_callbackDownloader; // when built from a download function
+    Downloader *m_downloader;
+    std::unique_ptr<ManifestDoc> m_f4mDoc; // reset for each document
+    const SectionParsers *m_sectionParsers;
+    Instruments m_instruments;
+    unsigned m_skip; // ParseOptions::Skip values
+    ParseBudget m_budget;
+    RetryPolicy m_retry;
+    std::minstd_rand m_random; // backoff jitter
+    UrlUtils::BaseUrl m_baseUrl; // relative urls of the current document are resolved against it
+    std::unordered_multimap<size_t, const std::vector<uint8_t> *> m_previousBlobs; // by decoded size
 
-    bool        initManifestParser();
+    void        resetDoc(const std::string &url);
+    bool        load(const std::string &url);
+    bool        loadBuffer(std::vector<uint8_t> buffer, const std::string &url);
+    bool        loadBuffer(const uint8_t *data, size_t size, const std::string &url);
+    bool        loadFile(const std::string &path);
+    bool        initManifestParser(TraceSpan::Kind downloadKind);
+    bool        parseWith(const ParseOptions &options, const std::function<bool ()> &run);
+    bool        parseDocument(Manifest *manifest);
+    bool        visitDocument(ManifestVisitor *visitor);
     Manifest    parseManifest();
+    void        parseManifestHeader(Manifest *manifest);
     void        parseMLStreamManifests(Manifest *manifest);
-    void        parseMLStreamManifest(Manifest *manifest, Media &media);
+    void        parseMLStreamManifest(Manifest *manifest, Media &media, std::vector<uint8_t> document);
     void        parseMedias(Manifest* manifest);
     void        parseAdaptiveSets(Manifest *manifest);
     void        parseDvrInfos(Manifest *manifest);
@@ -58,17 +123,68 @@ private:
     void        parseBestEffortFetchInfos(Manifest *manifest);
     void        parseDrmAdditionalHeaderSets(Manifest *manifest);
 
+    template <F4mNames::Contexts Context> void parseMediasFor(Manifest *manifest);
+    template <F4mNames::Contexts Context> void parseAdaptiveSetsFor(Manifest *manifest);
+    template <F4mNames::Contexts Context> void parseDvrInfosFor(Manifest *manifest);
+    template <F4mNames::Contexts Context> void parseBootstrapInfosFor(Manifest *manifest);
+    template <F4mNames::Contexts Context> void visitSectionsFor(ManifestVisitor *visitor);
+
+    // one element
+    template <F4mNames::Contexts Context> bool parseMediaAttrs(const pugi::xml_node &node, Media *media);
+    template <F4mNames::Contexts Context> void parseMediaData(const pugi::xml_node &node, Media *media);
+    template <F4mNames::Contexts Context> void parseAdaptiveSetAttrs(const pugi::xml_node &node, Media *shared);
+    template <F4mNames::Contexts Context> void parseAdaptiveSetMediaAttrs(const pugi::xml_node &node, Media *media);
+    template <F4mNames::Contexts Context> void parseDvrInfoNode(const pugi::xml_node &node, DvrInfo *dvrInfo);
+    template <F4mNames::Contexts Context> bool parseBootstrapInfoAttrs(const pugi::xml_node &node,
+                                                                       BootstrapInfo *bootstrapInfo);
+    bool        parseBootstrapInfoData(const pugi::xml_node &node, BootstrapInfo *bootstrapInfo);
+    void        parseDrmAdditionalHeaderAttrs(const pugi::xml_node &node,
+                                              DrmAdditionalHeader *drmAdditionalHeader, bool inSet);
+    bool        parseDrmAdditionalHeaderData(const pugi::xml_node &node,
+                                             DrmAdditionalHeader *drmAdditionalHeader);
+    bool        parseCueNode(const pugi::xml_node &node, Cue *cue);
+    bool        parseSmpteTimecodeNode(const pugi::xml_node &node, SmpteTimecode *smpteTimeCode);
+    void        parseBestEffortFetchInfoNode(const pugi::xml_node &node,
+                                             BestEffortFetchInfo *bestEffortFetchInfo);
+    template <F4mNames::Contexts Context> bool visitMedia(const pugi::xml_node &node, Media *media, int set,
+                                                          ManifestVisitor *visitor);
+    bool        visitDrmAdditionalHeader(const pugi::xml_node &node, bool inSet,
+                                         const std::string &setId, ManifestVisitor *visitor);
+
     // helpers
-    bool        downloadF4mFile(std::vector<uint8_t> *response);
+    DownloadRequest downloadRequest(const std::string &url);
+    bool        downloadF4mFile(std::vector<uint8_t> *response, TraceSpan::Kind downloadKind);
+    bool        downloadF4mFiles(const std::vector<DownloadRequest> &requests,
+                                 std::vector<DownloadResponse> *responses, TraceSpan::Kind downloadKind);
+    void        downloadBatch(const std::vector<DownloadRequest> &requests,
+                              std::vector<DownloadResponse> *responses, TraceSpan::Kind downloadKind);
+    bool        acceptDownload(DownloadResponse *response);
+    uint32_t    hedgeDelayMs() const;
+    bool        backOff(unsigned attempt);
+    void        countDownload(const DownloadResponse &response);
+    static bool retryable(long status);
     void        setManifestVersion(std::string ns);
     void        setManifestLevel(bool isMLMStreamLevel = false);
     void        getManifestProfiles(Manifest *manifest);
     bool        nodeIsInF4mNs(const pugi::xml_node &node);
+    void        selectSectionParsers();
     void        forEachMedia(Manifest *manifest, std::function<void (Media &)> func);
+    void        addPreviousBlobs(const Media &media);
+    void        addPreviousBlob(const std::vector<uint8_t> &blob);
+
+    bool        skips(unsigned section) const { return (m_skip & section) != 0; }
 
     void        printDebugMediaCheck(const Media &media);
+    // false once a limit is exceeded : the parse stops
+    bool        countNodes(size_t count) {
+        if (m_instruments.stats) {
+            m_instruments.stats->nodesVisited += count;
+        }
+        return m_budget.addNodes(count);
+    }
 
     static std::string  sanitizeBaseUrl(const std::string &url);
+    static std::string  directoryUrl(const std::string &url);
 
     static bool         nodeNameIs(const pugi::xpath_node &node, const char *name);
     static bool         nodeNameIs(const pugi::xml_node &node, const char *name);
@@ -78,12 +194,14 @@ private:
     static int          getNodeContentAsInt(const pugi::xpath_node &node, bool *error = nullptr);
     static double       getNodeContentAsNumber(const pugi::xpath_node &node, bool *error = nullptr);
     static std::string  getAttrValueAsString(const pugi::xml_attribute &attribute);
+    static std::string  getIdAttr(const pugi::xml_node &node);
+    std::string         getAttrValueAsUrl(const pugi::xml_attribute &attribute);
     static int          getAttrValueAsInt(const pugi::xml_attribute &attribute,
                                           bool *error = nullptr);
     static double       getAttrValueAsNumber(const pugi::xml_attribute &attribute,
                                                      bool *error = nullptr);
-    static std::vector<uint8_t>    getNodeBase64Data(const pugi::xml_node &node);
-    static std::vector<uint8_t>    getNodeBase64Data(const pugi::xpath_node &node);
+    std::vector<uint8_t>    getNodeBase64Data(const pugi::xml_node &node);
+    std::vector<uint8_t>    getNodeBase64Data(const pugi::xpath_node &node);
 
 };
 
@@ -24,33 +24,175 @@
 #include "manifestparser.h"
 
 #include "base64utils.h"
+#include "numberutils.h"
+#include "diagline.h"
 
 #include <sstream> // split string in tokens using withespace
 #include <algorithm> // remove_if
 
 #include <cstring>
+#include <random>
+#include <thread> // sleep_for
 
-#ifndef F4M_DEBUG
-#define F4M_DLOG(x)
-#else
-#include <iostream> // std::cerr
-#define F4M_DLOG(x) do { x } while(0)
-#endif
+// the time left before the deadline bounds the request
+DownloadRequest ManifestParser::downloadRequest(const std::string &url)
+{
+    DownloadRequest request;
+    request.url = url;
+    request.timeoutMs = m_budget.remainingMs();
+    request.hedgeAfterMs = hedgeDelayMs();
+    return request;
+}
 
-bool ManifestParser::downloadF4mFile(std::vector<uint8_t> *response)
+uint32_t ManifestParser::hedgeDelayMs() const
 {
-    if (!m_downloadFileFctPtr) {
+    static const size_t minLatencies = 16;
+
+    if (m_retry.hedgePercentile > 0 && m_retry.latencies
+            && m_retry.latencies->count() >= minLatencies) {
+        return std::max<uint32_t>(m_retry.latencies->percentile(m_retry.hedgePercentile), 1);
+    }
+    return m_retry.hedgeAfterMs;
+}
+
+// no http status, request timeout, too many requests and server errors
+bool ManifestParser::retryable(long status)
+{
+    return status < 0 || status == 408 || status == 429 || (status >= 500 && status < 600);
+}
+
+// waits before retry 'attempt' (from 0), false when it would end past the deadline
+bool ManifestParser::backOff(unsigned attempt)
+{
+    uint64_t delay = m_retry.backoffMs;
+    for (unsigned i = 0; i < attempt && delay < m_retry.maxBackoffMs; i++) {
+        delay *= 2;
+    }
+    delay = std::min<uint64_t>(delay, m_retry.maxBackoffMs);
+    delay = std::uniform_int_distribution<uint64_t>(delay / 2, delay + delay / 2)(m_random);
+
+    uint32_t remaining = m_budget.remainingMs();
+    if (remaining != 0 && delay >= remaining) {
         return false;
     }
-    long status = -1;
-    *response = m_downloadFileFctPtr(m_downloadFileUserPtr, m_f4mDoc->fileUrl(), status);
-    if (status != 200  || response->empty()) {
-        response->clear();
-        F4M_DLOG(std::cerr << __func__
-                 << " get manifest failed with status " << status << std::endl;);
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    return m_budget.checkDeadline();
+}
+
+void ManifestParser::countDownload(const DownloadResponse &response)
+{
+    if (m_retry.latencies && response.durationMs != 0) {
+        m_retry.latencies->add(response.durationMs);
+    }
+    if (m_instruments.stats && response.hedged) {
+        m_instruments.stats->hedgedRequests++;
+    }
+}
+
+bool ManifestParser::downloadF4mFile(std::vector<uint8_t> *response, TraceSpan::Kind downloadKind)
+{
+    if (!m_downloader) {
+        return false;
+    }
+    DownloadResponse download;
+    for (unsigned attempt = 0; ; attempt++) {
+        {
+            PhaseTimer timer(&m_instruments, ParseStats::PHASE_DOWNLOAD, &m_f4mDoc->fileUrl(), downloadKind);
+            download = m_downloader->download(downloadRequest(m_f4mDoc->fileUrl()));
+            timer.setResult(download.data.size(), download.status);
+        }
+        countDownload(download);
+        if (attempt >= m_retry.maxRetries || !retryable(download.status) || !backOff(attempt)) {
+            break;
+        }
+        F4M_DIAG(DIAG_INFO) << "retrying " << m_f4mDoc->fileUrl() << " after status " << download.status;
+        if (m_instruments.stats) {
+            m_instruments.stats->retries++;
+        }
+    }
+    if (!acceptDownload(&download)) {
         return false;
     }
-    response->push_back('\0');
+    *response = std::move(download.data);
+
+    return true;
+}
+
+// one span for the whole batch, from the current document, then one for each retry
+// of the failed requests
+bool ManifestParser::downloadF4mFiles(const std::vector<DownloadRequest> &requests,
+                                      std::vector<DownloadResponse> *responses,
+                                      TraceSpan::Kind downloadKind)
+{
+    if (!m_downloader) {
+        return false;
+    }
+    downloadBatch(requests, responses, downloadKind);
+
+    for (unsigned attempt = 0; attempt < m_retry.maxRetries; attempt++) {
+        std::vector<size_t> failed;
+        std::vector<DownloadRequest> retries;
+        for (size_t i = 0; i < responses->size(); i++) {
+            if (retryable((*responses)[i].status)) {
+                failed.push_back(i);
+                retries.push_back(downloadRequest(requests[i].url));
+            }
+        }
+        if (failed.empty() || !backOff(attempt)) {
+            break;
+        }
+        F4M_DIAG(DIAG_INFO) << "retrying " << failed.size() << " stream-level manifests";
+        if (m_instruments.stats) {
+            m_instruments.stats->retries += failed.size();
+        }
+
+        std::vector<DownloadResponse> retried;
+        downloadBatch(retries, &retried, downloadKind);
+        for (size_t i = 0; i < failed.size(); i++) {
+            (*responses)[failed[i]] = std::move(retried[i]);
+        }
+    }
+
+    return true;
+}
+
+void ManifestParser::downloadBatch(const std::vector<DownloadRequest> &requests,
+                                   std::vector<DownloadResponse> *responses,
+                                   TraceSpan::Kind downloadKind)
+{
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_DOWNLOAD, &m_f4mDoc->fileUrl(), downloadKind);
+    m_downloader->downloadAll(requests, responses);
+    responses->resize(requests.size());
+
+    uint64_t bytes = 0;
+    long status = 200;
+    for (auto &response : *responses) {
+        countDownload(response);
+        bytes += response.data.size();
+        if (response.status != 200) {
+            status = response.status;
+        }
+    }
+    timer.setResult(bytes, status);
+}
+
+// the body is made ready for pugixml
+bool ManifestParser::acceptDownload(DownloadResponse *response)
+{
+    if (m_instruments.stats) {
+        m_instruments.stats->bytesDownloaded += response->data.size();
+        m_instruments.stats->payloadBuffers++;
+    }
+    if (response->status != 200  || response->data.empty()) {
+        response->data.clear();
+        F4M_DIAG(DIAG_WARNING) << "get manifest failed with status " << response->status;
+        return false;
+    }
+    if (!m_budget.addDocument(response->data.size())) {
+        response->data.clear();
+        return false;
+    }
+    response->data.push_back('\0');
 
     return true;
 }
@@ -61,7 +203,7 @@ void ManifestParser::setManifestVersion(std::string ns)
     std::string query{"/manifest[@version]" + m_f4mDoc->selectNs() + "/@version"};
     pugi::string_t result = pugi::xpath_query{query.data()}.evaluate_string(m_f4mDoc->doc());
     if (!result.empty()) {
-        F4M_DLOG(std::cerr << __func__ << " [version] = " << result << std::endl;);
+        F4M_DIAG(DIAG_DEBUG) << "[version] = " << result;
         m_f4mDoc->setVersion(result);
     }
 }
@@ -69,17 +211,18 @@ void ManifestParser::setManifestVersion(std::string ns)
 void ManifestParser::setManifestLevel(bool isMLMStreamLevel)
 {
     if (isMLMStreamLevel == true) {
-        return m_f4mDoc->setManifestLevel(ManifestDoc::MLM_STREAM_LEVEL);
-    }
-    if (m_f4mDoc->versionMajor() < 2) {
-        return m_f4mDoc->setManifestLevel(ManifestDoc::SLM_STREAM_LEVEL);
-    }
-    std::string query{"/manifest" + m_f4mDoc->selectNs()
-                + "//media[@href]" + m_f4mDoc->selectNs() + "/@href"};
-    pugi::string_t result = pugi::xpath_query{query.data()}.evaluate_string(m_f4mDoc->doc());
-    if (!result.empty()) {
-        return m_f4mDoc->setManifestLevel(ManifestDoc::MLM_SET_LEVEL);
+        m_f4mDoc->setManifestLevel(ManifestDoc::MLM_STREAM_LEVEL);
+    } else if (m_f4mDoc->versionMajor() < 2) {
+        m_f4mDoc->setManifestLevel(ManifestDoc::SLM_STREAM_LEVEL);
+    } else {
+        std::string query{"/manifest" + m_f4mDoc->selectNs()
+                    + "//media[@href]" + m_f4mDoc->selectNs() + "/@href"};
+        pugi::string_t result = pugi::xpath_query{query.data()}.evaluate_string(m_f4mDoc->doc());
+        if (!result.empty()) {
+            m_f4mDoc->setManifestLevel(ManifestDoc::MLM_SET_LEVEL);
+        }
     }
+    selectSectionParsers();
 }
 
 void ManifestParser::getManifestProfiles(Manifest *manifest)
@@ -97,6 +240,17 @@ void ManifestParser::getManifestProfiles(Manifest *manifest)
     }
 }
 
+void ManifestParser::selectSectionParsers()
+{
+    F4mNames::Level level = F4mNames::LEVEL_SINGLE;
+    if (m_f4mDoc->manifestLevel() == ManifestDoc::MLM_SET_LEVEL) {
+        level = F4mNames::LEVEL_SET;
+    } else if (m_f4mDoc->manifestLevel() == ManifestDoc::MLM_STREAM_LEVEL) {
+        level = F4mNames::LEVEL_MLM_STREAM;
+    }
+    m_sectionParsers = &s_sectionParsers[F4mNames::contextIndex(m_f4mDoc->versionMajor(), level)];
+}
+
 bool ManifestParser::nodeIsInF4mNs(const pugi::xml_node &node)
 {
     return std::string{pugi::xpath_query("namespace-uri()")
@@ -121,97 +275,112 @@ void ManifestParser::forEachMedia(Manifest *manifest, std::function<void(Media&)
     }
 }
 
+void ManifestParser::addPreviousBlob(const std::vector<uint8_t> &blob)
+{
+    if (!blob.empty()) {
+        m_previousBlobs.emplace(blob.size(), &blob);
+    }
+}
+
+void ManifestParser::addPreviousBlobs(const Media &media)
+{
+    addPreviousBlob(media.metadata);
+    addPreviousBlob(media.xmpMetadata);
+    addPreviousBlob(media.moov);
+    addPreviousBlob(media.bootstrapInfo.data);
+    addPreviousBlob(media.drmAdditionalHeader.data);
+    for (auto &header : media.drmAdditionalHeaderSet) {
+        addPreviousBlob(header.data);
+    }
+}
+
 std::string ManifestParser::sanitizeBaseUrl(const std::string& url)
 {
-    std::string baseURL = url;
-    if (baseURL.find_first_of('?') != std::string::npos) {
-        baseURL = baseURL.substr(0, baseURL.find_first_of('?'));
+    size_t end = url.find_first_of("?#");
+    if (end == std::string::npos) {
+        end = url.size();
+    }
+    size_t lastSlash = url.rfind('/', end);
+    return url.substr(0, lastSlash != std::string::npos ? lastSlash : end);
+}
+
+// baseURL names a directory, with or without its final '/'
+std::string ManifestParser::directoryUrl(const std::string &url)
+{
+    size_t pathEnd = url.find_first_of("?#");
+    if (pathEnd == std::string::npos) {
+        pathEnd = url.size();
     }
-    if (baseURL.find_first_of('#') != std::string::npos) {
-        baseURL = baseURL.substr(0, baseURL.find_first_of('#'));
+    std::string directory = url;
+    if (pathEnd == 0 || url[pathEnd - 1] != '/') {
+        directory.insert(pathEnd, 1, '/');
     }
-    baseURL = baseURL.substr(0, baseURL.find_last_of('/'));
-    return baseURL;
+    return directory;
 }
 
 void ManifestParser::printDebugMediaCheck(const Media &media)
 {
+    if (!Diagnostics::enabled(DiagEvent::DIAG_INFO)) {
+        return;
+    }
+
     if (m_f4mDoc->isSetLevel()) {
         if (!media.bootstrapInfoId.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     << " bootstrapInfoId present in a set level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "bootstrapInfoId present in a set level manifest";
         }
         if (!media.drmAdditionalHeaderId.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     << " drmAdditionalHeaderId present in a set level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "drmAdditionalHeaderId present in a set level manifest";
         }
         if (!media.url.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     << " url present in a set level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "url present in a set level manifest";
         }
         if (m_f4mDoc->versionMajor() >= 3) {
             if (!media.cueInfoId.empty()) {
-                F4M_DLOG(std::cerr << __func__
-                         << " cueInfoId present in a set level manifest" <<std::endl;);
+                F4M_DIAG(DIAG_INFO) << "cueInfoId present in a set level manifest";
             }
             if (!media.drmAdditionalHeaderSetId.empty()) {
-                F4M_DLOG(std::cerr << __func__
-                         << " drmAdditionalHeaderSetId present in a set level manifest"
-                         <<std::endl;);
+                F4M_DIAG(DIAG_INFO) << "drmAdditionalHeaderSetId present in a set level manifest";
             }
         }
     }
     if (m_f4mDoc->isMultiLevelStreamLevel()) {
         if (media.alternate == true) {
-            F4M_DLOG(std::cerr << __func__
-                     << " alternate present in a stream level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "alternate present in a stream level manifest";
         }
         if (!media.bitrate.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     << " bitrate present in a stream level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "bitrate present in a stream level manifest";
         }
         if (media.height >= 0) {
-            F4M_DLOG(std::cerr << __func__
-                     << " height present in a stream level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "height present in a stream level manifest";
         }
         if (media.width >= 0) {
-            F4M_DLOG(std::cerr << __func__
-                     << " width present in a stream level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "width present in a stream level manifest";
         }
         if (!media.href.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     << " href present in a stream level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "href present in a stream level manifest";
         }
         if (!media.label.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     << " label present in a stream level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "label present in a stream level manifest";
         }
         if (!media.lang.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     << " lang present in a stream level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "lang present in a stream level manifest";
         }
         if (!media.streamId.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     << " streamId present in a stream level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "streamId present in a stream level manifest";
         }
         if (!media.type.empty()) {
-            F4M_DLOG(std::cerr << __func__
-                     << " type present in a stream level manifest" <<std::endl;);
+            F4M_DIAG(DIAG_INFO) << "type present in a stream level manifest";
         }
 
         if (m_f4mDoc->versionMajor() >= 3) {
             if (!media.audioCodec.empty()) {
-                F4M_DLOG(std::cerr << __func__
-                         << " audioCodec present in a stream level manifest" <<std::endl;);
+                F4M_DIAG(DIAG_INFO) << "audioCodec present in a stream level manifest";
             }
             if (!media.videoCodec.empty()) {
-                F4M_DLOG(std::cerr << __func__
-                         << " videoCodec present in a stream level manifest" <<std::endl;);
+                F4M_DIAG(DIAG_INFO) << "videoCodec present in a stream level manifest";
             }
             if (!media.bestEffortFetchInfoId.empty()) {
-                F4M_DLOG(std::cerr << __func__
-                         << " bestEffortFetchInfoId present in a stream level manifest"
-                         <<std::endl;);
+                F4M_DIAG(DIAG_INFO) << "bestEffortFetchInfoId present in a stream level manifest";
             }
         }
     }
@@ -239,131 +408,140 @@ bool ManifestParser::attrNameIs(const pugi::xml_attribute &attr, const char *nam
 
 std::string ManifestParser::getNodeContentAsString(const pugi::xpath_node &node)
 {
-    F4M_DLOG(std::cerr << __func__  << " [" << std::string{node.node().name()}
-             << "] = " + std::string{node.node().child_value()} << std::endl;);
+    F4M_DIAG(DIAG_DEBUG) << "[" << node.node().name() << "] = " << node.node().child_value();
 
     return node.node().child_value();
 }
 
 int ManifestParser::getNodeContentAsInt(const pugi::xpath_node &node, bool *error)
 {
-    if (error) {
-        *error = false;
-    }
+    F4M_DIAG(DIAG_DEBUG) << "[" << node.node().name() << "] = " << node.node().child_value();
+
     int result = 0;
-    std::string str = getNodeContentAsString(node);
-    if (str.empty()) {
-        if (error) {
-            *error = true;
-        }
-        return result;
-    }
-    try {
-        result = std::stoi(str);
-    } catch (...) {
-        F4M_DLOG(std::cerr << __func__
-                 <<  " [" << node.node().name() << "] " << "not an int" << std::endl;);
-        if (error) {
-            *error = true;
-        }
-        result = 0;
+    const char *str = node.node().child_value();
+    bool ok = *str != '\0';
+    if (ok && NumberUtils::parseInt(str, &result) == false) {
+        F4M_DIAG(DIAG_WARNING) << "[" << node.node().name() << "] not an int";
+        ok = false;
+    }
+    if (error) {
+        *error = !ok;
     }
-
     return result;
 }
 
 double ManifestParser::getNodeContentAsNumber(const pugi::xpath_node &node, bool *error)
 {
-    if (error) {
-        *error = false;
-    }
+    F4M_DIAG(DIAG_DEBUG) << "[" << node.node().name() << "] = " << node.node().child_value();
+
     double result = 0.;
-    std::string str = getNodeContentAsString(node);
-    if (str.empty()) {
-        if (error) {
-            *error = true;
-        }
-        return result;
-    }
-    try {
-        result = std::stod(str);
-    } catch (...) {
-        F4M_DLOG(std::cerr << __func__
-                 <<  " [" << node.node().name() << "] " << "not a double" << std::endl;);
-        if (error) {
-            *error = true;
-        }
-        result = 0.;
+    const char *str = node.node().child_value();
+    bool ok = *str != '\0';
+    if (ok && NumberUtils::parseDouble(str, &result) == false) {
+        F4M_DIAG(DIAG_WARNING) << "[" << node.node().name() << "] not a double";
+        ok = false;
+    }
+    if (error) {
+        *error = !ok;
     }
     return result;
 }
 
 std::string ManifestParser::getAttrValueAsString(const pugi::xml_attribute &attribute)
 {
-    F4M_DLOG(std::cerr << __func__  << " [" << std::string{attribute.name()}
-             << "] = " + std::string{attribute.value()} << std::endl;);
+    F4M_DIAG(DIAG_DEBUG) << "[" << attribute.name() << "] = " << attribute.value();
     return attribute.value();
 }
 
-int ManifestParser::getAttrValueAsInt(const pugi::xml_attribute &attribute, bool *error)
+// the id attribute of an element which has no other
+std::string ManifestParser::getIdAttr(const pugi::xml_node &node)
 {
-    if (error) {
-        *error = false;
-    }
-    int result = 0;
-    std::string str = getAttrValueAsString(attribute);
-    if (str.empty()) {
-        if (error) {
-            *error = true;
+    std::string id;
+    for (auto &attr : node.attributes()) {
+        if (attrNameIs(attr, "id")) {
+            id = getAttrValueAsString(attr);
+        } else {
+            F4M_DIAG(DIAG_DEBUG) << "ignoring " << node.name() << " attr " << attr.name();
         }
-        return result;
-    }
-    try {
-        result = std::stoi(str);
-    } catch (...) {
-        F4M_DLOG(std::cerr << __func__
-                 <<  " [" << attribute.name() << "] " << "not an int " << std::endl;);
-        if (error) {
-            *error = true;
-        }
-        result = 0;
     }
+    return id;
+}
 
-    return result;
+std::string ManifestParser::getAttrValueAsUrl(const pugi::xml_attribute &attribute)
+{
+    F4M_DIAG(DIAG_DEBUG) << "[" << attribute.name() << "] = " << attribute.value();
+    return m_baseUrl.resolve(attribute.value());
 }
 
-double ManifestParser::getAttrValueAsNumber(const pugi::xml_attribute &attribute, bool *error)
+int ManifestParser::getAttrValueAsInt(const pugi::xml_attribute &attribute, bool *error)
 {
+    F4M_DIAG(DIAG_DEBUG) << "[" << attribute.name() << "] = " << attribute.value();
+
+    int result = 0;
+    const char *str = attribute.value();
+    bool ok = *str != '\0';
+    if (ok && NumberUtils::parseInt(str, &result) == false) {
+        F4M_DIAG(DIAG_WARNING) << "[" << attribute.name() << "] not an int";
+        ok = false;
+    }
     if (error) {
-        *error = false;
+        *error = !ok;
     }
+    return result;
+}
+
+double ManifestParser::getAttrValueAsNumber(const pugi::xml_attribute &attribute, bool *error)
+{
+    F4M_DIAG(DIAG_DEBUG) << "[" << attribute.name() << "] = " << attribute.value();
+
     double result = 0.;
-    std::string str = getAttrValueAsString(attribute);
-    if (str.empty()) {
-        if (error) {
-            *error = true;
-        }
-        return result;
-    }
-    try {
-        result = std::stod(str);
-    } catch (...) {
-        F4M_DLOG(std::cerr << __func__
-                 <<  " [" << attribute.name() << "] " << "not a double" << std::endl;);
-        if (error) {
-            *error = true;
-        }
-        result = 0.;
+    const char *str = attribute.value();
+    bool ok = *str != '\0';
+    if (ok && NumberUtils::parseDouble(str, &result) == false) {
+        F4M_DIAG(DIAG_WARNING) << "[" << attribute.name() << "] not a double";
+        ok = false;
+    }
+    if (error) {
+        *error = !ok;
     }
-
     return result;
 }
 
 std::vector<uint8_t> ManifestParser::getNodeBase64Data(const pugi::xml_node &node)
 {
+    PhaseTimer timer(&m_instruments, ParseStats::PHASE_BASE64_DECODE, &m_f4mDoc->fileUrl());
+
+    // sizing the data costs a pass over the text, only done when it is bounded
+    if (m_budget.limitsDecodedBytes()
+            && !m_budget.addDecoded(Base64Utils::decodedSize(node.child_value()))) {
+        return std::vector<uint8_t>();
+    }
+
+    // on a refresh most blobs are unchanged : copy the previous one instead of decoding
+    if (!m_previousBlobs.empty()) {
+        const char *text = node.child_value();
+        auto candidates = m_previousBlobs.equal_range(Base64Utils::decodedSize(text));
+        for (auto it = candidates.first; it != candidates.second; ++it) {
+            if (Base64Utils::matches(text, *it->second)) {
+                timer.setResult(it->second->size(), 0);
+                if (m_instruments.stats) {
+                    m_instruments.stats->bytesReused += it->second->size();
+                    m_instruments.stats->payloadBuffers += 1;  // the copy
+                }
+                return *it->second;
+            }
+        }
+    }
+
     std::string content = node.child_value();
     content.erase(remove_if(begin(content), end(content), isspace), end(content));  // trim
-    return Base64Utils::decode(content);
+    std::vector<uint8_t> data = Base64Utils::decode(content);
+    timer.setResult(data.size(), 0);
+    if (m_instruments.stats) {
+        m_instruments.stats->bytesDecoded += data.size();
+        m_instruments.stats->payloadBuffers += 2;  // trimmed copy + decoded data
+    }
+    return data;
 }
 
 std::vector<uint8_t> ManifestParser::getNodeBase64Data(const pugi::xpath_node &node)
@@ -0,0 +1,184 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "manifestresolver.h"
+
+#include "manifestparser.h"
+#include "singleflight.h"
+
+class ParseResult
+{
+public:
+    ParseResult() : error(ParseOptions::ERROR_NONE) {}
+
+    Manifest manifest;
+    ParseOptions::Error error;
+};
+
+class ResolverFlights
+{
+public:
+    SingleFlight<ParseResult> parses;
+    SingleFlight<DvrInfo> dvrInfos;
+    SingleFlight<DownloadResponse> downloads;
+};
+
+// the downloads of one parse, coalesced with the downloads of the other threads
+class CoalescingDownloader : public Downloader
+{
+public:
+    explicit CoalescingDownloader(ManifestResolver *resolver) : m_resolver(resolver) {}
+
+    DownloadResponse download(const DownloadRequest &request) override {
+        SingleFlight<DownloadResponse> &downloads = m_resolver->m_flights->downloads;
+        DownloadResponse response;
+        auto flight = downloads.join(request.url);
+        if (flight.leads()) {
+            response = m_resolver->m_downloader->download(request);
+            downloads.finish(&flight, true, response);
+        } else {
+            downloads.wait(&flight, &response);
+            m_resolver->m_coalescedDownloads++;
+        }
+        return response;
+    }
+
+    // the requests led here are submitted as one batch, before waiting for the others
+    void downloadAll(const std::vector<DownloadRequest> &requests,
+                     std::vector<DownloadResponse> *responses) override {
+        SingleFlight<DownloadResponse> &downloads = m_resolver->m_flights->downloads;
+        std::vector<SingleFlight<DownloadResponse>::Flight> flights;
+        std::vector<DownloadRequest> led;
+        for (auto &request : requests) {
+            flights.push_back(downloads.join(request.url));
+            if (flights.back().leads()) {
+                led.push_back(request);
+            }
+        }
+
+        std::vector<DownloadResponse> ledResponses;
+        if (!led.empty()) {
+            m_resolver->m_downloader->downloadAll(led, &ledResponses);
+            ledResponses.resize(led.size());
+        }
+
+        responses->clear();
+        responses->resize(requests.size());
+        size_t next = 0;
+        for (size_t i = 0; i < flights.size(); i++) {
+            if (flights[i].leads()) {
+                (*responses)[i] = std::move(ledResponses[next++]);
+                downloads.finish(&flights[i], true, (*responses)[i]);
+            }
+        }
+        for (size_t i = 0; i < flights.size(); i++) {
+            if (!flights[i].leads()) {
+                downloads.wait(&flights[i], &(*responses)[i]);
+                m_resolver->m_coalescedDownloads++;
+            }
+        }
+    }
+
+private:
+    ManifestResolver *m_resolver;
+};
+
+ManifestResolver::ManifestResolver(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                                   const ParseOptions &options)
+    : m_callbackDownloader(downloadFileUserPtr, downloadFileFctPtr), m_downloader(&m_callbackDownloader),
+      m_options(options), m_flights(new ResolverFlights), m_coalescedParses(0), m_coalescedDownloads(0)
+{
+    m_options.stats = nullptr;
+    m_options.tracer = nullptr;
+    m_options.error = nullptr;
+}
+
+ManifestResolver::ManifestResolver(Downloader *downloader, const ParseOptions &options)
+    : m_callbackDownloader(nullptr, nullptr), m_downloader(downloader),
+      m_options(options), m_flights(new ResolverFlights), m_coalescedParses(0), m_coalescedDownloads(0)
+{
+    m_options.stats = nullptr;
+    m_options.tracer = nullptr;
+    m_options.error = nullptr;
+}
+
+ManifestResolver::~ManifestResolver()
+{
+}
+
+bool ManifestResolver::parse(const std::string &url, Manifest *manifest, ParseOptions::Error *error)
+{
+    ParseResult result;
+    auto flight = m_flights->parses.join(url);
+    bool ok;
+    if (flight.leads()) {
+        CoalescingDownloader downloader(this);
+        ManifestParser manifestParser(&downloader);
+        manifestParser.setParseOptions(m_options);
+        ok = manifestParser.parse(url, &result.manifest);
+        result.error = ok ? ParseOptions::ERROR_NONE : manifestParser.error();
+        m_flights->parses.finish(&flight, ok, result);
+    } else {
+        ok = m_flights->parses.wait(&flight, &result);
+        if (!ok && result.error == ParseOptions::ERROR_NONE) {
+            // the leader threw
+            result.error = ParseOptions::ERROR_FAILED;
+        }
+        m_coalescedParses++;
+    }
+
+    if (error) {
+        *error = result.error;
+    }
+    if (ok) {
+        *manifest = std::move(result.manifest);
+    }
+    return ok;
+}
+
+bool ManifestResolver::updateDvrInfo(const std::string &url, DvrInfo *dvrInfo)
+{
+    // the document only overrides the attributes it has, the result depends on the
+    // input too : only the updates of the same input are joined, the download is
+    // shared by all of them
+    std::string key = url + '\x1f' + dvrInfo->id + '\x1f' + dvrInfo->url
+            + '\x1f' + std::to_string(dvrInfo->beginOffset) + '\x1f' + std::to_string(dvrInfo->endOffset)
+            + '\x1f' + std::to_string(dvrInfo->windowDuration)
+            + '\x1f' + (dvrInfo->offline ? '1' : '0') + (dvrInfo->empty ? '1' : '0');
+    DvrInfo result = *dvrInfo;
+    auto flight = m_flights->dvrInfos.join(key);
+    bool ok;
+    if (flight.leads()) {
+        CoalescingDownloader downloader(this);
+        ok = ManifestParser::updateDvrInfo(&downloader, url, &result);
+        m_flights->dvrInfos.finish(&flight, ok, result);
+    } else {
+        ok = m_flights->dvrInfos.wait(&flight, &result);
+        m_coalescedParses++;
+    }
+
+    if (ok) {
+        *dvrInfo = result;
+    }
+    return ok;
+}
@@ -0,0 +1,103 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file manifestresolver.h
+ *  \brief Coalesces the concurrent parses of the same manifest.
+ *
+ *  A ManifestResolver is shared by the threads of an application. When several threads
+ *  ask for the same url at the same time, only the first one downloads and parses it,
+ *  the others wait and get a copy of its result. The downloads are coalesced the same
+ *  way, so a stream-level manifest or a dvrInfo document used by several manifests
+ *  being parsed at the same time is fetched once.
+ *
+ *  Only concurrent requests are coalesced, no result is kept once it is handed out.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef MANIFESTRESOLVER_H
+#define MANIFESTRESOLVER_H
+
+#include "manifest.h"
+#include "downloader.h"
+#include "parseoptions.h"
+
+#include <atomic>
+#include <memory>
+
+class ResolverFlights;
+
+#pragma GCC visibility push(default)
+
+/*! \brief Parses manifests for several threads, one parse per url at a time.
+ */
+class ManifestResolver
+{
+public:
+    typedef std::vector<uint8_t>(*DOWNLOAD_FILE_FUNCTION)(void *, std::string, long &);
+
+    /*! \brief the function is called from several threads at once.
+     *
+     * \param[in]  options              Used for every parse. Its stats, tracer and error pointers are ignored
+    */
+    ManifestResolver(void *downloadFileUserPtr, DOWNLOAD_FILE_FUNCTION downloadFileFctPtr,
+                     const ParseOptions &options);
+
+    /*! \brief the downloader is called from several threads at once, it must allow it.
+    */
+    ManifestResolver(Downloader *downloader, const ParseOptions &options);
+
+    ~ManifestResolver();
+
+    /*! \brief same as F4mParseManifest, joining the parse of 'url' in progress if any.
+     *
+     * \param[out] error                Why the parse failed, or NULL
+    */
+    bool parse(const std::string &url, Manifest *manifest, ParseOptions::Error *error = nullptr);
+
+    /*! \brief same as F4mUpdateDvrInfo, joining the update from 'url' of the same 'dvrInfo' in progress if any.
+     *
+     * The updates of different 'dvrInfo' from 'url' share the download only.
+    */
+    bool updateDvrInfo(const std::string &url, DvrInfo *dvrInfo);
+
+    uint64_t coalescedParses() const { return m_coalescedParses; } ///< parses and dvrInfo updates which joined another one
+    uint64_t coalescedDownloads() const { return m_coalescedDownloads; } ///< downloads which joined another one
+
+private:
+    ManifestResolver(const ManifestResolver &) = delete;
+    ManifestResolver& operator=(const ManifestResolver &) = delete;
+
+    friend class CoalescingDownloader;
+
+    CallbackDownloader m_callbackDownloader;
+    Downloader *m_downloader;
+    ParseOptions m_options;
+    std::unique_ptr<ResolverFlights> m_flights;
+    std::atomic<uint64_t> m_coalescedParses;
+    std::atomic<uint64_t> m_coalescedDownloads;
+};
+
+#pragma GCC visibility pop
+
+#endif // MANIFESTRESOLVER_H
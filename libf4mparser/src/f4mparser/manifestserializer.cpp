@@ -0,0 +1,557 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "manifestserializer.h"
+
+#include "binaryio.h"
+#include "diagline.h"
+
+// write
+
+static void writeDrmAdditionalHeader(BinaryWriter &w, const DrmAdditionalHeader &dah)
+{
+    w.writeU8(dah.empty);
+    w.writeString(dah.id);
+    w.writeString(dah.url);
+    w.writeBlob(dah.data);
+    w.writeDouble(dah.prefetchDeadline);
+    w.writeDouble(dah.startTimestamp);
+}
+
+static void writeDvrInfo(BinaryWriter &w, const DvrInfo &dvrInfo)
+{
+    w.writeU8(dvrInfo.empty);
+    w.writeString(dvrInfo.id);
+    w.writeI32(dvrInfo.beginOffset);
+    w.writeI32(dvrInfo.endOffset);
+    w.writeU8(dvrInfo.offline);
+    w.writeString(dvrInfo.url);
+    w.writeI32(dvrInfo.windowDuration);
+}
+
+static void writeBootstrapInfo(BinaryWriter &w, const BootstrapInfo &bootstrapInfo)
+{
+    w.writeU8(bootstrapInfo.empty);
+    w.writeString(bootstrapInfo.id);
+    w.writeString(bootstrapInfo.profile);
+    w.writeString(bootstrapInfo.url);
+    w.writeBlob(bootstrapInfo.data);
+    w.writeDouble(bootstrapInfo.fragmentDuration);
+    w.writeDouble(bootstrapInfo.segmentDuration);
+}
+
+static void writeCue(BinaryWriter &w, const Cue &cue)
+{
+    w.writeI32(cue.availNum);
+    w.writeI32(cue.availsExpected);
+    w.writeDouble(cue.duration);
+    w.writeString(cue.id);
+    w.writeDouble(cue.time);
+    w.writeString(cue.type);
+    w.writeString(cue.programId);
+}
+
+static void writeSmpteTimecode(BinaryWriter &w, const SmpteTimecode &smpteTimecode)
+{
+    w.writeString(smpteTimecode.smpte);
+    w.writeDouble(smpteTimecode.timestamp);
+    w.writeString(smpteTimecode.date);
+    w.writeString(smpteTimecode.timezone);
+}
+
+static void writeBestEffortFetchInfo(BinaryWriter &w, const BestEffortFetchInfo &befi)
+{
+    w.writeU8(befi.empty);
+    w.writeString(befi.id);
+    w.writeDouble(befi.fragmentDuration);
+    w.writeDouble(befi.segmentDuration);
+}
+
+static void writeMedia(BinaryWriter &w, const Media &media)
+{
+    size_t sizePos = w.reserveU32();
+
+    w.writeString(media.bitrate);
+    w.writeI32(media.width);
+    w.writeI32(media.height);
+    w.writeString(media.streamId);
+    w.writeString(media.url);
+    w.writeString(media.href);
+    w.writeBlob(media.metadata);
+    w.writeString(media.bootstrapInfoId);
+    writeBootstrapInfo(w, media.bootstrapInfo);
+    w.writeString(media.drmAdditionalHeaderId);
+    writeDrmAdditionalHeader(w, media.drmAdditionalHeader);
+    w.writeU8(media.alternate);
+    w.writeString(media.type);
+    w.writeString(media.label);
+    w.writeString(media.lang);
+    w.writeString(media.groupspec);
+    w.writeString(media.multicastStreamName);
+    w.writeBlob(media.xmpMetadata);
+    w.writeBlob(media.moov);
+    w.writeString(media.dvrInfoId);
+    writeDvrInfo(w, media.dvrInfo);
+    w.writeString(media.audioCodec);
+    w.writeString(media.videoCodec);
+    w.writeString(media.cueInfoId);
+    w.writeU32(static_cast<uint32_t>(media.cueInfo.size()));
+    for (const auto &cue : media.cueInfo) {
+        writeCue(w, cue);
+    }
+    w.writeString(media.bestEffortFetchInfoId);
+    writeBestEffortFetchInfo(w, media.bestEffortFetchInfo);
+    w.writeString(media.drmAdditionalHeaderSetId);
+    w.writeU32(static_cast<uint32_t>(media.drmAdditionalHeaderSet.size()));
+    for (const auto &dah : media.drmAdditionalHeaderSet) {
+        writeDrmAdditionalHeader(w, dah);
+    }
+    w.writeU32(static_cast<uint32_t>(media.smpteTimeCodes.size()));
+    for (const auto &smpteTimecode : media.smpteTimeCodes) {
+        writeSmpteTimecode(w, smpteTimecode);
+    }
+
+    w.patchU32(sizePos, static_cast<uint32_t>(w.size() - sizePos - 4));
+}
+
+static void writeMedias(BinaryWriter &w, const std::vector<Media> &medias)
+{
+    w.writeU32(static_cast<uint32_t>(medias.size()));
+    for (const auto &media : medias) {
+        writeMedia(w, media);
+    }
+}
+
+// read
+
+static void readDrmAdditionalHeader(BinaryReader &r, DrmAdditionalHeader *dah)
+{
+    dah->empty = r.readU8();
+    r.readString(&dah->id);
+    r.readString(&dah->url);
+    r.readBlob(&dah->data);
+    dah->prefetchDeadline = r.readDouble();
+    dah->startTimestamp = r.readDouble();
+}
+
+static void readDvrInfo(BinaryReader &r, DvrInfo *dvrInfo)
+{
+    dvrInfo->empty = r.readU8();
+    r.readString(&dvrInfo->id);
+    dvrInfo->beginOffset = r.readI32();
+    dvrInfo->endOffset = r.readI32();
+    dvrInfo->offline = r.readU8();
+    r.readString(&dvrInfo->url);
+    dvrInfo->windowDuration = r.readI32();
+}
+
+static void readBootstrapInfo(BinaryReader &r, BootstrapInfo *bootstrapInfo)
+{
+    bootstrapInfo->empty = r.readU8();
+    r.readString(&bootstrapInfo->id);
+    r.readString(&bootstrapInfo->profile);
+    r.readString(&bootstrapInfo->url);
+    r.readBlob(&bootstrapInfo->data);
+    bootstrapInfo->fragmentDuration = r.readDouble();
+    bootstrapInfo->segmentDuration = r.readDouble();
+}
+
+static void readCue(BinaryReader &r, Cue *cue)
+{
+    cue->availNum = r.readI32();
+    cue->availsExpected = r.readI32();
+    cue->duration = r.readDouble();
+    r.readString(&cue->id);
+    cue->time = r.readDouble();
+    r.readString(&cue->type);
+    r.readString(&cue->programId);
+}
+
+static void readSmpteTimecode(BinaryReader &r, SmpteTimecode *smpteTimecode)
+{
+    r.readString(&smpteTimecode->smpte);
+    smpteTimecode->timestamp = r.readDouble();
+    r.readString(&smpteTimecode->date);
+    r.readString(&smpteTimecode->timezone);
+    SmpteTimecodeIndex::parseSmpte(smpteTimecode->smpte, smpteTimecode);
+}
+
+static void readBestEffortFetchInfo(BinaryReader &r, BestEffortFetchInfo *befi)
+{
+    befi->empty = r.readU8();
+    r.readString(&befi->id);
+    befi->fragmentDuration = r.readDouble();
+    befi->segmentDuration = r.readDouble();
+}
+
+static bool readMedia(BinaryReader &r, Media *media)
+{
+    uint32_t recordSize = r.readU32();
+    size_t recordEnd = r.pos() + recordSize;
+
+    r.readString(&media->bitrate);
+    media->width = r.readI32();
+    media->height = r.readI32();
+    r.readString(&media->streamId);
+    r.readString(&media->url);
+    r.readString(&media->href);
+    r.readBlob(&media->metadata);
+    r.readString(&media->bootstrapInfoId);
+    readBootstrapInfo(r, &media->bootstrapInfo);
+    r.readString(&media->drmAdditionalHeaderId);
+    readDrmAdditionalHeader(r, &media->drmAdditionalHeader);
+    media->alternate = r.readU8();
+    r.readString(&media->type);
+    r.readString(&media->label);
+    r.readString(&media->lang);
+    r.readString(&media->groupspec);
+    r.readString(&media->multicastStreamName);
+    r.readBlob(&media->xmpMetadata);
+    r.readBlob(&media->moov);
+    r.readString(&media->dvrInfoId);
+    readDvrInfo(r, &media->dvrInfo);
+    r.readString(&media->audioCodec);
+    r.readString(&media->videoCodec);
+    r.readString(&media->cueInfoId);
+    media->cueInfo.resize(r.readCount(4));
+    for (auto &cue : media->cueInfo) {
+        readCue(r, &cue);
+    }
+    media->cueIndex.build(media->cueInfo);
+    r.readString(&media->bestEffortFetchInfoId);
+    readBestEffortFetchInfo(r, &media->bestEffortFetchInfo);
+    r.readString(&media->drmAdditionalHeaderSetId);
+    media->drmAdditionalHeaderSet.resize(r.readCount(4));
+    for (auto &dah : media->drmAdditionalHeaderSet) {
+        readDrmAdditionalHeader(r, &dah);
+    }
+    media->drmAdditionalHeaderTimeline.build(media->drmAdditionalHeaderSet);
+    media->smpteTimeCodes.resize(r.readCount(4));
+    for (auto &smpteTimecode : media->smpteTimeCodes) {
+        readSmpteTimecode(r, &smpteTimecode);
+    }
+    media->smpteTimecodeIndex.build(media->smpteTimeCodes);
+
+    // the record size must match what was read
+    return !r.error() && r.pos() == recordEnd;
+}
+
+static bool readMedias(BinaryReader &r, std::vector<Media> *medias)
+{
+    medias->resize(r.readCount(4));
+    for (auto &media : *medias) {
+        if (!readMedia(r, &media)) {
+            return false;
+        }
+    }
+    return !r.error();
+}
+
+// scan, must follow the layout of the write functions above
+
+static void skipBytes(BinaryReader &r)
+{
+    size_t len;
+    r.readBytes(&len);
+}
+
+static void skipDrmAdditionalHeader(BinaryReader &r, size_t *url, size_t *data)
+{
+    r.skip(1);
+    skipBytes(r);
+    *url = r.pos();
+    skipBytes(r);
+    *data = r.pos();
+    skipBytes(r);
+    r.skip(16);
+}
+
+static void skipCue(BinaryReader &r)
+{
+    r.skip(16);
+    skipBytes(r);
+    r.skip(8);
+    skipBytes(r);
+    skipBytes(r);
+}
+
+static void skipSmpteTimecode(BinaryReader &r)
+{
+    skipBytes(r);
+    r.skip(8);
+    skipBytes(r);
+    skipBytes(r);
+}
+
+static bool scanMedias(BinaryReader &r, std::vector<size_t> *medias)
+{
+    medias->resize(r.readCount(4));
+    for (auto &offset : *medias) {
+        offset = r.pos();
+        if (!r.skip(r.readU32())) {
+            return false;
+        }
+    }
+    return !r.error();
+}
+
+namespace ManifestSerializer
+{
+
+std::vector<uint8_t> serialize(const Manifest &manifest)
+{
+    std::vector<uint8_t> out;
+    BinaryWriter w(&out);
+
+    for (size_t i = 0; i < sizeof(magic); ++i) {
+        w.writeU8(magic[i]);
+    }
+    w.writeU16(formatVersion);
+    w.writeU16(0);
+    size_t sizePos = w.reserveU32();
+
+    w.writeString(manifest.id);
+    w.writeDouble(manifest.duration);
+    w.writeString(manifest.startTime);
+    w.writeString(manifest.mimeType);
+    w.writeString(manifest.streamType);
+    w.writeString(manifest.deliveryType);
+    w.writeString(manifest.label);
+    w.writeString(manifest.lang);
+    w.writeString(manifest.baseURL);
+    w.writeU32(static_cast<uint32_t>(manifest.profiles.size()));
+    for (const auto &profile : manifest.profiles) {
+        w.writeString(profile);
+    }
+    writeMedias(w, manifest.medias);
+    w.writeU32(static_cast<uint32_t>(manifest.adaptiveSets.size()));
+    for (const auto &aSet : manifest.adaptiveSets) {
+        writeMedias(w, aSet.medias);
+    }
+
+    w.patchU32(sizePos, static_cast<uint32_t>(w.size() - headerSize));
+
+    return out;
+}
+
+bool deserialize(const uint8_t *data, size_t size, Manifest *manifest)
+{
+    if (!data || size < headerSize || memcmp(data, magic, sizeof(magic)) != 0) {
+        F4M_DIAG(DIAG_WARNING) << "not a binary manifest";
+        return false;
+    }
+
+    BinaryReader r(data, size);
+    r.skip(sizeof(magic));
+    uint16_t version = r.readU16();
+    if (version != formatVersion) {
+        F4M_DIAG(DIAG_WARNING) << "unsupported format version " << version;
+        return false;
+    }
+    r.readU16();
+    uint32_t payloadSize = r.readU32();
+    if (payloadSize != r.remaining()) {
+        F4M_DIAG(DIAG_WARNING) << "truncated binary manifest";
+        return false;
+    }
+
+    Manifest result;
+
+    r.readString(&result.id);
+    result.duration = r.readDouble();
+    r.readString(&result.startTime);
+    r.readString(&result.mimeType);
+    r.readString(&result.streamType);
+    r.readString(&result.deliveryType);
+    r.readString(&result.label);
+    r.readString(&result.lang);
+    r.readString(&result.baseURL);
+    result.profiles.resize(r.readCount(4));
+    for (auto &profile : result.profiles) {
+        r.readString(&profile);
+    }
+    if (!readMedias(r, &result.medias)) {
+        F4M_DIAG(DIAG_WARNING) << "malformed media record";
+        return false;
+    }
+    result.adaptiveSets.resize(r.readCount(4));
+    for (auto &aSet : result.adaptiveSets) {
+        if (!readMedias(r, &aSet.medias)) {
+            F4M_DIAG(DIAG_WARNING) << "malformed adaptiveSet record";
+            return false;
+        }
+    }
+
+    if (r.error() || r.remaining() != 0) {
+        F4M_DIAG(DIAG_WARNING) << "malformed binary manifest";
+        return false;
+    }
+
+    result.renditions.build(result);
+    *manifest = std::move(result);
+
+    return true;
+}
+
+bool scanManifest(const uint8_t *data, size_t size, ManifestLayout *layout)
+{
+    if (!data || size < headerSize || memcmp(data, magic, sizeof(magic)) != 0) {
+        return false;
+    }
+
+    BinaryReader r(data, size);
+    r.skip(sizeof(magic));
+    if (r.readU16() != formatVersion) {
+        return false;
+    }
+    r.readU16();
+    if (r.readU32() != r.remaining()) {
+        return false;
+    }
+
+    for (int field = MANIFEST_ID; field < MANIFEST_FIELD_COUNT; ++field) {
+        layout->fields[field] = r.pos();
+        if (field == MANIFEST_DURATION) {
+            r.skip(8);
+        } else if (field == MANIFEST_PROFILES) {
+            uint32_t count = r.readCount(4);
+            for (uint32_t i = 0; i < count; ++i) {
+                skipBytes(r);
+            }
+        } else {
+            skipBytes(r);
+        }
+    }
+
+    if (!scanMedias(r, &layout->medias)) {
+        return false;
+    }
+    layout->adaptiveSets.resize(r.readCount(4));
+    for (auto &aSet : layout->adaptiveSets) {
+        if (!scanMedias(r, &aSet)) {
+            return false;
+        }
+    }
+
+    return !r.error() && r.remaining() == 0;
+}
+
+bool scanMedia(const uint8_t *data, size_t size, size_t offset, MediaLayout *layout)
+{
+    BinaryReader r(data, size);
+    r.seek(offset);
+    uint32_t recordSize = r.readU32();
+    size_t recordEnd = r.pos() + recordSize;
+
+    size_t *f = layout->fields;
+
+    f[MEDIA_BITRATE] = r.pos();
+    skipBytes(r);
+    f[MEDIA_WIDTH] = r.pos();
+    r.skip(4);
+    f[MEDIA_HEIGHT] = r.pos();
+    r.skip(4);
+    f[MEDIA_STREAM_ID] = r.pos();
+    skipBytes(r);
+    f[MEDIA_URL] = r.pos();
+    skipBytes(r);
+    f[MEDIA_HREF] = r.pos();
+    skipBytes(r);
+    f[MEDIA_METADATA] = r.pos();
+    skipBytes(r);
+    f[MEDIA_BOOTSTRAP_INFO_ID] = r.pos();
+    skipBytes(r);
+    // bootstrapInfo
+    r.skip(1);
+    skipBytes(r);
+    f[MEDIA_BOOTSTRAP_INFO_PROFILE] = r.pos();
+    skipBytes(r);
+    f[MEDIA_BOOTSTRAP_INFO_URL] = r.pos();
+    skipBytes(r);
+    f[MEDIA_BOOTSTRAP_INFO_DATA] = r.pos();
+    skipBytes(r);
+    r.skip(16);
+    f[MEDIA_DRM_ADDITIONAL_HEADER_ID] = r.pos();
+    skipBytes(r);
+    skipDrmAdditionalHeader(r, &f[MEDIA_DRM_ADDITIONAL_HEADER_URL],
+                            &f[MEDIA_DRM_ADDITIONAL_HEADER_DATA]);
+    f[MEDIA_ALTERNATE] = r.pos();
+    r.skip(1);
+    f[MEDIA_TYPE] = r.pos();
+    skipBytes(r);
+    f[MEDIA_LABEL] = r.pos();
+    skipBytes(r);
+    f[MEDIA_LANG] = r.pos();
+    skipBytes(r);
+    f[MEDIA_GROUPSPEC] = r.pos();
+    skipBytes(r);
+    f[MEDIA_MULTICAST_STREAM_NAME] = r.pos();
+    skipBytes(r);
+    f[MEDIA_XMP_METADATA] = r.pos();
+    skipBytes(r);
+    f[MEDIA_MOOV] = r.pos();
+    skipBytes(r);
+    f[MEDIA_DVR_INFO_ID] = r.pos();
+    skipBytes(r);
+    // dvrInfo
+    r.skip(1);
+    skipBytes(r);
+    r.skip(9);
+    f[MEDIA_DVR_INFO_URL] = r.pos();
+    skipBytes(r);
+    r.skip(4);
+    f[MEDIA_AUDIO_CODEC] = r.pos();
+    skipBytes(r);
+    f[MEDIA_VIDEO_CODEC] = r.pos();
+    skipBytes(r);
+    f[MEDIA_CUE_INFO_ID] = r.pos();
+    skipBytes(r);
+    f[MEDIA_CUE_INFO] = r.pos();
+    uint32_t count = r.readCount(4);
+    for (uint32_t i = 0; i < count; ++i) {
+        skipCue(r);
+    }
+    f[MEDIA_BEST_EFFORT_FETCH_INFO_ID] = r.pos();
+    skipBytes(r);
+    // bestEffortFetchInfo
+    r.skip(1);
+    skipBytes(r);
+    r.skip(16);
+    f[MEDIA_DRM_ADDITIONAL_HEADER_SET_ID] = r.pos();
+    skipBytes(r);
+    f[MEDIA_DRM_ADDITIONAL_HEADER_SET] = r.pos();
+    count = r.readCount(4);
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t url, data;
+        skipDrmAdditionalHeader(r, &url, &data);
+    }
+    f[MEDIA_SMPTE_TIMECODES] = r.pos();
+    count = r.readCount(4);
+    for (uint32_t i = 0; i < count; ++i) {
+        skipSmpteTimecode(r);
+    }
+
+    return !r.error() && r.pos() == recordEnd;
+}
+
+} // namespace ManifestSerializer
@@ -0,0 +1,122 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#ifndef MANIFESTSERIALIZER_H
+#define MANIFESTSERIALIZER_H
+
+#include "manifest.h"
+
+// Binary layout, all integers little-endian :
+//
+// header   : magic "F4MB", u16 format version, u16 reserved, u32 payload size
+// payload  : manifest record
+//
+// string/blob : u32 size + bytes (no terminating '\0')
+// vector      : u32 count + elements
+// media       : u32 record size + fields in Media declaration order,
+//               so a reader can jump over a media without decoding it
+
+namespace ManifestSerializer
+{
+    const uint8_t  magic[4] = {'F', '4', 'M', 'B'};
+    const uint16_t formatVersion = 1;
+    const size_t   headerSize = 12;
+
+    std::vector<uint8_t> serialize(const Manifest &manifest);
+
+    bool deserialize(const uint8_t *data, size_t size, Manifest *manifest);
+
+    // offsets of the fields inside a serialized media record, for reading in place
+    enum MediaField {
+        MEDIA_BITRATE,
+        MEDIA_WIDTH,
+        MEDIA_HEIGHT,
+        MEDIA_STREAM_ID,
+        MEDIA_URL,
+        MEDIA_HREF,
+        MEDIA_METADATA,
+        MEDIA_BOOTSTRAP_INFO_ID,
+        MEDIA_BOOTSTRAP_INFO_PROFILE,
+        MEDIA_BOOTSTRAP_INFO_URL,
+        MEDIA_BOOTSTRAP_INFO_DATA,
+        MEDIA_DRM_ADDITIONAL_HEADER_ID,
+        MEDIA_DRM_ADDITIONAL_HEADER_URL,
+        MEDIA_DRM_ADDITIONAL_HEADER_DATA,
+        MEDIA_ALTERNATE,
+        MEDIA_TYPE,
+        MEDIA_LABEL,
+        MEDIA_LANG,
+        MEDIA_GROUPSPEC,
+        MEDIA_MULTICAST_STREAM_NAME,
+        MEDIA_XMP_METADATA,
+        MEDIA_MOOV,
+        MEDIA_DVR_INFO_ID,
+        MEDIA_DVR_INFO_URL,
+        MEDIA_AUDIO_CODEC,
+        MEDIA_VIDEO_CODEC,
+        MEDIA_CUE_INFO_ID,
+        MEDIA_CUE_INFO,
+        MEDIA_BEST_EFFORT_FETCH_INFO_ID,
+        MEDIA_DRM_ADDITIONAL_HEADER_SET_ID,
+        MEDIA_DRM_ADDITIONAL_HEADER_SET,
+        MEDIA_SMPTE_TIMECODES,
+        MEDIA_FIELD_COUNT
+    };
+
+    enum ManifestField {
+        MANIFEST_ID,
+        MANIFEST_DURATION,
+        MANIFEST_START_TIME,
+        MANIFEST_MIME_TYPE,
+        MANIFEST_STREAM_TYPE,
+        MANIFEST_DELIVERY_TYPE,
+        MANIFEST_LABEL,
+        MANIFEST_LANG,
+        MANIFEST_BASE_URL,
+        MANIFEST_PROFILES,
+        MANIFEST_FIELD_COUNT
+    };
+
+    // offsets are relative to the start of the serialized buffer
+    class MediaLayout
+    {
+    public:
+        size_t fields[MEDIA_FIELD_COUNT];
+    };
+
+    class ManifestLayout
+    {
+    public:
+        size_t fields[MANIFEST_FIELD_COUNT];
+        std::vector<size_t> medias; ///< offsets of the media records of the 'implicit' adaptive set
+        std::vector<std::vector<size_t>> adaptiveSets; ///< offsets of the media records of each adaptive set
+    };
+
+    // validate a serialized buffer and locate its records, nothing is copied
+    bool scanManifest(const uint8_t *data, size_t size, ManifestLayout *layout);
+
+    // locate the fields of the media record at 'offset' (as found by scanManifest)
+    bool scanMedia(const uint8_t *data, size_t size, size_t offset, MediaLayout *layout);
+}
+
+#endif // MANIFESTSERIALIZER_H
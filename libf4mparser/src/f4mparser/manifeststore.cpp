@@ -0,0 +1,436 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "manifeststore.h"
+
+#include "binaryio.h"
+#include "mappedfile.h"
+#include "diagline.h"
+
+#include <algorithm> // sort
+#include <cerrno>
+#include <cstdio> // rename, remove
+#include <cstdlib> // mkstemp
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Store layout, all integers little-endian :
+//
+// header : magic "F4MS", u16 format version, u16 reserved, u32 entry count, u32 reserved
+// index  : per entry u64 key hash, u64 key offset, u64 data offset, u32 key size, u32 data size
+//          sorted by key hash then key
+// then the keys and the serialized manifests
+
+static const uint8_t storeMagic[4] = {'F', '4', 'M', 'S'};
+static const uint16_t storeVersion = 1;
+static const size_t storeHeaderSize = 16;
+static const size_t storeIndexEntrySize = 32;
+
+// FNV-1a
+static uint64_t keyHash(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool writeAll(int fd, const uint8_t *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// the directory entry of a renamed file is durable once its directory is synced
+static bool syncDirectory(const std::string &path)
+{
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+// ByteRange
+
+bool ByteRange::equals(const char *str) const
+{
+    size_t len = strlen(str);
+    return len == m_size && (len == 0 || memcmp(m_data, str, len) == 0);
+}
+
+// MediaView
+
+MediaView::MediaView()
+    : m_data(nullptr), m_size(0)
+{
+}
+
+ByteRange MediaView::bytes(ManifestSerializer::MediaField field) const
+{
+    if (!m_data) {
+        return ByteRange();
+    }
+    BinaryReader r(m_data, m_size);
+    r.seek(m_layout.fields[field]);
+    size_t len;
+    const uint8_t *ptr = r.readBytes(&len);
+    return ByteRange(ptr, len);
+}
+
+int MediaView::integer(ManifestSerializer::MediaField field) const
+{
+    if (!m_data) {
+        return -1;
+    }
+    BinaryReader r(m_data, m_size);
+    r.seek(m_layout.fields[field]);
+    return r.readI32();
+}
+
+bool MediaView::alternate() const
+{
+    if (!m_data) {
+        return false;
+    }
+    BinaryReader r(m_data, m_size);
+    r.seek(m_layout.fields[ManifestSerializer::MEDIA_ALTERNATE]);
+    return r.readU8() != 0;
+}
+
+// ManifestView
+
+ManifestView::ManifestView()
+    : m_data(nullptr), m_size(0)
+{
+}
+
+ManifestView::ManifestView(const uint8_t *data, size_t size)
+    : m_data(nullptr), m_size(0)
+{
+    if (ManifestSerializer::scanManifest(data, size, &m_layout)) {
+        m_data = data;
+        m_size = size;
+    } else {
+        F4M_DIAG(DIAG_WARNING) << "malformed serialized manifest";
+        m_layout = ManifestSerializer::ManifestLayout();
+    }
+}
+
+ByteRange ManifestView::bytes(ManifestSerializer::ManifestField field) const
+{
+    if (!m_data) {
+        return ByteRange();
+    }
+    BinaryReader r(m_data, m_size);
+    r.seek(m_layout.fields[field]);
+    size_t len;
+    const uint8_t *ptr = r.readBytes(&len);
+    return ByteRange(ptr, len);
+}
+
+double ManifestView::duration() const
+{
+    if (!m_data) {
+        return -1.;
+    }
+    BinaryReader r(m_data, m_size);
+    r.seek(m_layout.fields[ManifestSerializer::MANIFEST_DURATION]);
+    return r.readDouble();
+}
+
+MediaView ManifestView::mediaAt(size_t offset) const
+{
+    MediaView view;
+    if (ManifestSerializer::scanMedia(m_data, m_size, offset, &view.m_layout)) {
+        view.m_data = m_data;
+        view.m_size = m_size;
+    }
+    return view;
+}
+
+MediaView ManifestView::media(size_t index) const
+{
+    if (index >= m_layout.medias.size()) {
+        return MediaView();
+    }
+    return mediaAt(m_layout.medias[index]);
+}
+
+size_t ManifestView::adaptiveSetMediaCount(size_t set) const
+{
+    if (set >= m_layout.adaptiveSets.size()) {
+        return 0;
+    }
+    return m_layout.adaptiveSets[set].size();
+}
+
+MediaView ManifestView::adaptiveSetMedia(size_t set, size_t index) const
+{
+    if (index >= adaptiveSetMediaCount(set)) {
+        return MediaView();
+    }
+    return mediaAt(m_layout.adaptiveSets[set][index]);
+}
+
+bool ManifestView::toManifest(Manifest *manifest) const
+{
+    return m_data && ManifestSerializer::deserialize(m_data, m_size, manifest);
+}
+
+// ManifestStoreWriter
+
+void ManifestStoreWriter::add(const std::string &key, const Manifest &manifest)
+{
+    m_entries.emplace_back(key, ManifestSerializer::serialize(manifest));
+}
+
+void ManifestStoreWriter::add(const std::string &key, std::vector<uint8_t> serializedManifest)
+{
+    m_entries.emplace_back(key, std::move(serializedManifest));
+}
+
+bool ManifestStoreWriter::write(const std::string &path) const
+{
+    // sort by hash, the reader use a binary search on it
+    std::vector<std::pair<uint64_t, size_t>> order;
+    order.reserve(m_entries.size());
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        const std::string &key = m_entries[i].first;
+        order.emplace_back(keyHash(reinterpret_cast<const uint8_t *>(key.data()), key.size()), i);
+    }
+    std::sort(begin(order), end(order),
+              [&](const std::pair<uint64_t, size_t> &a, const std::pair<uint64_t, size_t> &b) {
+        if (a.first != b.first) {
+            return a.first < b.first;
+        }
+        return m_entries[a.second].first < m_entries[b.second].first;
+    });
+
+    std::vector<uint8_t> out;
+    BinaryWriter w(&out);
+
+    for (size_t i = 0; i < sizeof(storeMagic); ++i) {
+        w.writeU8(storeMagic[i]);
+    }
+    w.writeU16(storeVersion);
+    w.writeU16(0);
+    w.writeU32(static_cast<uint32_t>(m_entries.size()));
+    w.writeU32(0);
+
+    uint64_t offset = storeHeaderSize + storeIndexEntrySize * m_entries.size();
+    for (const auto &o : order) {
+        const auto &entry = m_entries[o.second];
+        w.writeU64(o.first);
+        w.writeU64(offset);
+        w.writeU64(offset + entry.first.size());
+        w.writeU32(static_cast<uint32_t>(entry.first.size()));
+        w.writeU32(static_cast<uint32_t>(entry.second.size()));
+        offset += entry.first.size() + entry.second.size();
+    }
+    for (const auto &o : order) {
+        const auto &entry = m_entries[o.second];
+        out.insert(out.end(), entry.first.begin(), entry.first.end());
+        out.insert(out.end(), entry.second.begin(), entry.second.end());
+    }
+
+    // a unique name : concurrent writers of the same store don't share their temporary file
+    std::string tmpPath = path + ".XXXXXX";
+    int fd = ::mkstemp(&tmpPath[0]);
+    if (fd < 0) {
+        F4M_DIAG(DIAG_WARNING) << "can't create a temporary file for " << path;
+        return false;
+    }
+    // synced before the rename : a crash never leaves a truncated store under 'path'
+    bool written = ::fchmod(fd, 0644) == 0 && writeAll(fd, out.data(), out.size()) && ::fsync(fd) == 0;
+    if (::close(fd) != 0) {
+        written = false;
+    }
+    if (!written) {
+        F4M_DIAG(DIAG_WARNING) << "write failed for " << tmpPath;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        F4M_DIAG(DIAG_WARNING) << "rename failed for " << path;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    if (!syncDirectory(path)) {
+        F4M_DIAG(DIAG_WARNING) << "can't sync the directory of " << path;
+        return false;
+    }
+
+    return true;
+}
+
+// ManifestStore
+
+ManifestStore::ManifestStore()
+    : m_file(new MappedFile), m_entryCount(0)
+{
+}
+
+ManifestStore::~ManifestStore()
+{
+}
+
+bool ManifestStore::open(const std::string &path)
+{
+    close();
+
+    if (!m_file->open(path)) {
+        return false;
+    }
+
+    const uint8_t *data = m_file->data();
+    size_t size = m_file->size();
+
+    if (size < storeHeaderSize || memcmp(data, storeMagic, sizeof(storeMagic)) != 0) {
+        F4M_DIAG(DIAG_WARNING) << "not a manifest store " << path;
+        close();
+        return false;
+    }
+
+    BinaryReader r(data, size);
+    r.skip(sizeof(storeMagic));
+    if (r.readU16() != storeVersion) {
+        F4M_DIAG(DIAG_WARNING) << "unsupported store version " << path;
+        close();
+        return false;
+    }
+    r.readU16();
+    uint32_t entryCount = r.readU32();
+    if (entryCount > (size - storeHeaderSize) / storeIndexEntrySize) {
+        F4M_DIAG(DIAG_WARNING) << "truncated store " << path;
+        close();
+        return false;
+    }
+
+    // check every entry points inside the file, once
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        r.seek(storeHeaderSize + i * storeIndexEntrySize + 8);
+        uint64_t keyOffset = r.readU64();
+        uint64_t dataOffset = r.readU64();
+        uint32_t keySize = r.readU32();
+        uint32_t dataSize = r.readU32();
+        if (keyOffset > size || keySize > size - keyOffset
+                || dataOffset > size || dataSize > size - dataOffset) {
+            F4M_DIAG(DIAG_WARNING) << "corrupted store index " << path;
+            close();
+            return false;
+        }
+    }
+
+    m_entryCount = entryCount;
+
+    return true;
+}
+
+void ManifestStore::close()
+{
+    m_file->close();
+    m_entryCount = 0;
+}
+
+bool ManifestStore::isOpen() const
+{
+    return m_file->isOpen();
+}
+
+ByteRange ManifestStore::key(size_t index) const
+{
+    if (index >= m_entryCount) {
+        return ByteRange();
+    }
+    BinaryReader r(m_file->data(), m_file->size());
+    r.seek(storeHeaderSize + index * storeIndexEntrySize + 8);
+    uint64_t keyOffset = r.readU64();
+    r.readU64();
+    uint32_t keySize = r.readU32();
+    return ByteRange(m_file->data() + keyOffset, keySize);
+}
+
+ManifestView ManifestStore::entry(size_t index) const
+{
+    if (index >= m_entryCount) {
+        return ManifestView();
+    }
+    BinaryReader r(m_file->data(), m_file->size());
+    r.seek(storeHeaderSize + index * storeIndexEntrySize + 16);
+    uint64_t dataOffset = r.readU64();
+    r.readU32();
+    uint32_t dataSize = r.readU32();
+    return ManifestView(m_file->data() + dataOffset, dataSize);
+}
+
+ManifestView ManifestStore::find(const std::string &key) const
+{
+    uint64_t hash = keyHash(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+
+    BinaryReader r(m_file->data(), m_file->size());
+    auto hashAt = [&](size_t index) {
+        r.seek(storeHeaderSize + index * storeIndexEntrySize);
+        return r.readU64();
+    };
+
+    // lower bound on the hash
+    size_t first = 0;
+    size_t count = m_entryCount;
+    while (count > 0) {
+        size_t step = count / 2;
+        if (hashAt(first + step) < hash) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    for (size_t i = first; i < m_entryCount && hashAt(i) == hash; ++i) {
+        ByteRange k = this->key(i);
+        if (k.size() == key.size() && memcmp(k.data(), key.data(), key.size()) == 0) {
+            return entry(i);
+        }
+    }
+
+    return ManifestView();
+}
@@ -0,0 +1,191 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file manifeststore.h
+ *  \brief Disk-backed store of serialized manifests, shared read-only between processes.
+ *
+ *  A store file is written once by ManifestStoreWriter and mapped by any number of
+ *  ManifestStore readers. The views returned by a ManifestStore read directly
+ *  from the mapping : strings and blobs are handed out as ByteRange, nothing is copied.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef MANIFESTSTORE_H
+#define MANIFESTSTORE_H
+
+#include "manifest.h"
+#include "manifestserializer.h"
+
+#include <memory>
+
+class MappedFile;
+
+#pragma GCC visibility push(default)
+
+/*! \brief A range of bytes inside a store mapping. Valid as long as the store is open.
+ */
+class ByteRange
+{
+public:
+    ByteRange() : m_data{nullptr}, m_size{0} {}
+    ByteRange(const uint8_t *data, size_t size) : m_data{data}, m_size{size} {}
+
+    const uint8_t* data() const { return m_data; }
+    size_t         size() const { return m_size; }
+    bool           empty() const { return m_size == 0; }
+
+    const char*    chars() const { return reinterpret_cast<const char *>(m_data); }
+    std::string    str() const { return std::string(chars(), m_size); } ///< copy as a string
+    bool           equals(const char *str) const;
+
+private:
+    const uint8_t *m_data;
+    size_t m_size;
+};
+
+/*! \brief Zero-copy view of a serialized media.
+ */
+class MediaView
+{
+public:
+    MediaView();
+
+    bool       valid() const { return m_data != nullptr; }
+
+    ByteRange  bitrate() const { return bytes(ManifestSerializer::MEDIA_BITRATE); }
+    int        width() const { return integer(ManifestSerializer::MEDIA_WIDTH); }
+    int        height() const { return integer(ManifestSerializer::MEDIA_HEIGHT); }
+    ByteRange  streamId() const { return bytes(ManifestSerializer::MEDIA_STREAM_ID); }
+    ByteRange  url() const { return bytes(ManifestSerializer::MEDIA_URL); }
+    ByteRange  href() const { return bytes(ManifestSerializer::MEDIA_HREF); }
+    ByteRange  metadata() const { return bytes(ManifestSerializer::MEDIA_METADATA); }
+    ByteRange  bootstrapInfoProfile() const { return bytes(ManifestSerializer::MEDIA_BOOTSTRAP_INFO_PROFILE); }
+    ByteRange  bootstrapInfoUrl() const { return bytes(ManifestSerializer::MEDIA_BOOTSTRAP_INFO_URL); }
+    ByteRange  bootstrapInfoData() const { return bytes(ManifestSerializer::MEDIA_BOOTSTRAP_INFO_DATA); }
+    ByteRange  drmAdditionalHeaderUrl() const { return bytes(ManifestSerializer::MEDIA_DRM_ADDITIONAL_HEADER_URL); }
+    ByteRange  drmAdditionalHeaderData() const { return bytes(ManifestSerializer::MEDIA_DRM_ADDITIONAL_HEADER_DATA); }
+    bool       alternate() const;
+    ByteRange  type() const { return bytes(ManifestSerializer::MEDIA_TYPE); }
+    ByteRange  label() const { return bytes(ManifestSerializer::MEDIA_LABEL); }
+    ByteRange  lang() const { return bytes(ManifestSerializer::MEDIA_LANG); }
+    ByteRange  xmpMetadata() const { return bytes(ManifestSerializer::MEDIA_XMP_METADATA); }
+    ByteRange  moov() const { return bytes(ManifestSerializer::MEDIA_MOOV); }
+    ByteRange  dvrInfoUrl() const { return bytes(ManifestSerializer::MEDIA_DVR_INFO_URL); }
+    ByteRange  audioCodec() const { return bytes(ManifestSerializer::MEDIA_AUDIO_CODEC); }
+    ByteRange  videoCodec() const { return bytes(ManifestSerializer::MEDIA_VIDEO_CODEC); }
+
+private:
+    friend class ManifestView;
+
+    ByteRange  bytes(ManifestSerializer::MediaField field) const;
+    int        integer(ManifestSerializer::MediaField field) const;
+
+    const uint8_t *m_data;
+    size_t m_size;
+    ManifestSerializer::MediaLayout m_layout;
+};
+
+/*! \brief Zero-copy view of a serialized manifest.
+ *
+ * Only the offsets of the media records are computed when the view is created.
+ */
+class ManifestView
+{
+public:
+    ManifestView();
+    ManifestView(const uint8_t *data, size_t size);
+
+    bool       valid() const { return m_data != nullptr; }
+
+    ByteRange  id() const { return bytes(ManifestSerializer::MANIFEST_ID); }
+    double     duration() const;
+    ByteRange  streamType() const { return bytes(ManifestSerializer::MANIFEST_STREAM_TYPE); }
+    ByteRange  deliveryType() const { return bytes(ManifestSerializer::MANIFEST_DELIVERY_TYPE); }
+    ByteRange  baseURL() const { return bytes(ManifestSerializer::MANIFEST_BASE_URL); }
+
+    size_t     mediaCount() const { return m_layout.medias.size(); }
+    MediaView  media(size_t index) const;
+
+    size_t     adaptiveSetCount() const { return m_layout.adaptiveSets.size(); }
+    size_t     adaptiveSetMediaCount(size_t set) const;
+    MediaView  adaptiveSetMedia(size_t set, size_t index) const;
+
+    ByteRange  serialized() const { return ByteRange(m_data, m_size); }
+    bool       toManifest(Manifest *manifest) const; ///< full copy of the entry
+
+private:
+    ByteRange  bytes(ManifestSerializer::ManifestField field) const;
+    MediaView  mediaAt(size_t offset) const;
+
+    const uint8_t *m_data;
+    size_t m_size;
+    ManifestSerializer::ManifestLayout m_layout;
+};
+
+/*! \brief Build a store file from a set of manifests.
+ *
+ * The file is written under a unique name next to its destination, synced, then
+ * renamed. Processes which have the previous version mapped keep reading it until
+ * they reopen the store. When several writers replace the same store, the last
+ * rename wins.
+ */
+class ManifestStoreWriter
+{
+public:
+    void add(const std::string &key, const Manifest &manifest);
+    void add(const std::string &key, std::vector<uint8_t> serializedManifest);
+    bool write(const std::string &path) const;
+
+private:
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> m_entries;
+};
+
+/*! \brief Read-only mapping of a store file.
+ */
+class ManifestStore
+{
+public:
+    ManifestStore();
+    ~ManifestStore();
+
+    bool         open(const std::string &path);
+    void         close();
+    bool         isOpen() const;
+
+    size_t       size() const { return m_entryCount; }
+    ByteRange    key(size_t index) const;
+    ManifestView entry(size_t index) const;
+    ManifestView find(const std::string &key) const; ///< invalid view if the key is not in the store
+
+private:
+    ManifestStore(const ManifestStore &) = delete;
+    ManifestStore& operator=(const ManifestStore &) = delete;
+
+    std::unique_ptr<MappedFile> m_file;
+    size_t m_entryCount;
+};
+
+#pragma GCC visibility pop
+
+#endif // MANIFESTSTORE_H
@@ -0,0 +1,107 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file manifestvisitor.h
+ *  \brief Callbacks to read a f4m document element by element, without building a Manifest.
+ *
+ *  The children of <manifest> are reported in document order, each one as soon as it is
+ *  parsed and released after the callback : only the element being visited is kept in memory,
+ *  on top of the xml document itself.
+ *
+ *  An element is reported once its attributes are read, before its content. Returning VISIT
+ *  parses the content : base64 blobs are decoded and reported by the matching ...Data
+ *  callback, child elements get their own callbacks. SKIP goes on with the next element,
+ *  STOP ends the walk.
+ *
+ *  Nothing is resolved between elements : a media gives the ids of its bootstrapInfo,
+ *  drmAdditionalHeader... as they are written. The stream-level manifests of a multi-level
+ *  manifest are not fetched, their medias are reported with their href.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef MANIFESTVISITOR_H
+#define MANIFESTVISITOR_H
+
+#include "manifest.h"
+
+#pragma GCC visibility push(default)
+
+/*! \brief Receives the elements of a manifest, override the callbacks of interest.
+ *
+ * By default every element is visited, except that no base64 blob is decoded :
+ * onMedia, onBootstrapInfo and onDrmAdditionalHeader return SKIP.
+ */
+class ManifestVisitor
+{
+public:
+    enum Action {
+        VISIT, ///< parse the content of the element
+        SKIP, ///< go on with the next element, the content is not parsed
+        STOP ///< end the walk
+    };
+
+    virtual ~ManifestVisitor() {}
+
+    /*! \brief The elements of <manifest> which are not sections, and the profiles.
+     *
+     * 'header' has no media, baseURL is set to the url relative urls are resolved against.
+     * Only VISIT goes on with the sections.
+     */
+    virtual Action onManifestHeader(const Manifest & /*header*/) { return VISIT; }
+
+    /*! \brief A <media>, 'set' is -1 for the medias of <manifest>, else the position of its
+     * <adaptiveSet>. The attributes of the adaptive set are already applied.
+     */
+    virtual Action onMedia(const Media & /*media*/, int /*set*/) { return SKIP; }
+    virtual Action onMediaData(const Media & /*media*/, int /*set*/) { return VISIT; } ///< with metadata, xmpMetadata and moov
+
+    virtual Action onAdaptiveSet(int /*set*/) { return VISIT; } ///< F4M 3.0
+
+    virtual Action onBootstrapInfo(const BootstrapInfo & /*bootstrapInfo*/) { return SKIP; }
+    virtual Action onBootstrapInfoData(const BootstrapInfo & /*bootstrapInfo*/) { return VISIT; } ///< with data unless it has an url
+
+    virtual Action onDvrInfo(const DvrInfo & /*dvrInfo*/) { return VISIT; }
+
+    /*! \brief A <drmAdditionalHeader>, 'setId' is the id of its <drmAdditionalHeaderSet>,
+     * empty for the headers of <manifest>.
+     */
+    virtual Action onDrmAdditionalHeader(const DrmAdditionalHeader & /*header*/,
+                                         const std::string & /*setId*/) { return SKIP; }
+    virtual Action onDrmAdditionalHeaderData(const DrmAdditionalHeader & /*header*/,
+                                             const std::string & /*setId*/) { return VISIT; } ///< with data unless it has an url
+
+    virtual Action onDrmAdditionalHeaderSet(const std::string & /*id*/) { return VISIT; } ///< F4M 3.0
+
+    virtual Action onCueInfo(const std::string & /*id*/) { return VISIT; } ///< F4M 3.0
+    virtual Action onCue(const Cue & /*cue*/, const std::string & /*cueInfoId*/) { return VISIT; } ///< in document order, F4M 3.0
+
+    virtual Action onSmpteTimecodes() { return VISIT; } ///< F4M 3.0
+    virtual Action onSmpteTimecode(const SmpteTimecode & /*smpteTimecode*/) { return VISIT; } ///< in document order, F4M 3.0
+
+    virtual Action onBestEffortFetchInfo(const BestEffortFetchInfo & /*bestEffortFetchInfo*/) { return VISIT; } ///< F4M 3.0
+};
+
+#pragma GCC visibility pop
+
+#endif // MANIFESTVISITOR_H
@@ -0,0 +1,127 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "numberutils.h"
+
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+
+namespace
+{
+    bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    const char* skipSpaces(const char *str)
+    {
+        while (isspace(static_cast<unsigned char>(*str))) {
+            ++str;
+        }
+        return str;
+    }
+
+    // powers of ten exactly representable as a double
+    const double s_exactPowersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const uint64_t s_maxExactMantissa = uint64_t(1) << 53;
+}
+
+bool NumberUtils::parseInt(const char *str, int *value)
+{
+    const char *p = skipSpaces(str);
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-';
+        ++p;
+    }
+    if (!isDigit(*p)) {
+        return false;
+    }
+
+    // accumulate as a negative number, INT_MIN has no positive counterpart
+    long long result = 0;
+    for (; isDigit(*p); ++p) {
+        result = result * 10 - (*p - '0');
+        if (result < INT_MIN) {
+            return false;
+        }
+    }
+    if (!negative) {
+        if (result < -INT_MAX) {
+            return false;
+        }
+        result = -result;
+    }
+    *value = static_cast<int>(result);
+    return true;
+}
+
+// Decimal numbers with at most 15 digits and no exponent, which is what a manifest holds,
+// are converted exactly with a single division. Anything else goes through strtod.
+bool NumberUtils::parseDouble(const char *str, double *value)
+{
+    const char *p = skipSpaces(str);
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-';
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int fractionDigits = 0;
+    for (; isDigit(*p); ++p, ++digits) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+    }
+    if (*p == '.') {
+        for (++p; isDigit(*p); ++p, ++digits, ++fractionDigits) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        }
+    }
+
+    bool fastPath = digits > 0 && digits <= 15 && mantissa < s_maxExactMantissa
+            && *p != 'e' && *p != 'E' && *p != 'x' && *p != 'X';
+    if (fastPath) {
+        double result = static_cast<double>(mantissa) / s_exactPowersOfTen[fractionDigits];
+        *value = negative ? -result : result;
+        return true;
+    }
+
+    char *end = nullptr;
+    int savedErrno = errno;
+    errno = 0;
+    double result = strtod(str, &end);
+    bool ok = end != str && errno != ERANGE;
+    errno = savedErrno;
+    if (ok) {
+        *value = result;
+    }
+    return ok;
+}
@@ -0,0 +1,39 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#ifndef NUMBERUTILS_H
+#define NUMBERUTILS_H
+
+// Parse numbers in place, without allocation nor exception.
+// Both accept what std::stoi / std::stod accept : leading white spaces, a sign, and trailing
+// characters after the number are ignored. They return false when there is no number or
+// when it is out of range, 'value' is then left untouched.
+
+namespace NumberUtils
+{
+    bool parseInt(const char *str, int *value);
+
+    bool parseDouble(const char *str, double *value);
+}
+
+#endif // NUMBERUTILS_H
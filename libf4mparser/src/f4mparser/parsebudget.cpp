@@ -0,0 +1,70 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "parsebudget.h"
+
+#include "diagline.h"
+
+static const char* limitName(ParseOptions::Error error)
+{
+    switch (error) {
+    case ParseOptions::ERROR_DOCUMENT_TOO_LARGE:
+        return "maxDocumentBytes";
+    case ParseOptions::ERROR_TOO_MANY_NODES:
+        return "maxNodes";
+    case ParseOptions::ERROR_DECODED_DATA_TOO_LARGE:
+        return "maxDecodedBytes";
+    case ParseOptions::ERROR_TOO_MANY_SUB_REQUESTS:
+        return "maxSubRequests";
+    case ParseOptions::ERROR_DEADLINE_EXCEEDED:
+        return "deadlineMs";
+    default:
+        return "";
+    }
+}
+
+void ParseBudget::start(const ParseLimits &limits)
+{
+    *this = ParseBudget();
+    m_limits = limits;
+    m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.deadlineMs);
+}
+
+uint32_t ParseBudget::remainingMs() const
+{
+    if (m_limits.deadlineMs == 0) {
+        return 0;
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                m_deadline - std::chrono::steady_clock::now()).count();
+    return remaining > 0 ? static_cast<uint32_t>(remaining) : 1;
+}
+
+bool ParseBudget::fail(ParseOptions::Error error)
+{
+    if (!exceeded()) {
+        m_error = error;
+        F4M_DIAG(DIAG_WARNING) << "parse aborted, " << limitName(error) << " exceeded";
+    }
+    return false;
+}
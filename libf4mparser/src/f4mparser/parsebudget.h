@@ -0,0 +1,109 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#ifndef PARSEBUDGET_H
+#define PARSEBUDGET_H
+
+#include "parseoptions.h"
+
+#include <chrono>
+
+// the resources consumed by one parse against its ParseLimits, each add* returns
+// false once any limit is exceeded. With the default limits it only compares counters
+
+class ParseBudget
+{
+public:
+    ParseBudget() : m_error(ParseOptions::ERROR_NONE), m_documentBytes(0), m_nodes(0),
+        m_nodesAtDeadlineCheck(0), m_decodedBytes(0), m_subRequests(0) {}
+
+    // the counters of the previous parse are cleared, the deadline starts now
+    void start(const ParseLimits &limits);
+
+    bool exceeded() const { return m_error != ParseOptions::ERROR_NONE; }
+    ParseOptions::Error error() const { return m_error; }
+    bool limitsDecodedBytes() const { return m_limits.maxDecodedBytes != 0; }
+
+    bool addDocument(uint64_t bytes) {
+        m_documentBytes += bytes;
+        if (m_limits.maxDocumentBytes && m_documentBytes > m_limits.maxDocumentBytes) {
+            return fail(ParseOptions::ERROR_DOCUMENT_TOO_LARGE);
+        }
+        return checkDeadline();
+    }
+
+    // the clock is read every deadlineCheckNodes nodes
+    bool addNodes(uint64_t count) {
+        m_nodes += count;
+        if (m_limits.maxNodes && m_nodes > m_limits.maxNodes) {
+            return fail(ParseOptions::ERROR_TOO_MANY_NODES);
+        }
+        if (m_nodes - m_nodesAtDeadlineCheck >= deadlineCheckNodes) {
+            m_nodesAtDeadlineCheck = m_nodes;
+            return checkDeadline();
+        }
+        return !exceeded();
+    }
+
+    bool addDecoded(uint64_t bytes) {
+        m_decodedBytes += bytes;
+        if (m_limits.maxDecodedBytes && m_decodedBytes > m_limits.maxDecodedBytes) {
+            return fail(ParseOptions::ERROR_DECODED_DATA_TOO_LARGE);
+        }
+        return !exceeded();
+    }
+
+    bool addSubRequest() {
+        m_subRequests++;
+        if (m_limits.maxSubRequests && m_subRequests > m_limits.maxSubRequests) {
+            return fail(ParseOptions::ERROR_TOO_MANY_SUB_REQUESTS);
+        }
+        return checkDeadline();
+    }
+
+    // 0 when there is no deadline, at least 1 when there is one
+    uint32_t remainingMs() const;
+
+    bool checkDeadline() {
+        if (m_limits.deadlineMs && !exceeded() && std::chrono::steady_clock::now() > m_deadline) {
+            return fail(ParseOptions::ERROR_DEADLINE_EXCEEDED);
+        }
+        return !exceeded();
+    }
+
+private:
+    static const uint64_t deadlineCheckNodes = 64;
+
+    bool fail(ParseOptions::Error error);
+
+    ParseLimits m_limits;
+    ParseOptions::Error m_error; // the first limit exceeded
+    std::chrono::steady_clock::time_point m_deadline;
+    uint64_t m_documentBytes;
+    uint64_t m_nodes;
+    uint64_t m_nodesAtDeadlineCheck;
+    uint64_t m_decodedBytes;
+    uint32_t m_subRequests;
+};
+
+#endif // PARSEBUDGET_H
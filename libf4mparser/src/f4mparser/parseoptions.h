@@ -0,0 +1,133 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file parseoptions.h
+ *  \brief Optional settings of a parse.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef PARSEOPTIONS_H
+#define PARSEOPTIONS_H
+
+#include "parsestats.h"
+#include "parsetracer.h"
+#include "downloader.h"
+
+#pragma GCC visibility push(default)
+
+/*! \brief Upper bounds on the resources of one parse, 0 means unbounded.
+ *
+ * They are checked while parsing, the first one exceeded aborts the parse which then
+ * fails with the matching ParseOptions::Error. The limits apply to the documents
+ * returned by the download function : the manifest and its stream-level manifests.
+ */
+class ParseLimits
+{
+public:
+    ParseLimits() : maxDocumentBytes{0}, maxNodes{0}, maxDecodedBytes{0}, maxSubRequests{0},
+        deadlineMs{0} {}
+
+    uint64_t maxDocumentBytes; ///< cumulated size of the downloaded documents, checked before building their xml tree
+    uint64_t maxNodes; ///< xml elements examined
+    uint64_t maxDecodedBytes; ///< raw bytes of the base64 data, checked before decoding it
+    uint32_t maxSubRequests; ///< downloads of stream-level manifests
+    uint32_t deadlineMs; ///< wall-clock time allowed from the start of the parse, the download function itself is not interrupted
+};
+
+/*! \brief How failed or slow downloads are tried again.
+ *
+ * A download is retried when it failed without an http status, or with 408, 429 or 5xx.
+ * The delay before retry n is backoffMs * 2^n, capped to maxBackoffMs, with a random
+ * jitter of -50%..+50%. No retry is made past ParseLimits::deadlineMs.
+ *
+ * Hedging is done by the Downloader, see DownloadRequest::hedgeAfterMs.
+ */
+class RetryPolicy
+{
+public:
+    RetryPolicy() : maxRetries{0}, backoffMs{100}, maxBackoffMs{2000}, hedgeAfterMs{0},
+        hedgePercentile{0}, latencies{nullptr} {}
+
+    unsigned maxRetries; ///< per download, 0 to never retry
+    uint32_t backoffMs; ///< delay before the first retry
+    uint32_t maxBackoffMs;
+    /*! \brief hedge the downloads unanswered after this delay, 0 to never hedge.
+     *
+     * Only a Downloader issuing concurrent requests hedges, as the example CurlMultiDownloader.
+     * The parses given a DOWNLOAD_FILE_FUNCTION ignore it and report it with a DIAG_WARNING.
+     */
+    uint32_t hedgeAfterMs;
+    double hedgePercentile; ///< when not 0, hedge at this percentile of 'latencies' instead, once it holds 16 durations
+    DownloadLatencies *latencies; ///< fed with the duration of every download when not NULL, not owned
+};
+
+/*! \brief Settings for F4mParseManifest, the default values give the plain parse.
+ *
+ * The pointed objects are not owned and must outlive the parse.
+ */
+class ParseOptions
+{
+public:
+    /*! \brief Parts of the manifest which are not needed, they are neither downloaded nor
+     * decoded and keep their default value in the result.
+     */
+    enum Skip {
+        SKIP_MEDIA_METADATA = 1 << 0, ///< Media::metadata, xmpMetadata and moov
+        SKIP_BOOTSTRAP_INFOS = 1 << 1,
+        SKIP_DRM_ADDITIONAL_HEADERS = 1 << 2,
+        SKIP_DRM_ADDITIONAL_HEADER_SETS = 1 << 3,
+        SKIP_DVR_INFOS = 1 << 4,
+        SKIP_CUE_INFOS = 1 << 5,
+        SKIP_SMPTE_TIMECODES = 1 << 6,
+        SKIP_BEST_EFFORT_FETCH_INFOS = 1 << 7,
+        SKIP_ADAPTIVE_SETS = 1 << 8, ///< the medias of the explicit adaptive sets
+        SKIP_STREAM_MANIFESTS = 1 << 9, ///< the stream-level manifests of a multi-level manifest, the medias keep their href
+        SKIP_ALL_BUT_MEDIAS = (1 << 10) - 1 ///< only the attributes of the medias of <manifest> are read
+    };
+
+    /*! \brief Why a parse failed.
+     */
+    enum Error {
+        ERROR_NONE,
+        ERROR_FAILED, ///< download, xml or manifest failure, the diagnostics tell which
+        ERROR_DOCUMENT_TOO_LARGE, ///< ParseLimits::maxDocumentBytes exceeded
+        ERROR_TOO_MANY_NODES, ///< ParseLimits::maxNodes exceeded
+        ERROR_DECODED_DATA_TOO_LARGE, ///< ParseLimits::maxDecodedBytes exceeded
+        ERROR_TOO_MANY_SUB_REQUESTS, ///< ParseLimits::maxSubRequests exceeded
+        ERROR_DEADLINE_EXCEEDED ///< ParseLimits::deadlineMs exceeded
+    };
+
+    ParseOptions() : stats{nullptr}, tracer{nullptr}, skip{0}, error{nullptr} {}
+
+    ParseStats *stats; ///< reset then filled during the parse, or NULL
+    ParseTracer *tracer; ///< receives the spans of the parse, or NULL
+    unsigned skip; ///< Skip values or-ed, 0 to parse everything
+    ParseLimits limits; ///< unbounded by default
+    RetryPolicy retry; ///< no retry nor hedging by default
+    Error *error; ///< set to the outcome of the parse, or NULL
+};
+
+#pragma GCC visibility pop
+
+#endif // PARSEOPTIONS_H
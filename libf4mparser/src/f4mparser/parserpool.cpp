@@ -0,0 +1,129 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "parserpool.h"
+
+#include "manifestparser.h"
+
+#include <algorithm>
+#include <thread>
+
+// a parser taken from the pool for the scope
+
+class ParserLease
+{
+public:
+    ParserLease(ParserPool *pool, Downloader *downloader)
+        : m_pool(pool), m_parser(pool->acquire(downloader)) {}
+    ~ParserLease() { m_pool->release(std::move(m_parser)); }
+
+    ManifestParser* operator->() { return m_parser.get(); }
+
+private:
+    ParserLease(const ParserLease &) = delete;
+    ParserLease& operator=(const ParserLease &) = delete;
+
+    ParserPool *m_pool;
+    std::unique_ptr<ManifestParser> m_parser;
+};
+
+ParserPool::ParserPool(size_t maxIdle)
+{
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    if (maxIdle == 0) {
+        maxIdle = threads;
+    }
+    m_freeListCount = std::min(maxIdle, threads);
+    m_maxIdle = (maxIdle + m_freeListCount - 1) / m_freeListCount;
+    m_freeLists.reset(new FreeList[m_freeListCount]);
+}
+
+ParserPool::~ParserPool()
+{
+}
+
+bool ParserPool::parse(Downloader *downloader, const std::string &url, Manifest *manifest,
+                       const ParseOptions &options)
+{
+    ParserLease parser(this, downloader);
+    return parser->parse(url, manifest, options);
+}
+
+bool ParserPool::parseBuffer(Downloader *downloader, const uint8_t *data, size_t size,
+                             const std::string &url, Manifest *manifest, const ParseOptions &options)
+{
+    ParserLease parser(this, downloader);
+    return parser->parseBuffer(data, size, url, manifest, options);
+}
+
+bool ParserPool::refresh(Downloader *downloader, const std::string &url, const Manifest &previous,
+                         Manifest *manifest, ManifestChangeSet *changes, const ParseOptions &options)
+{
+    ParserLease parser(this, downloader);
+    return parser->refresh(url, previous, manifest, changes, options);
+}
+
+size_t ParserPool::idleParsers() const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < m_freeListCount; i++) {
+        std::lock_guard<std::mutex> lock(m_freeLists[i].mutex);
+        count += m_freeLists[i].idle.size();
+    }
+    return count;
+}
+
+size_t ParserPool::freeListOfThread() const
+{
+    return std::hash<std::thread::id>()(std::this_thread::get_id()) % m_freeListCount;
+}
+
+// a lock is only held to take or give back a parser, never during a parse
+std::unique_ptr<ManifestParser> ParserPool::acquire(Downloader *downloader)
+{
+    std::unique_ptr<ManifestParser> parser;
+    size_t own = freeListOfThread();
+    for (size_t i = 0; i < m_freeListCount && !parser; i++) {
+        FreeList &freeList = m_freeLists[(own + i) % m_freeListCount];
+        std::lock_guard<std::mutex> lock(freeList.mutex);
+        if (!freeList.idle.empty()) {
+            parser = std::move(freeList.idle.back());
+            freeList.idle.pop_back();
+        }
+    }
+    if (!parser) {
+        parser.reset(new ManifestParser(downloader));
+    }
+    parser->setDownloader(downloader);
+    return parser;
+}
+
+void ParserPool::release(std::unique_ptr<ManifestParser> parser)
+{
+    parser->setDownloader(nullptr);
+    FreeList &freeList = m_freeLists[freeListOfThread()];
+    std::lock_guard<std::mutex> lock(freeList.mutex);
+    if (freeList.idle.size() < m_maxIdle) {
+        freeList.idle.push_back(std::move(parser));
+    }
+}
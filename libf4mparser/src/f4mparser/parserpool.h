@@ -0,0 +1,116 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file parserpool.h
+ *  \brief Keeps parsers between parses, for applications parsing many manifests.
+ *
+ *  A parse with the F4mParseManifest functions builds a parser and throws it away.
+ *  A ParserPool keeps the idle parsers instead, so a parse takes an already built parser :
+ *  the one its thread released last when there is one. The parser keeps its document
+ *  object and, for the documents given by pointer, the capacity of its raw buffer. The
+ *  pages of the xml tree are freed on every parse, a downloaded document is not kept.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef PARSERPOOL_H
+#define PARSERPOOL_H
+
+#include "manifest.h"
+#include "downloader.h"
+#include "manifestchangeset.h"
+#include "parseoptions.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ManifestParser;
+
+#pragma GCC visibility push(default)
+
+/*! \brief Parsers shared by the threads of an application.
+ *
+ * Every method can be called from several threads at once, each parse uses its own parser.
+ * The downloader, the options and their pointers belong to the calling thread.
+ *
+ * The idle parsers are kept in one free list per hardware thread, a thread takes from and
+ * gives back to the list its id maps to. Another list is only used when its own one is
+ * empty, so threads rarely contend for a list and usually get back their own parser.
+ */
+class ParserPool
+{
+public:
+    /*! \brief
+     *
+     * \param[in]  maxIdle              The number of idle parsers kept, 0 for the number of hardware threads
+    */
+    explicit ParserPool(size_t maxIdle = 0);
+
+    ~ParserPool();
+
+    /*! \brief same as F4mParseManifest.
+    */
+    bool parse(Downloader *downloader, const std::string &url, Manifest *manifest,
+               const ParseOptions &options = ParseOptions());
+
+    /*! \brief same as F4mParseManifestFromBuffer.
+     *
+     * \param[in]  downloader           Downloads the stream-level manifests, or NULL
+    */
+    bool parseBuffer(Downloader *downloader, const uint8_t *data, size_t size, const std::string &url,
+                     Manifest *manifest, const ParseOptions &options = ParseOptions());
+
+    /*! \brief same as F4mRefreshManifest.
+    */
+    bool refresh(Downloader *downloader, const std::string &url, const Manifest &previous,
+                 Manifest *manifest, ManifestChangeSet *changes,
+                 const ParseOptions &options = ParseOptions());
+
+    size_t idleParsers() const; ///< parsers waiting for a parse
+
+private:
+    ParserPool(const ParserPool &) = delete;
+    ParserPool& operator=(const ParserPool &) = delete;
+
+    friend class ParserLease;
+
+    class FreeList
+    {
+    public:
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ManifestParser>> idle; // the last released at the back
+    };
+
+    std::unique_ptr<ManifestParser> acquire(Downloader *downloader);
+    void release(std::unique_ptr<ManifestParser> parser);
+    size_t freeListOfThread() const;
+
+    size_t m_maxIdle; // in each free list
+    size_t m_freeListCount;
+    std::unique_ptr<FreeList[]> m_freeLists;
+};
+
+#pragma GCC visibility pop
+
+#endif // PARSERPOOL_H
@@ -0,0 +1,65 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "parsestats.h"
+
+#include <cstring> // memset
+
+void ParseStats::reset()
+{
+    totalNs = 0;
+    memset(phaseNs, 0, sizeof(phaseNs));
+    memset(phaseCount, 0, sizeof(phaseCount));
+    bytesDownloaded = 0;
+    bytesDecoded = 0;
+    bytesReused = 0;
+    nodesVisited = 0;
+    payloadBuffers = 0;
+    subRequests = 0;
+    retries = 0;
+    hedgedRequests = 0;
+}
+
+const char* ParseStats::phaseName(Phase phase)
+{
+    static const char *names[PHASE_COUNT] = {
+        "download",
+        "loadXml",
+        "parseManifest",
+        "parseMedias",
+        "parseAdaptiveSets",
+        "parseDvrInfos",
+        "parseDrmAdditionalHeaders",
+        "parseBootstrapInfos",
+        "parseSmpteTimeCodes",
+        "parseCueInfos",
+        "parseBestEffortFetchInfos",
+        "parseDrmAdditionalHeaderSets",
+        "mlStreamManifests",
+        "base64Decode"
+    };
+    if (phase < 0 || phase >= PHASE_COUNT) {
+        return "";
+    }
+    return names[phase];
+}
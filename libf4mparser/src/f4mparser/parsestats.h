@@ -0,0 +1,91 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file parsestats.h
+ *  \brief Timings and counters collected while parsing a manifest.
+ *
+ *  Collecting is optional : when no ParseStats is given to the parser the only
+ *  cost is a pointer check at each phase.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef PARSESTATS_H
+#define PARSESTATS_H
+
+#include <cstdint>
+
+#pragma GCC visibility push(default)
+
+/*! \brief The result of the instrumentation of one parse.
+ *
+ * Phases nest : the PARSE_MANIFEST phase contains the parse* phases of its sections,
+ * ML_STREAM_MANIFESTS contains the downloads and parses of the stream-level manifests
+ * and every phase contains the base64 decoding done inside it.
+ * A phase entered several times (one per stream-level manifest for example) is cumulated.
+ */
+class ParseStats
+{
+public:
+    enum Phase {
+        PHASE_DOWNLOAD, ///< waiting for the download function
+        PHASE_LOAD_XML, ///< building the xml document from the downloaded buffer
+        PHASE_PARSE_MANIFEST,
+        PHASE_PARSE_MEDIAS,
+        PHASE_PARSE_ADAPTIVE_SETS,
+        PHASE_PARSE_DVR_INFOS,
+        PHASE_PARSE_DRM_ADDITIONAL_HEADERS,
+        PHASE_PARSE_BOOTSTRAP_INFOS,
+        PHASE_PARSE_SMPTE_TIMECODES,
+        PHASE_PARSE_CUE_INFOS,
+        PHASE_PARSE_BEST_EFFORT_FETCH_INFOS,
+        PHASE_PARSE_DRM_ADDITIONAL_HEADER_SETS,
+        PHASE_ML_STREAM_MANIFESTS, ///< fetching and parsing the stream-level manifests of a multi-level manifest
+        PHASE_BASE64_DECODE,
+        PHASE_COUNT
+    };
+
+    ParseStats() { reset(); }
+
+    void reset();
+
+    static const char* phaseName(Phase phase); ///< a stable name, for exporting
+
+    uint64_t totalNs; ///< duration of the whole parse, in nanoseconds
+    uint64_t phaseNs[PHASE_COUNT]; ///< cumulated duration of each phase, in nanoseconds
+    uint32_t phaseCount[PHASE_COUNT]; ///< number of times each phase was entered
+
+    uint64_t bytesDownloaded; ///< size of the documents returned by the download function
+    uint64_t bytesDecoded; ///< raw bytes produced by base64 decoding
+    uint64_t bytesReused; ///< raw bytes copied from the previous manifest of a refresh instead of being decoded
+    uint64_t nodesVisited; ///< xml elements examined
+    // not a count of the heap allocations : pugixml and the Manifest members are not counted
+    uint64_t payloadBuffers; ///< byte buffers made for payloads : 1 per document, 1 per blob reused, 2 per blob decoded (text without spaces, data)
+    uint32_t subRequests; ///< downloads issued for the stream-level manifests
+    uint32_t retries; ///< downloads issued again after a failure, see RetryPolicy
+    uint32_t hedgedRequests; ///< downloads for which the Downloader sent a duplicate request
+};
+
+#pragma GCC visibility pop
+
+#endif // PARSESTATS_H
@@ -0,0 +1,83 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file parsetracer.h
+ *  \brief Hooks receiving a span for each download and parse phase.
+ *
+ *  A tracer is called synchronously from the parsing thread. Spans are well nested :
+ *  they end in the reverse order they began, a span's parent is the innermost span
+ *  open when it began.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef PARSETRACER_H
+#define PARSETRACER_H
+
+#include "parsestats.h"
+
+#include <string>
+
+#pragma GCC visibility push(default)
+
+/*! \brief One traced operation.
+ */
+class TraceSpan
+{
+public:
+    enum Kind {
+        SPAN_PHASE, ///< a parse phase, see ParseStats::Phase
+        SPAN_MANIFEST_DOWNLOAD, ///< the manifest given to the parser (the set-level one for a multi-level manifest)
+        SPAN_STREAM_MANIFEST_DOWNLOAD, ///< the stream-level manifests of a multi-level manifest, downloaded as one batch
+        SPAN_DVR_INFO_DOWNLOAD ///< the dvrInfo document of F4mUpdateDvrInfo
+    };
+
+    TraceSpan() : kind{SPAN_PHASE}, phase{ParseStats::PHASE_COUNT}, id{0}, parentId{0},
+        bytes{0}, status{0}, durationNs{0} {}
+
+    Kind kind;
+    ParseStats::Phase phase; ///< PHASE_DOWNLOAD for the download spans
+    uint64_t id; ///< unique inside a parse, starts at 1
+    uint64_t parentId; ///< 0 for the outermost spans
+    std::string url; ///< the document being downloaded or parsed
+
+    // only meaningful at the end of the span
+    uint64_t bytes; ///< downloads : size of the response. loadXml : size of the document. base64Decode : decoded size
+    long status; ///< downloads : the http status code given by the download function. phases : 0, or -1 if it failed
+    uint64_t durationNs;
+};
+
+/*! \brief Receive the spans of a parse.
+ */
+class ParseTracer
+{
+public:
+    virtual ~ParseTracer() {}
+
+    virtual void spanBegin(const TraceSpan &span) = 0;
+    virtual void spanEnd(const TraceSpan &span) = 0;
+};
+
+#pragma GCC visibility pop
+
+#endif // PARSETRACER_H
@@ -0,0 +1,60 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "phasetimer.h"
+
+void PhaseTimer::begin(ParseStats::Phase phase, const std::string *url, TraceSpan::Kind kind)
+{
+    m_span.phase = phase;
+
+    if (m_instruments->tracer) {
+        m_span.kind = kind;
+        m_span.id = m_instruments->nextSpanId++;
+        m_span.parentId = m_instruments->openSpans.empty() ? 0 : m_instruments->openSpans.back();
+        if (url) {
+            m_span.url = *url;
+        }
+        m_instruments->openSpans.push_back(m_span.id);
+        m_instruments->tracer->spanBegin(m_span);
+    }
+
+    m_start = std::chrono::steady_clock::now();
+}
+
+void PhaseTimer::end()
+{
+    uint64_t duration = elapsedNs(m_start);
+
+    if (m_instruments->stats) {
+        m_instruments->stats->phaseNs[m_span.phase] += duration;
+        m_instruments->stats->phaseCount[m_span.phase]++;
+    }
+
+    if (m_instruments->tracer) {
+        m_span.bytes = m_bytes;
+        m_span.status = m_status;
+        m_span.durationNs = duration;
+        m_instruments->openSpans.pop_back();
+        m_instruments->tracer->spanEnd(m_span);
+    }
+}
@@ -0,0 +1,92 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#ifndef PHASETIMER_H
+#define PHASETIMER_H
+
+#include "parseoptions.h"
+
+#include <chrono>
+#include <vector>
+
+// the instrumentation of one parse, see ParseOptions
+
+class Instruments
+{
+public:
+    Instruments() : stats{nullptr}, tracer{nullptr}, nextSpanId{1} {}
+
+    bool enabled() const { return stats || tracer; }
+
+    ParseStats *stats;
+    ParseTracer *tracer;
+    uint64_t nextSpanId;
+    std::vector<uint64_t> openSpans;
+};
+
+// times the enclosing scope into the stats and reports it as a span to the tracer,
+// only checks two pointers when neither is set
+
+class PhaseTimer
+{
+public:
+    PhaseTimer(Instruments *instruments, ParseStats::Phase phase,
+               const std::string *url = nullptr, TraceSpan::Kind kind = TraceSpan::SPAN_PHASE)
+        : m_instruments(instruments->enabled() ? instruments : nullptr), m_bytes(0), m_status(0) {
+        if (m_instruments) {
+            begin(phase, url, kind);
+        }
+    }
+
+    ~PhaseTimer() {
+        if (m_instruments) {
+            end();
+        }
+    }
+
+    // reported at the end of the span
+    void setResult(uint64_t bytes, long status) {
+        m_bytes = bytes;
+        m_status = status;
+    }
+
+    static uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer& operator=(const PhaseTimer &) = delete;
+
+    void begin(ParseStats::Phase phase, const std::string *url, TraceSpan::Kind kind);
+    void end();
+
+    Instruments *m_instruments;
+    TraceSpan m_span;
+    uint64_t m_bytes;
+    long m_status;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif // PHASETIMER_H
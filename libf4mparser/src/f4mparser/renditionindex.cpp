@@ -0,0 +1,194 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "renditionindex.h"
+
+#include "manifest.h"
+#include "numberutils.h"
+
+#include <algorithm>
+
+namespace
+{
+    Rendition::Track trackOf(const std::string &type)
+    {
+        if (type == "audio") {
+            return Rendition::TRACK_AUDIO;
+        } else if (type == "data") {
+            return Rendition::TRACK_DATA;
+        } else if (type == "text") {
+            return Rendition::TRACK_TEXT;
+        } else if (type == "video-keyframe-only") {
+            return Rendition::TRACK_VIDEO_KEYFRAME_ONLY;
+        }
+        return Rendition::TRACK_VIDEO;  // "", "video", "audio+video"
+    }
+
+    void addMedias(const std::vector<Media> &medias, int set, std::vector<Rendition> *renditions)
+    {
+        for (size_t i = 0; i < medias.size(); ++i) {
+            const Media &media = medias[i];
+            Rendition rendition;
+            if (NumberUtils::parseInt(media.bitrate.c_str(), &rendition.bitrate) == false
+                    || rendition.bitrate < 0) {
+                rendition.bitrate = -1;
+            }
+            rendition.width = media.width;
+            rendition.height = media.height;
+            rendition.track = trackOf(media.type);
+            rendition.alternate = media.alternate;
+            if (media.alternate) {
+                rendition.lang = media.lang;
+            }
+            rendition.codec = rendition.track == Rendition::TRACK_AUDIO
+                    ? media.audioCodec : media.videoCodec;
+            rendition.set = set;
+            rendition.index = static_cast<int>(i);
+            renditions->push_back(rendition);
+        }
+    }
+
+    // order of the index, the group is (track, lang)
+    bool groupLess(const Rendition &a, Rendition::Track track, const std::string &lang)
+    {
+        return a.track != track ? a.track < track : a.lang.compare(lang) < 0;
+    }
+
+    bool sameGroup(const Rendition &a, const Rendition &b)
+    {
+        return a.track == b.track && a.lang == b.lang;
+    }
+
+    struct RenditionLess
+    {
+        bool operator()(const Rendition &a, const Rendition &b) const
+        {
+            if (!sameGroup(a, b)) {
+                return groupLess(a, b.track, b.lang);
+            }
+            if (a.bitrate != b.bitrate) {
+                return a.bitrate < b.bitrate;
+            }
+            return a.set != b.set ? a.set < b.set : a.index < b.index;
+        }
+    };
+}
+
+void RenditionIndex::build(const Manifest &manifest)
+{
+    m_renditions.clear();
+    size_t count = manifest.medias.size();
+    for (const auto &aSet : manifest.adaptiveSets) {
+        count += aSet.medias.size();
+    }
+    m_renditions.reserve(count);
+
+    addMedias(manifest.medias, -1, &m_renditions);
+    for (size_t set = 0; set < manifest.adaptiveSets.size(); ++set) {
+        addMedias(manifest.adaptiveSets[set].medias, static_cast<int>(set), &m_renditions);
+    }
+    std::sort(m_renditions.begin(), m_renditions.end(), RenditionLess());
+}
+
+const Rendition* RenditionIndex::highestAtMost(Rendition::Track track, int bitrate,
+                                               const std::string &lang) const
+{
+    // first rendition after (track, lang, bitrate)
+    auto it = std::upper_bound(m_renditions.begin(), m_renditions.end(), bitrate,
+                               [&](int value, const Rendition &r) {
+        if (r.track != track || r.lang != lang) {
+            return !groupLess(r, track, lang);
+        }
+        return value < r.bitrate;
+    });
+    if (it == m_renditions.begin()) {
+        return nullptr;
+    }
+    --it;
+    if (it->track != track || it->lang != lang || it->bitrate > bitrate || it->bitrate < 0) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+const Rendition* RenditionIndex::lowest(Rendition::Track track, const std::string &lang) const
+{
+    // first rendition of the group with a known bitrate
+    auto it = std::lower_bound(m_renditions.begin(), m_renditions.end(), 0,
+                               [&](const Rendition &r, int value) {
+        if (r.track != track || r.lang != lang) {
+            return groupLess(r, track, lang);
+        }
+        return r.bitrate < value;
+    });
+    if (it == m_renditions.end() || it->track != track || it->lang != lang) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+const Rendition* RenditionIndex::highest(Rendition::Track track, const std::string &lang) const
+{
+    return highestAtMost(track, INT_MAX, lang);
+}
+
+const Rendition* RenditionIndex::audioForLang(const std::string &lang, int maxBitrate) const
+{
+    const Rendition *rendition = highestAtMost(Rendition::TRACK_AUDIO, maxBitrate, lang);
+    return rendition ? rendition : lowest(Rendition::TRACK_AUDIO, lang);
+}
+
+const Rendition* RenditionIndex::stepUp(const Rendition &rendition) const
+{
+    size_t pos = static_cast<size_t>(&rendition - m_renditions.data());
+    if (rendition.bitrate >= 0 && pos + 1 < m_renditions.size()
+            && sameGroup(m_renditions[pos + 1], rendition)) {
+        return &m_renditions[pos + 1];
+    }
+    return nullptr;
+}
+
+const Rendition* RenditionIndex::stepDown(const Rendition &rendition) const
+{
+    size_t pos = static_cast<size_t>(&rendition - m_renditions.data());
+    if (pos > 0 && pos <= m_renditions.size() && sameGroup(m_renditions[pos - 1], rendition)
+            && m_renditions[pos - 1].bitrate >= 0) {
+        return &m_renditions[pos - 1];
+    }
+    return nullptr;
+}
+
+const Media* RenditionIndex::media(const Manifest &manifest, const Rendition &rendition)
+{
+    const std::vector<Media> *medias = &manifest.medias;
+    if (rendition.set >= 0) {
+        if (static_cast<size_t>(rendition.set) >= manifest.adaptiveSets.size()) {
+            return nullptr;
+        }
+        medias = &manifest.adaptiveSets[rendition.set].medias;
+    }
+    if (rendition.index < 0 || static_cast<size_t>(rendition.index) >= medias->size()) {
+        return nullptr;
+    }
+    return &(*medias)[rendition.index];
+}
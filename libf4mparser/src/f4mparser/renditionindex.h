@@ -0,0 +1,123 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+/*! \file renditionindex.h
+ *  \brief Renditions of a manifest sorted by bitrate, for adaptive bitrate selection.
+ *
+ *  The index is built by the parser (and when a serialized manifest is loaded) from
+ *  Manifest::medias and the medias of every Manifest::adaptiveSets.
+ *  A rendition refers to its Media by position, the index stays valid when the
+ *  Manifest is copied but must be rebuilt if its medias are modified.
+ *
+ *  \author (rafirafi)
+ */
+
+#ifndef RENDITIONINDEX_H
+#define RENDITIONINDEX_H
+
+#include <string>
+#include <vector>
+#include <climits>
+
+class Manifest;
+class Media;
+
+#pragma GCC visibility push(default)
+
+/*! \brief The numeric view of a media used for selection.
+ */
+class Rendition
+{
+public:
+    enum Track {
+        TRACK_VIDEO, ///< type "video", "audio+video" or no type
+        TRACK_VIDEO_KEYFRAME_ONLY, ///< type "video-keyframe-only", F4M 3.0
+        TRACK_AUDIO,
+        TRACK_DATA,
+        TRACK_TEXT
+    };
+
+    Rendition() : bitrate{-1}, width{-1}, height{-1}, track{TRACK_VIDEO}, alternate{false},
+        set{-1}, index{-1} {}
+
+    int bitrate; ///< In kilobits per second, -1 if the media has none or it is not a number.
+    int width; ///< As in Media, -1 if unknown.
+    int height; ///< As in Media, -1 if unknown.
+    Track track;
+    bool alternate;
+    std::string lang; ///< Media::lang of an alternate media, empty for the others.
+    std::string codec; ///< Media::audioCodec for the audio track, Media::videoCodec for the others.
+
+    int set; ///< -1 for Manifest::medias, else the position in Manifest::adaptiveSets
+    int index; ///< position of the media in its medias vector
+};
+
+/*! \brief Renditions grouped by track and language, sorted by increasing bitrate.
+ *
+ * The main presentation is the group of a track with an empty language : only alternate
+ * medias are grouped by their lang. Queries are O(log n).
+ *
+ * A rendition whose bitrate is unknown (-1) comes first in its group but its cost can't
+ * be compared : the queries never return it and the steps never move to or from it.
+ */
+class RenditionIndex
+{
+public:
+    void build(const Manifest &manifest);
+    void clear() { m_renditions.clear(); }
+
+    bool   empty() const { return m_renditions.empty(); }
+    size_t size() const { return m_renditions.size(); }
+    const std::vector<Rendition>& renditions() const { return m_renditions; } ///< Sorted by track, lang then bitrate.
+
+    /*! \brief The rendition with the highest bitrate not above 'bitrate', nullptr if all are above.
+     */
+    const Rendition* highestAtMost(Rendition::Track track, int bitrate,
+                                   const std::string &lang = std::string()) const;
+    const Rendition* lowest(Rendition::Track track, const std::string &lang = std::string()) const;
+    const Rendition* highest(Rendition::Track track, const std::string &lang = std::string()) const;
+
+    /*! \brief The alternate audio in 'lang' fitting in 'maxBitrate', or the lowest one in 'lang'.
+     *
+     * nullptr if there is no alternate audio in 'lang'.
+     */
+    const Rendition* audioForLang(const std::string &lang, int maxBitrate = INT_MAX) const;
+
+    /*! \brief The next rendition of the same group, nullptr at the end of the ladder or for an unknown bitrate.
+     *
+     * 'rendition' must come from this index.
+     */
+    const Rendition* stepUp(const Rendition &rendition) const;
+    const Rendition* stepDown(const Rendition &rendition) const;
+
+    /*! \brief The media of 'rendition' in the manifest the index was built from.
+     */
+    static const Media* media(const Manifest &manifest, const Rendition &rendition);
+
+private:
+    std::vector<Rendition> m_renditions;
+};
+
+#pragma GCC visibility pop
+
+#endif // RENDITIONINDEX_H
@@ -0,0 +1,142 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#ifndef SINGLEFLIGHT_H
+#define SINGLEFLIGHT_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// coalesces the concurrent computations of the same key : the first caller computes
+// the result, the callers arriving before it is done wait for it and get a copy.
+// Nothing is kept once the computation is done.
+//
+//     auto flight = flights.join(key);
+//     if (flight.leads()) {
+//         ok = compute(&result);
+//         flights.finish(&flight, ok, result);
+//     } else {
+//         ok = flights.wait(&flight, &result);
+//     }
+//
+// a caller must finish the flights it leads before waiting for others, this makes
+// deadlocks impossible. A led flight destroyed before being finished, when the
+// computation throws for instance, is finished as failed : the waiters never block
+// on a leader which is gone
+
+template <typename Result>
+class SingleFlight
+{
+private:
+    struct State {
+        State() : done(false), ok(false), waiters(0) {}
+
+        bool done;
+        bool ok;
+        int waiters;
+        Result result; // set only when there are waiters
+    };
+
+public:
+    class Flight
+    {
+    public:
+        Flight() : m_owner(nullptr), m_leader(false) {}
+        Flight(Flight &&other) noexcept
+            : m_owner(other.m_owner), m_key(std::move(other.m_key)),
+              m_state(std::move(other.m_state)), m_leader(other.m_leader) {
+            other.m_owner = nullptr;
+        }
+        Flight(const Flight &) = delete;
+        Flight& operator=(const Flight &) = delete;
+        ~Flight() {
+            if (m_owner) {
+                m_owner->finish(this, false, Result());
+            }
+        }
+
+        bool leads() const { return m_leader; }
+
+    private:
+        friend class SingleFlight;
+        SingleFlight *m_owner; // while led and not finished
+        std::string m_key;
+        std::shared_ptr<State> m_state;
+        bool m_leader;
+    };
+
+    Flight join(const std::string &key) {
+        Flight flight;
+        flight.m_key = key;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_flights.find(key);
+        flight.m_leader = it == m_flights.end();
+        if (flight.m_leader) {
+            flight.m_owner = this;
+            flight.m_state = std::make_shared<State>();
+            m_flights.emplace(key, flight.m_state);
+        } else {
+            flight.m_state = it->second;
+            flight.m_state->waiters++;
+        }
+        return flight;
+    }
+
+    // by the leader, hands the result to the waiters
+    void finish(Flight *flight, bool ok, const Result &result) {
+        flight->m_owner = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            State &state = *flight->m_state;
+            if (state.waiters > 0) {
+                state.result = result;
+            }
+            state.ok = ok;
+            state.done = true;
+            m_flights.erase(flight->m_key);
+        }
+        m_done.notify_all();
+    }
+
+    // by the others, false if the leader failed
+    bool wait(Flight *flight, Result *result) {
+        State &state = *flight->m_state;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [&state] { return state.done; });
+        }
+        // not modified once done, copied without the lock
+        *result = state.result;
+        return state.ok;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_done;
+    std::unordered_map<std::string, std::shared_ptr<State>> m_flights;
+};
+
+#endif // SINGLEFLIGHT_H
@@ -0,0 +1,282 @@
+/****************************************************************************
+ * This file is part of libf4mparser.
+ *
+ * Copyright (C) 2013 rafirafi <rafirafi.at@gmail.com>
+ *
+ * Author(s):
+ * rafirafi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "manifest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+    // reads the digits at 'pos', -1 if there is none
+    int readField(const std::string &str, size_t *pos)
+    {
+        int value = -1;
+        while (*pos < str.size() && str[*pos] >= '0' && str[*pos] <= '9') {
+            value = (value < 0 ? 0 : value * 10) + (str[*pos] - '0');
+            if (value > 99999) {
+                return -1;
+            }
+            ++*pos;
+        }
+        return value;
+    }
+
+    const double s_standardFrameRates[] = {
+        24000. / 1001., 24., 25., 30000. / 1001., 30., 48., 50., 60000. / 1001., 60.
+    };
+
+    // frames dropped each minute but every tenth by a drop-frame timecode
+    int droppedFrames(int nominalFrameRate)
+    {
+        return nominalFrameRate / 15;
+    }
+}
+
+bool SmpteTimecodeIndex::parseSmpte(const std::string &smpte, SmpteTimecode *timecode)
+{
+    size_t pos = 0;
+    int fields[4];
+    bool dropFrame = false;
+    for (int i = 0; i < 4; ++i) {
+        if (i > 0) {
+            if (pos >= smpte.size()) {
+                return false;
+            }
+            char separator = smpte[pos++];
+            if (i == 3 && (separator == ';' || separator == ',')) {
+                dropFrame = true;
+            } else if (separator != ':') {
+                return false;
+            }
+        }
+        fields[i] = readField(smpte, &pos);
+        if (fields[i] < 0) {
+            return false;
+        }
+    }
+    if (pos != smpte.size() || fields[1] > 59 || fields[2] > 59) {
+        return false;
+    }
+
+    timecode->hours = fields[0];
+    timecode->minutes = fields[1];
+    timecode->seconds = fields[2];
+    timecode->frames = fields[3];
+    timecode->dropFrame = dropFrame;
+    return true;
+}
+
+void SmpteTimecodeIndex::build(const std::vector<SmpteTimecode> &timecodes)
+{
+    m_samples.resize(timecodes.size());
+    m_dropFrame = false;
+    int maxFrame = -1;
+    for (size_t i = 0; i < timecodes.size(); ++i) {
+        const SmpteTimecode &timecode = timecodes[i];
+        m_samples[i] = Sample{timecode.timestamp, static_cast<int>(i), timecode.hours,
+                              timecode.minutes, timecode.seconds, timecode.frames};
+        if (timecode.frames >= 0) {
+            maxFrame = std::max(maxFrame, timecode.frames);
+            m_dropFrame = m_dropFrame || timecode.dropFrame;
+        }
+    }
+    std::stable_sort(m_samples.begin(), m_samples.end(), [](const Sample &a, const Sample &b) {
+        return a.timestamp < b.timestamp;
+    });
+
+    const Sample *first = nullptr;
+    const Sample *last = nullptr;
+    for (const auto &sample : m_samples) {
+        if (sample.frames >= 0) {
+            if (!first) {
+                first = &sample;
+            }
+            last = &sample;
+        }
+    }
+
+    // the standard frame rate which maps the first sample to the last one within a tenth
+    // of a frame, it is only determined when no other one does
+    double bestFrameRate = 0.;
+    for (double frameRate : s_standardFrameRates) {
+        int nominal = static_cast<int>(std::lround(frameRate));
+        bool fractional = frameRate != nominal;
+        if (nominal <= maxFrame || (m_dropFrame && !(fractional && nominal % 30 == 0))) {
+            continue;
+        }
+        m_nominalFrameRate = nominal;
+        double error = 0.;
+        if (first != last) {
+            error = std::fabs((frameNumber(*last) - frameNumber(*first)) / frameRate
+                              - (last->timestamp - first->timestamp));
+        }
+        if (error * frameRate > 0.1) {
+            continue;
+        }
+        if (bestFrameRate > 0.) {
+            bestFrameRate = 0.;
+            break;
+        }
+        bestFrameRate = frameRate;
+    }
+    setFrameRate(bestFrameRate);
+}
+
+void SmpteTimecodeIndex::clear()
+{
+    m_samples.clear();
+    m_dropFrame = false;
+    setFrameRate(0.);
+}
+
+void SmpteTimecodeIndex::setFrameRate(double frameRate)
+{
+    m_frameRate = frameRate > 0. ? frameRate : 0.;
+    m_nominalFrameRate = static_cast<int>(std::lround(m_frameRate));
+    buildAnchors();
+}
+
+void SmpteTimecodeIndex::buildAnchors()
+{
+    m_byTimestamp.clear();
+    m_byFrameNumber.clear();
+    if (m_nominalFrameRate == 0) {
+        return;
+    }
+    for (const auto &sample : m_samples) {
+        if (sample.frames >= 0 && sample.frames < m_nominalFrameRate) {
+            m_byTimestamp.push_back(Anchor{sample.timestamp, frameNumber(sample)});
+        }
+    }
+    m_byFrameNumber = m_byTimestamp;
+    std::stable_sort(m_byFrameNumber.begin(), m_byFrameNumber.end(),
+                     [](const Anchor &a, const Anchor &b) {
+        return a.frameNumber < b.frameNumber;
+    });
+}
+
+int SmpteTimecodeIndex::find(const std::vector<SmpteTimecode> &timecodes, double timestamp,
+                             const std::string &smpte) const
+{
+    auto it = std::lower_bound(m_samples.begin(), m_samples.end(), timestamp,
+                               [](const Sample &sample, double value) {
+        return sample.timestamp < value;
+    });
+    for (; it != m_samples.end() && it->timestamp == timestamp; ++it) {
+        if (timecodes[it->position].smpte == smpte) {
+            return it->position;
+        }
+    }
+    return -1;
+}
+
+int64_t SmpteTimecodeIndex::frameNumber(int hours, int minutes, int seconds, int frames) const
+{
+    int64_t totalMinutes = int64_t(hours) * 60 + minutes;
+    int64_t number = (totalMinutes * 60 + seconds) * m_nominalFrameRate + frames;
+    if (m_dropFrame && m_nominalFrameRate % 30 == 0) {
+        number -= droppedFrames(m_nominalFrameRate) * (totalMinutes - totalMinutes / 10);
+    }
+    return number;
+}
+
+int64_t SmpteTimecodeIndex::frameNumber(const Sample &sample) const
+{
+    return frameNumber(sample.hours, sample.minutes, sample.seconds, sample.frames);
+}
+
+void SmpteTimecodeIndex::setTimecode(int64_t frameNumber, bool dropFrame,
+                                     SmpteTimecode *timecode) const
+{
+    if (dropFrame) {
+        int64_t dropped = droppedFrames(m_nominalFrameRate);
+        int64_t framesPerMinute = m_nominalFrameRate * 60 - dropped;
+        int64_t framesPerTenMinutes = m_nominalFrameRate * 600 - dropped * 9;
+        int64_t tens = frameNumber / framesPerTenMinutes;
+        int64_t remainder = frameNumber % framesPerTenMinutes;
+        frameNumber += dropped * 9 * tens;
+        if (remainder > dropped) {
+            frameNumber += dropped * ((remainder - dropped) / framesPerMinute);
+        }
+    }
+    int64_t seconds = frameNumber / m_nominalFrameRate;
+    timecode->frames = static_cast<int>(frameNumber % m_nominalFrameRate);
+    timecode->seconds = static_cast<int>(seconds % 60);
+    timecode->minutes = static_cast<int>(seconds / 60 % 60);
+    timecode->hours = static_cast<int>(seconds / 3600);
+    timecode->dropFrame = dropFrame;
+
+    char smpte[32];
+    snprintf(smpte, sizeof(smpte), "%02d:%02d:%02d%c%02d", timecode->hours, timecode->minutes,
+             timecode->seconds, dropFrame ? ';' : ':', timecode->frames);
+    timecode->smpte = smpte;
+}
+
+bool SmpteTimecodeIndex::timecodeAt(double timestamp, SmpteTimecode *timecode) const
+{
+    if (m_byTimestamp.empty()) {
+        return false;
+    }
+    auto it = std::upper_bound(m_byTimestamp.begin(), m_byTimestamp.end(), timestamp,
+                               [](double value, const Anchor &anchor) {
+        return value < anchor.timestamp;
+    });
+    if (it != m_byTimestamp.begin()) {
+        --it;
+    }
+    // a frame is displayed from its own timestamp, the epsilon absorbs rounding errors
+    int64_t number = it->frameNumber
+            + static_cast<int64_t>(std::floor((timestamp - it->timestamp) * m_frameRate + 1e-6));
+    if (number < 0) {
+        return false;
+    }
+    setTimecode(number, m_dropFrame && m_nominalFrameRate % 30 == 0, timecode);
+    return true;
+}
+
+bool SmpteTimecodeIndex::timestampOf(const SmpteTimecode &timecode, double *timestamp) const
+{
+    if (m_byFrameNumber.empty() || timecode.hours < 0 || timecode.minutes < 0
+            || timecode.seconds < 0 || timecode.frames < 0
+            || timecode.frames >= m_nominalFrameRate) {
+        return false;
+    }
+    int64_t number = frameNumber(timecode.hours, timecode.minutes, timecode.seconds, timecode.frames);
+    auto it = std::upper_bound(m_byFrameNumber.begin(), m_byFrameNumber.end(), number,
+                               [](int64_t value, const Anchor &anchor) {
+        return value < anchor.frameNumber;
+    });
+    if (it != m_byFrameNumber.begin()) {
+        --it;
+    }
+    *timestamp = it->timestamp + (number - it->frameNumber) / m_frameRate;
+    return true;
+}
+
+bool SmpteTimecodeIndex::timestampOf(const std::string &smpte, double *timestamp) const
+{
+    SmpteTimecode timecode;
+    return parseSmpte(smpte, &timecode) && timestampOf(timecode, timestamp);
+}
@@ -24,13 +24,98 @@
 #include "urlutils.h"
 
 #include <cctype> //tolower
+#include <cstring>
+
+namespace
+{
+    // length of the scheme of 'url', 0 if it has none
+    size_t schemeLength(const char *url)
+    {
+        if (!isalpha(static_cast<unsigned char>(url[0]))) {
+            return 0;
+        }
+        size_t i = 1;
+        while (isalnum(static_cast<unsigned char>(url[i]))
+               || url[i] == '+' || url[i] == '-' || url[i] == '.') {
+            ++i;
+        }
+        return url[i] == ':' ? i : 0;
+    }
+
+    bool haveAuthority(const char *url)
+    {
+        size_t length = schemeLength(url);
+        return length > 0 && url[length + 1] == '/' && url[length + 2] == '/';
+    }
+
+    // RFC 3986 5.2.4, applied in place to the end of 'url' starting at 'pathStart'.
+    // The output never grows past what has been read so both share the buffer.
+    void removeDotSegments(std::string *url, size_t pathStart)
+    {
+        char *b = &(*url)[0];
+        const size_t n = url->size();
+        size_t r = pathStart;
+        size_t w = pathStart;
+
+        auto startsWith = [&](const char *prefix, size_t length) {
+            return n - r >= length && memcmp(b + r, prefix, length) == 0;
+        };
+        auto is = [&](const char *rest, size_t length) {
+            return n - r == length && memcmp(b + r, rest, length) == 0;
+        };
+        auto popSegment = [&]() {
+            while (w > pathStart && b[w - 1] != '/') {
+                --w;
+            }
+            if (w > pathStart) {
+                --w;
+            }
+        };
+
+        while (r < n) {
+            if (startsWith("../", 3)) {
+                r += 3;
+            } else if (startsWith("./", 2)) {
+                r += 2;
+            } else if (startsWith("/./", 3)) {
+                r += 2;
+            } else if (is("/.", 2)) {
+                r += 1;
+                b[r] = '/';
+            } else if (startsWith("/../", 4)) {
+                r += 3;
+                popSegment();
+            } else if (is("/..", 3)) {
+                r += 2;
+                b[r] = '/';
+                popSegment();
+            } else if (is(".", 1) || is("..", 2)) {
+                r = n;
+            } else {
+                size_t end = r + (b[r] == '/' ? 1 : 0);
+                while (end < n && b[end] != '/') {
+                    ++end;
+                }
+                memmove(b + w, b + r, end - r);
+                w += end - r;
+                r = end;
+            }
+        }
+        url->resize(w);
+    }
+}
 
 namespace UrlUtils
 {
 
 bool isAbsolute(const std::string &url)
 {
-    return url.find("://") != std::string::npos;
+    return haveAuthority(url.c_str());
+}
+
+bool isAbsolute(const char *url)
+{
+    return haveAuthority(url);
 }
 
 bool haveHttpScheme(const std::string &url)
@@ -65,4 +150,100 @@ bool haveRtmfpScheme(const std::string &url)
     return true;
 }
 
+BaseUrl::BaseUrl()
+    : m_schemeEnd{0}, m_authorityEnd{0}, m_directoryEnd{0}, m_pathEnd{0}, m_queryEnd{0}
+{
+}
+
+BaseUrl::BaseUrl(const std::string &url)
+    : m_schemeEnd{0}, m_authorityEnd{0}
+{
+    if (haveAuthority(url.c_str())) {
+        m_schemeEnd = schemeLength(url.c_str());
+        m_authorityEnd = url.find_first_of("/?#", m_schemeEnd + 3);
+        if (m_authorityEnd == std::string::npos) {
+            m_authorityEnd = url.size();
+        }
+    }
+    size_t pathEnd = url.find_first_of("?#", m_authorityEnd);
+    if (pathEnd == std::string::npos) {
+        pathEnd = url.size();
+    }
+
+    m_url.reserve(url.size());
+    m_url.assign(url, 0, pathEnd);
+    removeDotSegments(&m_url, m_authorityEnd);
+    m_pathEnd = m_url.size();
+    m_url.append(url, pathEnd, std::string::npos);
+
+    size_t lastSlash = m_url.find_last_of('/', m_pathEnd > 0 ? m_pathEnd - 1 : 0);
+    m_directoryEnd = (lastSlash == std::string::npos || lastSlash < m_authorityEnd)
+            ? m_authorityEnd : lastSlash + 1;
+    m_queryEnd = m_url.find('#', m_pathEnd);
+    if (m_queryEnd == std::string::npos) {
+        m_queryEnd = m_url.size();
+    }
+}
+
+// RFC 3986 5.2.2, the size of the result is known before any copy and dot segments
+// can only shrink it.
+std::string BaseUrl::resolve(const char *ref) const
+{
+    const size_t refSize = strlen(ref);
+    if (haveAuthority(ref)) {
+        return std::string(ref, refSize);
+    }
+
+    const size_t refPathEnd = strcspn(ref, "?#");
+    const bool refHasQuery = ref[refPathEnd] == '?';
+    std::string result;
+
+    if (ref[0] == '/' && ref[1] == '/') {
+        // network-path reference : only the scheme is taken from the base
+        size_t prefix = m_schemeEnd > 0 ? m_schemeEnd + 1 : 0;
+        result.reserve(prefix + refSize);
+        result.append(m_url, 0, prefix);
+        size_t authorityEnd = prefix + strcspn(ref + 2, "/?#") + 2;
+        result.append(ref, refPathEnd);
+        removeDotSegments(&result, authorityEnd < result.size() ? authorityEnd : result.size());
+        result.append(ref + refPathEnd, refSize - refPathEnd);
+
+    } else if (refPathEnd == 0) {
+        // same document, the query is kept unless the reference has one
+        const char *query = refHasQuery ? ref : m_url.data() + m_pathEnd;
+        size_t querySize = refHasQuery ? strcspn(ref, "#") : m_queryEnd - m_pathEnd;
+        const char *fragment = ref + (refHasQuery ? querySize : 0);
+        result.reserve(m_pathEnd + querySize + (refSize - (fragment - ref)));
+        result.append(m_url, 0, m_pathEnd);
+        result.append(query, querySize);
+        result.append(fragment);
+
+    } else if (ref[0] == '/') {
+        result.reserve(m_authorityEnd + refSize);
+        result.append(m_url, 0, m_authorityEnd);
+        result.append(ref, refPathEnd);
+        removeDotSegments(&result, m_authorityEnd);
+        result.append(ref + refPathEnd, refSize - refPathEnd);
+
+    } else {
+        // merge with the directory of the base path
+        bool addSlash = m_directoryEnd == m_authorityEnd && m_authorityEnd > 0;
+        result.reserve(m_directoryEnd + (addSlash ? 1 : 0) + refSize);
+        result.append(m_url, 0, m_directoryEnd);
+        if (addSlash) {
+            result.push_back('/');
+        }
+        result.append(ref, refPathEnd);
+        removeDotSegments(&result, m_authorityEnd);
+        result.append(ref + refPathEnd, refSize - refPathEnd);
+    }
+
+    return result;
+}
+
+std::string resolve(const std::string &base, const std::string &ref)
+{
+    return BaseUrl{base}.resolve(ref);
+}
+
 } // namespace UrlUtils
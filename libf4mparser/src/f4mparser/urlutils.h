@@ -25,14 +25,44 @@
 #define URLUTILS_H
 
 #include <string>
+#include <cstddef>
 
 namespace UrlUtils
 {
+    // true if the url starts with a scheme followed by "://"
     bool isAbsolute(const std::string &url);
+    bool isAbsolute(const char *url);
 
     bool haveHttpScheme(const std::string &url);
 
     bool haveRtmfpScheme(const std::string &url);
+
+    // A base url parsed once, against which references are resolved following RFC 3986 5.2.
+    // A reference with a scheme is kept as is only when the scheme is followed by "://",
+    // so that rtmp stream names like "mp4:video" stay relative.
+    class BaseUrl
+    {
+    public:
+        BaseUrl();
+        explicit BaseUrl(const std::string &url);
+
+        const std::string& url() const { return m_url; }
+
+        // the resolved url is built in a single allocation
+        std::string resolve(const char *ref) const;
+        std::string resolve(const std::string &ref) const { return resolve(ref.c_str()); }
+
+    private:
+        std::string m_url; // with its path normalized
+        size_t m_schemeEnd; // ':' or 0 without scheme
+        size_t m_authorityEnd; // end of "scheme://authority"
+        size_t m_directoryEnd; // after the last '/' of the path
+        size_t m_pathEnd; // start of '?query' or '#fragment'
+        size_t m_queryEnd; // start of '#fragment'
+    };
+
+    // resolve 'ref' against 'base', which is parsed for this call only
+    std::string resolve(const std::string &base, const std::string &ref);
 }
 
 #endif // URLUTILS_H